@@ -0,0 +1,154 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import android.media.AudioFormat;
+import android.media.AudioRecord;
+import android.media.MediaRecorder;
+import android.media.audiofx.AcousticEchoCanceler;
+import android.util.Log;
+
+/**
+ * Plugin-owned microphone capture.  Reads 16 kHz mono 16-bit PCM from an AudioRecord
+ * on a dedicated thread and hands fixed size frames to the listener, which is responsible
+ * for forwarding them to a DataRecognitionClient.
+ */
+public class AudioCapture implements Runnable {
+
+    public static final int SAMPLE_RATE = 16000;
+    public static final int FRAME_SAMPLES = 320; // 20 ms
+
+    public interface Listener {
+        /**
+         * Called on the capture thread for every frame. The frame buffer is reused.
+         */
+        void onAudioFrame(short[] frame, int length);
+
+        /**
+         * Called on the capture thread if the recorder could not be started or read.
+         */
+        void onCaptureError(String message);
+    }
+
+    private final Listener m_listener;
+    private volatile boolean m_running = false;
+    private Thread m_thread = null;
+    private boolean m_echoCancellation = false;
+
+    public AudioCapture(Listener listener) {
+        m_listener = listener;
+    }
+
+    /**
+     * Records from the voice communication source and attaches the platform echo
+     * canceler, so playback through the speaker is removed from the capture.
+     */
+    public void setEchoCancellation(boolean enabled) {
+        m_echoCancellation = enabled;
+    }
+
+    public synchronized void start() {
+        if (m_running) {
+            return;
+        }
+        m_running = true;
+        m_thread = new Thread(this, "OxfordSpeechRecognition capture");
+        m_thread.start();
+    }
+
+    /**
+     * Stops capturing. Safe to call from the listener; in that case the thread is not joined.
+     */
+    public void stop() {
+        Thread thread;
+        synchronized (this) {
+            m_running = false;
+            thread = m_thread;
+            m_thread = null;
+        }
+        if (thread != null && thread != Thread.currentThread()) {
+            try {
+                thread.join();
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+            }
+        }
+    }
+
+    public boolean isRunning() {
+        return m_running;
+    }
+
+    public void run() {
+        int minBufferSize = AudioRecord.getMinBufferSize(SAMPLE_RATE,
+                AudioFormat.CHANNEL_IN_MONO,
+                AudioFormat.ENCODING_PCM_16BIT);
+        int bufferSize = Math.max(minBufferSize, FRAME_SAMPLES * 2 * 4);
+
+        int source = m_echoCancellation ? MediaRecorder.AudioSource.VOICE_COMMUNICATION
+                : MediaRecorder.AudioSource.VOICE_RECOGNITION;
+        AudioRecord record = new AudioRecord(source,
+                SAMPLE_RATE,
+                AudioFormat.CHANNEL_IN_MONO,
+                AudioFormat.ENCODING_PCM_16BIT,
+                bufferSize);
+        if (record.getState() != AudioRecord.STATE_INITIALIZED) {
+            record.release();
+            m_running = false;
+            m_listener.onCaptureError("AudioRecord could not be initialized");
+            return;
+        }
+
+        AcousticEchoCanceler echoCanceler = null;
+        if (m_echoCancellation && AcousticEchoCanceler.isAvailable()) {
+            echoCanceler = AcousticEchoCanceler.create(record.getAudioSessionId());
+            if (echoCanceler != null) {
+                echoCanceler.setEnabled(true);
+            }
+        }
+
+        short[] frame = new short[FRAME_SAMPLES];
+        record.startRecording();
+        try {
+            while (m_running) {
+                int read = 0;
+                while (read < FRAME_SAMPLES && m_running) {
+                    int n = record.read(frame, read, FRAME_SAMPLES - read);
+                    if (n < 0) {
+                        Log.d("OxfordSpeechRecognition", "capture read failed " + n);
+                        m_running = false;
+                        m_listener.onCaptureError("AudioRecord read failed: " + n);
+                        return;
+                    }
+                    read += n;
+                }
+                if (read == FRAME_SAMPLES) {
+                    m_listener.onAudioFrame(frame, read);
+                }
+            }
+        } finally {
+            record.stop();
+            record.release();
+            if (echoCanceler != null) {
+                echoCanceler.release();
+            }
+        }
+    }
+}
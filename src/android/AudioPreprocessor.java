@@ -0,0 +1,207 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import java.util.Arrays;
+
+import org.json.JSONObject;
+
+/**
+ * Optional pre-processing chain run on the capture thread before audio is uploaded:
+ * a spectral-subtraction noise suppressor followed by an automatic gain control.
+ *
+ * The suppressor works on 20 ms sqrt-Hann windows with a 10 ms hop, so it adds a
+ * fixed 10 ms of latency.  All buffers are allocated up front; process() does not
+ * allocate.  Echo cancellation is delegated to the platform (see AudioCapture).
+ */
+public class AudioPreprocessor {
+
+    private static final int HOP = 160;                  // 10 ms
+    private static final int WINDOW = HOP * 2;
+    private static final int FFT_SIZE = 512;
+    private static final int BINS = FFT_SIZE / 2 + 1;
+    private static final int NOISE_INIT_HOPS = 10;       // first 100 ms assumed to be noise
+    private static final float NOISE_SMOOTHING = 0.05f;  // per hop, while the bin has no speech
+    private static final float SPEECH_RATIO = 4f;        // 6 dB over the noise counts as speech
+    private static final float NOISE_RISE = 1.002f;      // ~0.9 dB/s, lets a louder noise take over
+    private static final float AGC_GATE = 0.0056f;       // -45 dBFS, don't amplify silence
+    private static final float AGC_ATTACK = 0.5f;
+    private static final float AGC_RELEASE = 0.05f;
+
+    boolean m_noiseSuppression = true;
+    boolean m_agc = true;
+    boolean m_echoCancellation = false;
+    float m_overSubtraction = 2f;
+    float m_gainFloor = 0.1f;
+    float m_agcTarget = 0.1f;                            // -20 dBFS
+    float m_agcMaxGain = 10f;                            // +20 dB
+
+    private final Fft m_fft = new Fft(FFT_SIZE);
+    private final float[] m_window = new float[WINDOW];
+    private final float[] m_input = new float[WINDOW];
+    private final float[] m_overlap = new float[HOP];
+    private final float[] m_re = new float[FFT_SIZE];
+    private final float[] m_im = new float[FFT_SIZE];
+    private final float[] m_noise = new float[BINS];
+    private int m_noiseHops = 0;
+    private float m_agcGain = 1f;
+
+    public AudioPreprocessor() {
+        // Periodic sqrt-Hann: analysis * synthesis sums to one at 50% overlap.
+        for (int i = 0; i < WINDOW; i++) {
+            m_window[i] = (float) Math.sqrt(0.5 - 0.5 * Math.cos(2 * Math.PI * i / WINDOW));
+        }
+    }
+
+    /**
+     * Reads the "preprocessing" init option.
+     */
+    public void configure(JSONObject options) {
+        if (options == null) {
+            return;
+        }
+        m_noiseSuppression = options.optBoolean("noiseSuppression", m_noiseSuppression);
+        m_agc = options.optBoolean("agc", m_agc);
+        m_echoCancellation = options.optBoolean("echoCancellation", m_echoCancellation);
+        m_overSubtraction = (float) options.optDouble("overSubtraction", m_overSubtraction);
+        m_gainFloor = (float) options.optDouble("gainFloor", m_gainFloor);
+        m_agcTarget = (float) Math.pow(10, options.optDouble("agcTargetDbfs", -20) / 20);
+        m_agcMaxGain = (float) Math.pow(10, options.optDouble("agcMaxGainDb", 20) / 20);
+    }
+
+    public boolean isEchoCancellationEnabled() {
+        return m_echoCancellation;
+    }
+
+    /**
+     * Fixed latency added by the chain.
+     */
+    public int getLatencyMs() {
+        return m_noiseSuppression ? HOP * 1000 / AudioCapture.SAMPLE_RATE : 0;
+    }
+
+    public void reset() {
+        Arrays.fill(m_input, 0);
+        Arrays.fill(m_overlap, 0);
+        Arrays.fill(m_noise, 0);
+        m_noiseHops = 0;
+        m_agcGain = 1f;
+    }
+
+    /**
+     * Processes a frame in place. The length should be a multiple of 10 ms.
+     */
+    public void process(short[] frame, int length) {
+        if (m_noiseSuppression) {
+            for (int offset = 0; offset + HOP <= length; offset += HOP) {
+                suppress(frame, offset);
+            }
+        }
+        if (m_agc) {
+            applyGain(frame, length);
+        }
+    }
+
+    private void suppress(short[] frame, int offset) {
+        System.arraycopy(m_input, HOP, m_input, 0, HOP);
+        for (int i = 0; i < HOP; i++) {
+            m_input[HOP + i] = frame[offset + i] / 32768f;
+        }
+        for (int i = 0; i < WINDOW; i++) {
+            m_re[i] = m_input[i] * m_window[i];
+            m_im[i] = 0;
+        }
+        for (int i = WINDOW; i < FFT_SIZE; i++) {
+            m_re[i] = 0;
+            m_im[i] = 0;
+        }
+
+        m_fft.transform(m_re, m_im, false);
+
+        float floor = m_gainFloor * m_gainFloor;
+        for (int k = 0; k < BINS; k++) {
+            float power = m_re[k] * m_re[k] + m_im[k] * m_im[k];
+            if (m_noiseHops < NOISE_INIT_HOPS) {
+                m_noise[k] += (power - m_noise[k]) / (m_noiseHops + 1);
+            } else if (power < SPEECH_RATIO * m_noise[k]) {
+                // Averaging the periodogram, rather than tracking its minima, keeps the
+                // estimate at the mean noise power instead of well below it.
+                m_noise[k] += NOISE_SMOOTHING * (power - m_noise[k]);
+            } else {
+                m_noise[k] *= NOISE_RISE;
+            }
+            float gain = power > 0 ? 1 - m_overSubtraction * m_noise[k] / power : 0;
+            gain = (float) Math.sqrt(Math.max(gain, floor));
+
+            m_re[k] *= gain;
+            m_im[k] *= gain;
+            if (k > 0 && k < FFT_SIZE / 2) {
+                m_re[FFT_SIZE - k] *= gain;
+                m_im[FFT_SIZE - k] *= gain;
+            }
+        }
+        if (m_noiseHops < NOISE_INIT_HOPS) {
+            m_noiseHops++;
+        }
+
+        m_fft.transform(m_re, m_im, true);
+
+        for (int i = 0; i < HOP; i++) {
+            float y = m_overlap[i] + m_re[i] * m_window[i];
+            frame[offset + i] = toSample(y * 32768f);
+        }
+        for (int i = HOP; i < WINDOW; i++) {
+            m_overlap[i - HOP] = m_re[i] * m_window[i];
+        }
+    }
+
+    private void applyGain(short[] frame, int length) {
+        long sumSquares = 0;
+        for (int i = 0; i < length; i++) {
+            sumSquares += frame[i] * frame[i];
+        }
+        float rms = (float) Math.sqrt((double) sumSquares / length) / 32768f;
+
+        float target = m_agcGain;
+        if (rms > AGC_GATE) {
+            float desired = Math.min(m_agcTarget / rms, m_agcMaxGain);
+            target += (desired < m_agcGain ? AGC_ATTACK : AGC_RELEASE) * (desired - m_agcGain);
+        }
+
+        // Ramp across the frame to avoid zipper noise.
+        float gain = m_agcGain;
+        float step = (target - m_agcGain) / length;
+        for (int i = 0; i < length; i++) {
+            gain += step;
+            frame[i] = toSample(frame[i] * gain);
+        }
+        m_agcGain = target;
+    }
+
+    private static short toSample(float value) {
+        if (value > 32767f) {
+            return 32767;
+        }
+        if (value < -32768f) {
+            return -32768;
+        }
+        return (short) Math.round(value);
+    }
+}
@@ -0,0 +1,222 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import java.util.ArrayDeque;
+import java.util.Arrays;
+
+import android.os.SystemClock;
+import android.util.Log;
+
+import com.microsoft.ProjectOxford.DataRecognitionClient;
+
+/**
+ * Bounded queue between pushAudio calls from JS and a DataRecognitionClient.
+ *
+ * sendAudio doesn't block: the SDK copies the buffer into its own unbounded work queue and
+ * uploads it at the audio rate from there.  So the queue thread paces itself at the audio
+ * rate (a little ahead of it, so the SDK never runs dry) and a chunk counts as queued until
+ * the pacing has handed all of it to the client.  JS can easily push faster than that.
+ * Memory is capped at the configured capacity: a chunk that doesn't fit is refused.  Once
+ * the queue crosses the high water mark the caller is told to back off, and the listener is
+ * notified when it has drained below the low water mark again.
+ */
+public class AudioPushQueue implements Runnable {
+
+    private static final int BYTES_PER_MS = AudioCapture.SAMPLE_RATE * 2 / 1000;
+    private static final int SLICE_MS = 100;
+    private static final int LEAD_MS = 200;
+
+    public interface Listener {
+        /**
+         * Called on the queue thread, with the queue locked, when the queue drains below
+         * the low water mark after backpressure was signalled. sequence is that of the last
+         * offer before the drain.
+         */
+        void onQueueDrained(int queuedBytes, long sequence);
+
+        /**
+         * Called on the queue thread after endAudio has been sent.
+         */
+        void onQueueFinished();
+    }
+
+    private final DataRecognitionClient m_client;
+    private final SessionRecorder m_recorder;
+    private final Listener m_listener;
+    private final int m_capacity;
+    private final int m_highWater;
+    private final int m_lowWater;
+    private ConfidenceRetry m_retryBuffer = null;
+
+    private final ArrayDeque<byte[]> m_chunks = new ArrayDeque<byte[]>();
+    private int m_queuedBytes = 0;
+    private boolean m_backpressure = false;
+    private long m_sequence = 0;
+    private boolean m_ended = false;
+    private boolean m_cancelled = false;
+
+    public AudioPushQueue(DataRecognitionClient client, SessionRecorder recorder, Listener listener,
+            int capacity, int highWater, int lowWater) {
+        m_client = client;
+        m_recorder = recorder;
+        m_listener = listener;
+        m_capacity = capacity;
+        m_highWater = highWater;
+        m_lowWater = lowWater;
+    }
+
+    /**
+     * Also buffers the sent audio for confidence retries.
+     */
+    public void setRetryBuffer(ConfidenceRetry retry) {
+        m_retryBuffer = retry;
+    }
+
+    public void start() {
+        new Thread(this, "OxfordSpeechRecognition push").start();
+    }
+
+    /**
+     * Queues a chunk. Returns false, leaving the queue unchanged, if it would exceed the capacity.
+     * The caller's sequence number is echoed in drain notifications, so the caller can tell
+     * which of its replies a drain came after.
+     */
+    public synchronized boolean offer(byte[] chunk, long sequence) {
+        m_sequence = sequence;
+        if (m_ended || m_queuedBytes + chunk.length > m_capacity) {
+            return false;
+        }
+        m_chunks.add(chunk);
+        m_queuedBytes += chunk.length;
+        if (m_queuedBytes >= m_highWater) {
+            m_backpressure = true;
+        }
+        notifyAll();
+        return true;
+    }
+
+    /**
+     * Sends endAudio once everything queued so far has been sent.
+     */
+    public synchronized void end() {
+        m_ended = true;
+        notifyAll();
+    }
+
+    /**
+     * Drops whatever is queued and stops without sending endAudio.
+     */
+    public synchronized void cancel() {
+        m_cancelled = true;
+        m_chunks.clear();
+        m_queuedBytes = 0;
+        notifyAll();
+    }
+
+    public synchronized int getQueuedBytes() {
+        return m_queuedBytes;
+    }
+
+    public synchronized boolean isBackpressure() {
+        return m_backpressure;
+    }
+
+    public int getCapacity() {
+        return m_capacity;
+    }
+
+    public void run() {
+        long due = 0;                                   // when the next slice is due, in ms
+        while (true) {
+            byte[] chunk;
+            synchronized (this) {
+                while (m_chunks.isEmpty() && !m_ended && !m_cancelled) {
+                    try {
+                        wait();
+                    } catch (InterruptedException e) {
+                        Thread.currentThread().interrupt();
+                        return;
+                    }
+                }
+                if (m_cancelled) {
+                    return;
+                }
+                chunk = m_chunks.poll();
+                if (chunk == null) {
+                    break;                              // ended and drained
+                }
+            }
+
+            for (int offset = 0; offset < chunk.length; ) {
+                int length = Math.min(SLICE_MS * BYTES_PER_MS, chunk.length - offset);
+
+                // After an idle gap the schedule restarts from now instead of bursting.
+                long now = SystemClock.elapsedRealtime();
+                due = Math.max(due, now);
+                synchronized (this) {
+                    while (!m_cancelled && due - now > LEAD_MS) {
+                        try {
+                            wait(due - now - LEAD_MS);
+                        } catch (InterruptedException e) {
+                            Thread.currentThread().interrupt();
+                            return;
+                        }
+                        now = SystemClock.elapsedRealtime();
+                    }
+                    if (m_cancelled) {
+                        return;
+                    }
+                }
+
+                byte[] slice = offset == 0 && length == chunk.length ? chunk : Arrays.copyOfRange(chunk, offset, offset + length);
+                m_client.sendAudio(slice, length);
+                if (m_recorder != null) {
+                    m_recorder.writeAudio(slice, length);
+                }
+                if (m_retryBuffer != null) {
+                    m_retryBuffer.write(slice, length);
+                }
+                due += length / BYTES_PER_MS;
+                offset += length;
+
+                synchronized (this) {
+                    if (m_cancelled) {
+                        // cancel() already dropped the count.
+                        return;
+                    }
+                    m_queuedBytes = Math.max(0, m_queuedBytes - length);
+                    if (m_backpressure && m_queuedBytes <= m_lowWater) {
+                        m_backpressure = false;
+                        // Under the lock, so the event is ordered with the replies to offer().
+                        m_listener.onQueueDrained(m_queuedBytes, m_sequence);
+                    }
+                }
+            }
+        }
+
+        Log.d("OxfordSpeechRecognition", "push queue finished");
+        m_client.endAudio();
+        if (m_recorder != null) {
+            m_recorder.writeEndAudio();
+        }
+        m_listener.onQueueFinished();
+    }
+}
@@ -0,0 +1,272 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import org.json.JSONArray;
+import org.json.JSONException;
+import org.json.JSONObject;
+
+/**
+ * Streaming quality analyzer for 16-bit PCM capture frames.
+ *
+ * For every frame it measures peak, RMS, clipping ratio and DC offset, and keeps
+ * a running noise floor / speech level estimate to derive the SNR.  The result is
+ * a bit set of issues the plugin can either report to the app or use to abort the
+ * session before a bad capture makes a full round trip to the service.
+ * Everything is a single pass over the frame with no allocation.
+ *
+ * There is no vDSP counterpart on Android, so the frame statistics are a branch-free loop
+ * over four independent lanes instead: ART's loop vectorizer can map it to NEON, and even
+ * scalar it has no data dependent branches or serial accumulator chain.
+ */
+public class AudioQualityAnalyzer {
+
+    public static final int ISSUE_CLIPPING = 1;
+    public static final int ISSUE_DC_OFFSET = 2;
+    public static final int ISSUE_LOW_SNR = 4;
+    public static final int ISSUE_SILENCE = 8;
+
+    public static final String POLICY_WARN = "warn";
+    public static final String POLICY_ABORT = "abort";
+
+    private static final float FULL_SCALE = 32768f;
+    private static final int CLIP_LEVEL = 32440;          // ~ -0.09 dBFS
+    private static final float SPEECH_LEVEL = 0.0056f;    // -45 dBFS
+    private static final float MIN_LEVEL = 1f / FULL_SCALE;
+    private static final float SMOOTHING = 0.1f;          // ~200 ms at 20 ms frames
+    private static final float NOISE_RISE = 1.002f;      // ~0.9 dB/s at 20 ms frames
+    private static final float SPEECH_DECAY = 0.995f;
+
+    // Policy
+    String m_policy = POLICY_WARN;
+    float m_maxClipRatio = 0.01f;
+    float m_maxDcOffset = 0.05f;
+    float m_minSnrDb = 10f;
+    int m_silenceTimeoutMs = 3000;
+    int m_abortAfterMs = 1000;
+    int m_sampleRate = AudioCapture.SAMPLE_RATE;
+
+    // Last frame
+    float m_peak;
+    float m_rms;
+    float m_clipRatio;
+    float m_dcOffset;
+    float m_snrDb;
+
+    // Running state
+    float m_avgClipRatio;
+    float m_avgDcOffset;
+    float m_noiseFloor;
+    float m_speechLevel;
+    long m_samplesAnalyzed;
+    long m_issueSamples;
+    boolean m_heardSpeech;
+    int m_issues;
+
+    public AudioQualityAnalyzer() {
+        reset();
+    }
+
+    /**
+     * Reads the policy from the "audioQuality" init option.
+     */
+    public void configure(JSONObject options) {
+        if (options == null) {
+            return;
+        }
+        m_policy = options.optString("policy", m_policy);
+        m_maxClipRatio = (float) options.optDouble("maxClipRatio", m_maxClipRatio);
+        m_maxDcOffset = (float) options.optDouble("maxDcOffset", m_maxDcOffset);
+        m_minSnrDb = (float) options.optDouble("minSnrDb", m_minSnrDb);
+        m_silenceTimeoutMs = options.optInt("silenceTimeoutMs", m_silenceTimeoutMs);
+        m_abortAfterMs = options.optInt("abortAfterMs", m_abortAfterMs);
+    }
+
+    public void reset() {
+        m_peak = 0;
+        m_rms = 0;
+        m_clipRatio = 0;
+        m_dcOffset = 0;
+        m_snrDb = 0;
+        m_avgClipRatio = 0;
+        m_avgDcOffset = 0;
+        m_noiseFloor = 0;
+        m_speechLevel = 0;
+        m_samplesAnalyzed = 0;
+        m_issueSamples = 0;
+        m_heardSpeech = false;
+        m_issues = 0;
+    }
+
+    /**
+     * Analyzes one frame and returns the current issue set.
+     */
+    public int analyze(short[] frame, int length) {
+        if (length <= 0) {
+            return m_issues;
+        }
+
+        // Four lanes; (CLIP_LEVEL - 1 - a) >>> 31 is 1 exactly when a >= CLIP_LEVEL.
+        long sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+        long squares0 = 0, squares1 = 0, squares2 = 0, squares3 = 0;
+        int peak0 = 0, peak1 = 0, peak2 = 0, peak3 = 0;
+        int clipped0 = 0, clipped1 = 0, clipped2 = 0, clipped3 = 0;
+        int blocked = length & ~3;
+        for (int i = 0; i < blocked; i += 4) {
+            int s0 = frame[i];
+            int s1 = frame[i + 1];
+            int s2 = frame[i + 2];
+            int s3 = frame[i + 3];
+            int a0 = Math.abs(s0);
+            int a1 = Math.abs(s1);
+            int a2 = Math.abs(s2);
+            int a3 = Math.abs(s3);
+            sum0 += s0;
+            sum1 += s1;
+            sum2 += s2;
+            sum3 += s3;
+            squares0 += s0 * s0;
+            squares1 += s1 * s1;
+            squares2 += s2 * s2;
+            squares3 += s3 * s3;
+            peak0 = Math.max(peak0, a0);
+            peak1 = Math.max(peak1, a1);
+            peak2 = Math.max(peak2, a2);
+            peak3 = Math.max(peak3, a3);
+            clipped0 += (CLIP_LEVEL - 1 - a0) >>> 31;
+            clipped1 += (CLIP_LEVEL - 1 - a1) >>> 31;
+            clipped2 += (CLIP_LEVEL - 1 - a2) >>> 31;
+            clipped3 += (CLIP_LEVEL - 1 - a3) >>> 31;
+        }
+        for (int i = blocked; i < length; i++) {
+            int s = frame[i];
+            int a = Math.abs(s);
+            sum0 += s;
+            squares0 += s * s;
+            peak0 = Math.max(peak0, a);
+            clipped0 += (CLIP_LEVEL - 1 - a) >>> 31;
+        }
+        long sum = sum0 + sum1 + sum2 + sum3;
+        long sumSquares = squares0 + squares1 + squares2 + squares3;
+        int peak = Math.max(Math.max(peak0, peak1), Math.max(peak2, peak3));
+        int clipped = clipped0 + clipped1 + clipped2 + clipped3;
+
+        m_peak = peak / FULL_SCALE;
+        m_rms = (float) Math.sqrt((double) sumSquares / length) / FULL_SCALE;
+        m_clipRatio = (float) clipped / length;
+        m_dcOffset = (sum / (float) length) / FULL_SCALE;
+
+        m_avgClipRatio += SMOOTHING * (m_clipRatio - m_avgClipRatio);
+        m_avgDcOffset += SMOOTHING * (m_dcOffset - m_avgDcOffset);
+
+        // Minimum statistics noise floor: follow drops immediately, rise slowly.
+        float level = Math.max(m_rms, MIN_LEVEL);
+        if (m_noiseFloor == 0 || level < m_noiseFloor) {
+            m_noiseFloor = level;
+        } else {
+            m_noiseFloor *= NOISE_RISE;
+        }
+        // Speech level: fast attack, slow release, never below the floor.
+        if (level > m_speechLevel) {
+            m_speechLevel = level;
+        } else {
+            m_speechLevel = Math.max(m_noiseFloor, m_speechLevel * SPEECH_DECAY);
+        }
+        m_snrDb = (float) (20.0 * Math.log10(m_speechLevel / m_noiseFloor));
+        if (m_rms >= SPEECH_LEVEL) {
+            m_heardSpeech = true;
+        }
+        m_samplesAnalyzed += length;
+
+        int issues = 0;
+        if (m_avgClipRatio > m_maxClipRatio) {
+            issues |= ISSUE_CLIPPING;
+        }
+        if (Math.abs(m_avgDcOffset) > m_maxDcOffset) {
+            issues |= ISSUE_DC_OFFSET;
+        }
+        // Give the level trackers a second to settle before judging the SNR.
+        if (m_heardSpeech && m_samplesAnalyzed >= m_sampleRate && m_snrDb < m_minSnrDb) {
+            issues |= ISSUE_LOW_SNR;
+        }
+        if (!m_heardSpeech && getElapsedMs() >= m_silenceTimeoutMs) {
+            issues |= ISSUE_SILENCE;
+        }
+
+        m_issueSamples = issues != 0 ? m_issueSamples + length : 0;
+        m_issues = issues;
+        return issues;
+    }
+
+    public int getIssues() {
+        return m_issues;
+    }
+
+    public long getElapsedMs() {
+        return m_samplesAnalyzed * 1000 / m_sampleRate;
+    }
+
+    /**
+     * How long the current issues have persisted without interruption.
+     */
+    public long getIssueDurationMs() {
+        return m_issueSamples * 1000 / m_sampleRate;
+    }
+
+    /**
+     * Whether the policy asks for the session to be aborted locally.
+     */
+    public boolean shouldAbort() {
+        return POLICY_ABORT.equals(m_policy) && m_issues != 0 && getIssueDurationMs() >= m_abortAfterMs;
+    }
+
+    public static JSONArray issuesToJSON(int issues) {
+        JSONArray names = new JSONArray();
+        if ((issues & ISSUE_CLIPPING) != 0) {
+            names.put("clipping");
+        }
+        if ((issues & ISSUE_DC_OFFSET) != 0) {
+            names.put("dcOffset");
+        }
+        if ((issues & ISSUE_LOW_SNR) != 0) {
+            names.put("lowSnr");
+        }
+        if ((issues & ISSUE_SILENCE) != 0) {
+            names.put("silence");
+        }
+        return names;
+    }
+
+    public JSONObject toJSON() {
+        JSONObject stats = new JSONObject();
+        try {
+            stats.put("peak", m_peak);
+            stats.put("rms", m_rms);
+            stats.put("clipRatio", m_avgClipRatio);
+            stats.put("dcOffset", m_avgDcOffset);
+            stats.put("snrDb", m_snrDb);
+            stats.put("elapsedMs", getElapsedMs());
+            stats.put("issues", issuesToJSON(m_issues));
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,174 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import com.microsoft.ProjectOxford.DataRecognitionClient;
+
+/**
+ * Sits between the capture frames and the DataRecognitionClient.
+ *
+ * Frames are batched into one sendAudio call per interval instead of one per 20 ms frame,
+ * and with the speech gate enabled nothing is sent until a few consecutive frames are
+ * above the gate level.  The frames just before the onset are kept in a pre-roll ring and
+ * sent first, so the start of the utterance is not clipped; the leading silence before it
+ * never leaves the device.  Once open the gate stays open for the session, so trailing
+ * silence still reaches the service for its end of speech detection.
+ *
+ * Everything actually sent is also passed to the listener, so the session recording and the
+ * retry buffer hold exactly what the service got.
+ */
+public class AudioSendGate {
+
+    public interface Listener {
+        /**
+         * Called on the capture thread after each sendAudio. The buffer is reused.
+         */
+        void onGateSent(byte[] audio, int length);
+    }
+
+    private static final int BYTES_PER_MS = AudioCapture.SAMPLE_RATE * 2 / 1000;
+    private static final int ONSET_FRAMES = 3;
+
+    private DataRecognitionClient m_client;
+    private final Listener m_listener;
+    private final byte[] m_batch;
+    private int m_batchLength = 0;
+
+    private final float m_gateLevel;        // linear RMS, 0 when the gate is off
+    private final byte[] m_preRoll;
+    private int m_preRollHead = 0;
+    private int m_preRollLength = 0;
+    private int m_loudFrames = 0;
+    private boolean m_open;
+
+    // Metrics. Written by the capture thread only, read from others.
+    private volatile long m_sentBytes = 0;
+    private volatile long m_trimmedBytes = 0;
+    private volatile long m_sendCalls = 0;
+
+    /**
+     * @param gateDbfs the speech onset level, NaN to send everything
+     * @param preRollMs kept before the onset; at least the onset window, so no onset frame is lost
+     */
+    public AudioSendGate(DataRecognitionClient client, Listener listener, int batchMs, float gateDbfs, int preRollMs) {
+        m_client = client;
+        m_listener = listener;
+        m_batch = new byte[Math.max(batchMs, AudioCapture.FRAME_SAMPLES * 1000 / AudioCapture.SAMPLE_RATE) * BYTES_PER_MS];
+        m_open = Float.isNaN(gateDbfs);
+        m_gateLevel = m_open ? 0 : (float) Math.pow(10, gateDbfs / 20);
+        int onsetMs = ONSET_FRAMES * AudioCapture.FRAME_SAMPLES * 1000 / AudioCapture.SAMPLE_RATE;
+        m_preRoll = new byte[m_open ? 0 : Math.max(preRollMs, onsetMs) * BYTES_PER_MS];
+    }
+
+    /**
+     * Sends what is batched to the current client and switches to another one.
+     */
+    public void setClient(DataRecognitionClient client) {
+        flush();
+        m_client = client;
+    }
+
+    /**
+     * Called on the capture thread for every frame, after preprocessing.
+     */
+    public void write(short[] frame, int length) {
+        if (!m_open) {
+            long sumSquares = 0;
+            for (int i = 0; i < length; i++) {
+                sumSquares += frame[i] * frame[i];
+            }
+            float rms = (float) Math.sqrt((double) sumSquares / length) / 32768f;
+            m_loudFrames = rms >= m_gateLevel ? m_loudFrames + 1 : 0;
+            int overwritten = 0;
+            for (int i = 0; i < length; i++) {
+                overwritten += writePreRoll((byte) (frame[i] & 0xff));
+                overwritten += writePreRoll((byte) ((frame[i] >> 8) & 0xff));
+            }
+            m_trimmedBytes += overwritten;
+            if (m_loudFrames < ONSET_FRAMES) {
+                return;
+            }
+            m_open = true;
+            int start = (m_preRollHead - m_preRollLength + m_preRoll.length) % m_preRoll.length;
+            for (int i = 0; i < m_preRollLength; i++) {
+                append(m_preRoll[(start + i) % m_preRoll.length]);
+            }
+            m_preRollLength = 0;
+            return;
+        }
+
+        for (int i = 0; i < length; i++) {
+            append((byte) (frame[i] & 0xff));
+            append((byte) ((frame[i] >> 8) & 0xff));
+        }
+    }
+
+    /**
+     * Sends whatever is batched. Call before endAudio.
+     */
+    public void flush() {
+        if (m_batchLength > 0) {
+            m_client.sendAudio(m_batch, m_batchLength);
+            m_listener.onGateSent(m_batch, m_batchLength);
+            m_sentBytes += m_batchLength;
+            m_sendCalls++;
+            m_batchLength = 0;
+        }
+        if (!m_open) {
+            // No speech at all; the pre-roll was silence too.
+            m_trimmedBytes += m_preRollLength;
+            m_preRollLength = 0;
+        }
+    }
+
+    /**
+     * Returns the number of bytes pushed out of the ring, 0 or 1.
+     */
+    private int writePreRoll(byte b) {
+        int overwritten = 0;
+        if (m_preRollLength == m_preRoll.length) {
+            overwritten = 1;
+        } else {
+            m_preRollLength++;
+        }
+        m_preRoll[m_preRollHead] = b;
+        m_preRollHead = (m_preRollHead + 1) % m_preRoll.length;
+        return overwritten;
+    }
+
+    private void append(byte b) {
+        m_batch[m_batchLength++] = b;
+        if (m_batchLength == m_batch.length) {
+            flush();
+        }
+    }
+
+    public long getSentBytes() {
+        return m_sentBytes;
+    }
+
+    public long getTrimmedBytes() {
+        return m_trimmedBytes;
+    }
+
+    public long getSendCalls() {
+        return m_sendCalls;
+    }
+}
@@ -0,0 +1,276 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import java.io.BufferedOutputStream;
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.util.Arrays;
+import java.util.Comparator;
+
+/**
+ * Read-only weighted prefix trie stored in a flat file and memory mapped, so loading it costs
+ * one mmap and lookups touch only the pages they walk.
+ *
+ * File layout (little endian, u32 everywhere):
+ *   header:  magic "OXTR" | version | node count | edge count
+ *   nodes:   first edge | edge count | weight | max weight in subtree      (node 0 is the root)
+ *   edges:   UTF-16 code unit | child node                                  (sorted per node)
+ * A weight of 0 means no key ends at the node.  Nodes are numbered breadth first, so every
+ * node's edges are contiguous and children always come after their parent.
+ * The iOS OxfordCompactTrie reads and writes the same format.
+ */
+public class CompactTrie {
+
+    public static final int MAGIC = 0x5254584f;   // "OXTR"
+    public static final int VERSION = 1;
+    static final int HEADER_SIZE = 16;
+    static final int NODE_SIZE = 16;
+    static final int EDGE_SIZE = 8;
+
+    private final ByteBuffer m_map;
+    private final int m_nodeCount;
+    private final int m_edgeCount;
+    private final int m_edgeBase;
+
+    CompactTrie(ByteBuffer map) throws IOException {
+        m_map = map.order(ByteOrder.LITTLE_ENDIAN);
+        if (m_map.limit() < HEADER_SIZE || m_map.getInt(0) != MAGIC || m_map.getInt(4) != VERSION) {
+            throw new IOException("not a trie file");
+        }
+        m_nodeCount = m_map.getInt(8);
+        m_edgeCount = m_map.getInt(12);
+        m_edgeBase = HEADER_SIZE + m_nodeCount * NODE_SIZE;
+        if (m_nodeCount < 1 || (long) m_edgeBase + (long) m_edgeCount * EDGE_SIZE > m_map.limit()) {
+            throw new IOException("truncated trie file");
+        }
+    }
+
+    /**
+     * Maps a trie file. The mapping stays valid after the file is closed.
+     */
+    public static CompactTrie load(File file) throws IOException {
+        RandomAccessFile raf = new RandomAccessFile(file, "r");
+        try {
+            FileChannel channel = raf.getChannel();
+            MappedByteBuffer map = channel.map(FileChannel.MapMode.READ_ONLY, 0, channel.size());
+            return new CompactTrie(map);
+        } finally {
+            raf.close();
+        }
+    }
+
+    public int getNodeCount() {
+        return m_nodeCount;
+    }
+
+    public int getEdgeCount() {
+        return m_edgeCount;
+    }
+
+    /**
+     * The child of a node along the given code unit, or -1.
+     */
+    public int child(int node, char c) {
+        int base = HEADER_SIZE + node * NODE_SIZE;
+        int lo = m_map.getInt(base);
+        int hi = lo + m_map.getInt(base + 4) - 1;
+        while (lo <= hi) {
+            int mid = (lo + hi) >>> 1;
+            int edge = m_edgeBase + mid * EDGE_SIZE;
+            int key = m_map.getInt(edge);
+            if (key < c) {
+                lo = mid + 1;
+            } else if (key > c) {
+                hi = mid - 1;
+            } else {
+                return m_map.getInt(edge + 4);
+            }
+        }
+        return -1;
+    }
+
+    public int edgeCount(int node) {
+        return m_map.getInt(HEADER_SIZE + node * NODE_SIZE + 4);
+    }
+
+    /**
+     * The code unit and child of a node's i-th edge.
+     */
+    public char edgeChar(int node, int i) {
+        return (char) m_map.getInt(m_edgeBase + (m_map.getInt(HEADER_SIZE + node * NODE_SIZE) + i) * EDGE_SIZE);
+    }
+
+    public int edgeChild(int node, int i) {
+        return m_map.getInt(m_edgeBase + (m_map.getInt(HEADER_SIZE + node * NODE_SIZE) + i) * EDGE_SIZE + 4);
+    }
+
+    /**
+     * Weight of the key ending at the node, 0 if none does.
+     */
+    public int weight(int node) {
+        return m_map.getInt(HEADER_SIZE + node * NODE_SIZE + 8);
+    }
+
+    /**
+     * Highest weight of any key at or below the node.
+     */
+    public int maxWeight(int node) {
+        return m_map.getInt(HEADER_SIZE + node * NODE_SIZE + 12);
+    }
+
+    /**
+     * The node reached by walking the whole string from the root, or -1.
+     */
+    public int find(CharSequence key) {
+        int node = 0;
+        for (int i = 0; i < key.length() && node >= 0; i++) {
+            node = child(node, key.charAt(i));
+        }
+        return node;
+    }
+
+    /**
+     * Writes a trie of the given keys; the weights of duplicate keys are added up and
+     * should be positive.  The file is written next to the target and renamed over it,
+     * so a mapped old version is never modified in place.
+     */
+    public static void write(File file, String[] keys, int[] weights) throws IOException {
+        Integer[] order = new Integer[keys.length];
+        for (int i = 0; i < order.length; i++) {
+            order[i] = i;
+        }
+        final String[] k = keys;
+        Arrays.sort(order, new Comparator<Integer>() {
+            public int compare(Integer a, Integer b) {
+                return k[a].compareTo(k[b]);
+            }
+        });
+        String[] sorted = new String[keys.length];
+        int[] sortedWeights = new int[keys.length];
+        int count = 0;
+        for (int i = 0; i < order.length; i++) {
+            String key = keys[order[i]];
+            if (count > 0 && sorted[count - 1].equals(key)) {
+                sortedWeights[count - 1] += weights[order[i]];
+            } else {
+                sorted[count] = key;
+                sortedWeights[count] = weights[order[i]];
+                count++;
+            }
+        }
+
+        // Breadth first over ranges of the sorted keys that share a prefix of length depth.
+        int capacity = 1024;
+        int[] lo = new int[capacity];
+        int[] hi = new int[capacity];
+        int[] depth = new int[capacity];
+        int[] nodes = new int[capacity * 4];
+        int[] edges = new int[capacity * 2];
+        int nodeCount = 1;
+        int edgeCount = 0;
+        lo[0] = 0;
+        hi[0] = count;
+        depth[0] = 0;
+
+        for (int n = 0; n < nodeCount; n++) {
+            int start = lo[n];
+            int d = depth[n];
+            int weight = 0;
+            if (start < hi[n] && sorted[start].length() == d) {
+                weight = sortedWeights[start];
+                start++;
+            }
+            nodes[n * 4] = edgeCount;
+            nodes[n * 4 + 2] = weight;
+            nodes[n * 4 + 3] = weight;
+
+            int i = start;
+            while (i < hi[n]) {
+                char c = sorted[i].charAt(d);
+                int j = i + 1;
+                while (j < hi[n] && sorted[j].charAt(d) == c) {
+                    j++;
+                }
+                if (nodeCount == lo.length) {
+                    capacity *= 2;
+                    lo = Arrays.copyOf(lo, capacity);
+                    hi = Arrays.copyOf(hi, capacity);
+                    depth = Arrays.copyOf(depth, capacity);
+                    nodes = Arrays.copyOf(nodes, capacity * 4);
+                }
+                if (edgeCount * 2 == edges.length) {
+                    edges = Arrays.copyOf(edges, edges.length * 2);
+                }
+                lo[nodeCount] = i;
+                hi[nodeCount] = j;
+                depth[nodeCount] = d + 1;
+                edges[edgeCount * 2] = c;
+                edges[edgeCount * 2 + 1] = nodeCount;
+                edgeCount++;
+                nodeCount++;
+                i = j;
+            }
+            nodes[n * 4 + 1] = edgeCount - nodes[n * 4];
+        }
+
+        // Children come after their parents, so one backwards pass fills in the subtree maxima.
+        for (int n = nodeCount - 1; n >= 0; n--) {
+            for (int e = nodes[n * 4]; e < nodes[n * 4] + nodes[n * 4 + 1]; e++) {
+                nodes[n * 4 + 3] = Math.max(nodes[n * 4 + 3], nodes[edges[e * 2 + 1] * 4 + 3]);
+            }
+        }
+
+        File temp = new File(file.getPath() + ".tmp");
+        OutputStream out = new BufferedOutputStream(new FileOutputStream(temp), 64 * 1024);
+        try {
+            ByteBuffer block = ByteBuffer.allocate(64 * 1024).order(ByteOrder.LITTLE_ENDIAN);
+            block.putInt(MAGIC).putInt(VERSION).putInt(nodeCount).putInt(edgeCount);
+            for (int i = 0; i < nodeCount * 4; i++) {
+                if (!block.hasRemaining()) {
+                    out.write(block.array(), 0, block.position());
+                    block.clear();
+                }
+                block.putInt(nodes[i]);
+            }
+            for (int i = 0; i < edgeCount * 2; i++) {
+                if (!block.hasRemaining()) {
+                    out.write(block.array(), 0, block.position());
+                    block.clear();
+                }
+                block.putInt(edges[i]);
+            }
+            out.write(block.array(), 0, block.position());
+        } finally {
+            out.close();
+        }
+        if (!temp.renameTo(file)) {
+            temp.delete();
+            throw new IOException("could not replace " + file);
+        }
+    }
+}
@@ -0,0 +1,387 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import java.util.ArrayList;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.Executor;
+import java.util.concurrent.TimeUnit;
+
+import org.json.JSONArray;
+import org.json.JSONException;
+import org.json.JSONObject;
+
+import android.app.Activity;
+import android.util.Log;
+
+import com.microsoft.ProjectOxford.DataRecognitionClient;
+import com.microsoft.ProjectOxford.ISpeechRecognitionServerEvents;
+import com.microsoft.ProjectOxford.RecognitionResult;
+import com.microsoft.ProjectOxford.RecognitionStatus;
+import com.microsoft.ProjectOxford.SpeechAudioFormat;
+import com.microsoft.ProjectOxford.SpeechRecognitionMode;
+import com.microsoft.ProjectOxford.SpeechRecognitionServiceFactory;
+
+/**
+ * Re-recognizes low confidence results with fallback languages or modes.
+ *
+ * The audio sent since the last final is kept in a bounded buffer.  Long dictation finals
+ * carry no offsets and arrive after the service has heard the pause that ends the utterance,
+ * often with the next utterance already under way, so the buffer is cut at the start of that
+ * pause (frames under -45 dBFS) and what follows stays for the next final.  When a final
+ * comes back as NoMatch or with Low/None confidence, the buffered audio is sent to one
+ * DataRecognitionClient per configured fallback, all in parallel, and the candidate with the
+ * best confidence wins, the original included.  If the buffer overflowed the audio is incomplete and no retry is made.
+ */
+public class ConfidenceRetry {
+
+    /** Score of a result without any phrase, below every Confidence value. */
+    public static final int NO_MATCH = -3;
+
+    static final int BYTES_PER_MS = AudioCapture.SAMPLE_RATE * 2 / 1000;
+    static final int FRAME_BYTES = AudioCapture.FRAME_SAMPLES * 2;
+    private static final float SPEECH_LEVEL = 0.0056f;     // -45 dBFS, as AudioQualityAnalyzer
+    private static final int PAUSE_FRAMES = 15;            // 300 ms
+
+    /**
+     * A recognized text and its score; the original result or a retry's.
+     */
+    public static class Candidate {
+        public final String text;
+        public final int confidence;
+        public final String language;
+        public final SpeechRecognitionMode mode;
+
+        Candidate(String text, int confidence, String language, SpeechRecognitionMode mode) {
+            this.text = text;
+            this.confidence = confidence;
+            this.language = language;
+            this.mode = mode;
+        }
+    }
+
+    static class Fallback {
+        final String language;
+        final SpeechRecognitionMode mode;
+
+        Fallback(String language, SpeechRecognitionMode mode) {
+            this.language = language;
+            this.mode = mode;
+        }
+    }
+
+    /**
+     * One retry session. Collects the finals until the session is over.
+     */
+    static class Attempt implements ISpeechRecognitionServerEvents, Runnable {
+        final Fallback m_fallback;
+        final byte[] m_audio;
+        final Activity m_activity;
+        final String m_key;
+        final int m_timeoutMs;
+        final CountDownLatch m_done = new CountDownLatch(1);
+        final StringBuilder m_text = new StringBuilder();
+        int m_confidence = NO_MATCH;
+
+        Attempt(Fallback fallback, byte[] audio, Activity activity, String key, int timeoutMs) {
+            m_fallback = fallback;
+            m_audio = audio;
+            m_activity = activity;
+            m_key = key;
+            m_timeoutMs = timeoutMs;
+        }
+
+        public void run() {
+            DataRecognitionClient client = SpeechRecognitionServiceFactory.createDataClient(m_activity,
+                    m_fallback.mode,
+                    m_fallback.language,
+                    this,
+                    m_key);
+            client.sendAudioFormat(SpeechAudioFormat.create16BitPCMFormat(AudioCapture.SAMPLE_RATE));
+            client.sendAudio(m_audio, m_audio.length);
+            client.endAudio();
+            try {
+                m_done.await(m_timeoutMs, TimeUnit.MILLISECONDS);
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+            }
+            client.dispose();
+        }
+
+        synchronized Candidate getCandidate() {
+            return new Candidate(m_text.toString(), m_confidence, m_fallback.language, m_fallback.mode);
+        }
+
+        public void onPartialResponseReceived(String response) {
+        }
+
+        public void onFinalResponseReceived(RecognitionResult response) {
+            boolean ended = m_fallback.mode == SpeechRecognitionMode.ShortPhrase ||
+                    response.RecognitionStatus == RecognitionStatus.EndOfDictation ||
+                    response.RecognitionStatus == RecognitionStatus.DictationEndSilenceTimeout;
+            int score = score(response);
+            if (score != NO_MATCH) {
+                // Long dictation may split the audio; its confidence is the weakest part's.
+                synchronized (this) {
+                    if (m_text.length() > 0) {
+                        m_text.append(' ');
+                    }
+                    m_text.append(response.Results[0].DisplayText);
+                    m_confidence = m_confidence == NO_MATCH ? score : Math.min(m_confidence, score);
+                }
+            }
+            if (ended) {
+                m_done.countDown();
+            }
+        }
+
+        public void onIntentReceived(String payload) {
+        }
+
+        public void onError(int errorCode, String response) {
+            Log.d("OxfordSpeechRecognition", "retry error " + errorCode + " " + response);
+            m_done.countDown();
+        }
+
+        public void onAudioEvent(boolean recording) {
+        }
+    }
+
+    private final ArrayList<Fallback> m_fallbacks = new ArrayList<Fallback>();
+    private int m_timeoutMs = 10000;
+    private SpeechRecognitionMode m_mode = SpeechRecognitionMode.ShortPhrase;
+
+    // Audio since the last final
+    private byte[] m_buffer = new byte[30000 * BYTES_PER_MS];
+    private int m_length = 0;
+    private boolean m_overflow = false;
+
+    // Pauses in the buffer, classified a frame at a time
+    private int m_scanned = 0;
+    private int m_quietFrames = 0;
+    private int m_pauseStart = -1;      // latest pause of PAUSE_FRAMES after speech
+    private boolean m_heardSpeech = false;
+
+    // Metrics
+    private int m_finals = 0;
+    private int m_retried = 0;
+    private int m_attempts = 0;
+    private int m_improved = 0;
+    private int m_skipped = 0;
+    private long m_addedMs = 0;
+    private long m_maxAddedMs = 0;
+
+    /**
+     * Reads the "retry" init option. Fallbacks default to the session's language and mode.
+     */
+    public void configure(JSONObject options, String language, SpeechRecognitionMode mode) {
+        m_mode = mode;
+        if (options == null) {
+            return;
+        }
+        m_timeoutMs = options.optInt("timeoutMs", m_timeoutMs);
+        m_buffer = new byte[options.optInt("maxBufferMs", 30000) * BYTES_PER_MS];
+        JSONArray fallbacks = options.optJSONArray("fallbacks");
+        for (int i = 0; fallbacks != null && i < fallbacks.length(); i++) {
+            JSONObject fallback = fallbacks.optJSONObject(i);
+            if (fallback == null) {
+                continue;
+            }
+            String fallbackMode = fallback.optString("mode", null);
+            m_fallbacks.add(new Fallback(fallback.optString("language", language),
+                    fallbackMode == null ? mode
+                            : "longDictation".equals(fallbackMode) ? SpeechRecognitionMode.LongDictation
+                            : SpeechRecognitionMode.ShortPhrase));
+        }
+    }
+
+    /**
+     * Buffers audio sent to the service.
+     */
+    public synchronized void write(byte[] audio, int length) {
+        if (m_length + length > m_buffer.length) {
+            m_overflow = true;
+            return;
+        }
+        System.arraycopy(audio, 0, m_buffer, m_length, length);
+        m_length += length;
+        if (m_mode == SpeechRecognitionMode.LongDictation) {
+            scan();
+        }
+    }
+
+    public synchronized void clear() {
+        m_length = 0;
+        m_overflow = false;
+        m_scanned = 0;
+        m_quietFrames = 0;
+        m_pauseStart = -1;
+        m_heardSpeech = false;
+    }
+
+    /**
+     * Takes the audio of the utterance a final is for, returning a copy of it if a retry is
+     * wanted. Returns null if there is nothing complete to retry with, or if the audio is
+     * longer than the timeout: the service takes it at the audio rate, so such a retry could
+     * not finish in time and would only hold back the finals after it.
+     */
+    public synchronized byte[] takeAudio(boolean wanted) {
+        int end = m_overflow ? m_length : utteranceEnd();
+        byte[] audio = null;
+        if (wanted && (m_overflow || end / BYTES_PER_MS > m_timeoutMs)) {
+            m_skipped++;
+        } else if (wanted && end > 0) {
+            audio = new byte[end];
+            System.arraycopy(m_buffer, 0, audio, 0, end);
+        }
+        if (end == m_length) {
+            clear();
+        } else {
+            // The rest is the pause and whatever was said after it.
+            System.arraycopy(m_buffer, end, m_buffer, 0, m_length - end);
+            m_length -= end;
+            m_scanned -= end;
+            m_pauseStart = -1;
+            m_heardSpeech = m_quietFrames == 0;
+        }
+        return audio;
+    }
+
+    /**
+     * Where the utterance of the current final ends: at the start of the pause going on now,
+     * or, if speech has resumed, of the latest long pause. Short phrase sessions end at their
+     * final, so all of the audio is theirs.
+     */
+    private int utteranceEnd() {
+        if (m_mode != SpeechRecognitionMode.LongDictation || !m_heardSpeech) {
+            return m_length;
+        }
+        if (m_quietFrames > 0) {
+            return m_scanned - m_quietFrames * FRAME_BYTES;
+        }
+        return m_pauseStart > 0 ? m_pauseStart : m_length;
+    }
+
+    /**
+     * Classifies the whole frames written since the last scan as speech or quiet.
+     */
+    private void scan() {
+        for (; m_scanned + FRAME_BYTES <= m_length; m_scanned += FRAME_BYTES) {
+            long energy = 0;
+            for (int i = m_scanned; i < m_scanned + FRAME_BYTES; i += 2) {
+                int sample = (short) ((m_buffer[i] & 0xff) | (m_buffer[i + 1] << 8));
+                energy += sample * sample;
+            }
+            float rms = (float) Math.sqrt((double) energy / AudioCapture.FRAME_SAMPLES) / 32768f;
+            if (rms >= SPEECH_LEVEL) {
+                m_quietFrames = 0;
+                m_heardSpeech = true;
+            } else if (++m_quietFrames == PAUSE_FRAMES && m_heardSpeech) {
+                m_pauseStart = m_scanned - (PAUSE_FRAMES - 1) * FRAME_BYTES;
+            }
+        }
+    }
+
+    public static int score(RecognitionResult response) {
+        return score(response, 0);
+    }
+
+    /**
+     * Scores the given phrase of a final, e.g. the one the context booster picked.
+     */
+    public static int score(RecognitionResult response, int phrase) {
+        if (response.RecognitionStatus == RecognitionStatus.NoMatch ||
+                response.Results == null || response.Results.length <= phrase) {
+            return NO_MATCH;
+        }
+        return response.Results[phrase].Confidence.getValue();
+    }
+
+    /**
+     * Whether the delivered phrase of a final is weak enough to retry: NoMatch, None or Low
+     * confidence.
+     */
+    public boolean shouldRetry(RecognitionResult response, int phrase) {
+        synchronized (this) {
+            m_finals++;
+        }
+        return !m_fallbacks.isEmpty() && score(response, phrase) < 0;
+    }
+
+    /**
+     * Runs every fallback on the audio in parallel and returns the best candidate. Blocks
+     * until all attempts are done or the timeout has passed; ties go to the original.
+     */
+    public Candidate retry(Activity activity, String key, byte[] audio, Candidate original, Executor executor) {
+        long start = System.currentTimeMillis();
+        ArrayList<Attempt> attempts = new ArrayList<Attempt>();
+        for (Fallback fallback : m_fallbacks) {
+            Attempt attempt = new Attempt(fallback, audio, activity, key, m_timeoutMs);
+            attempts.add(attempt);
+            executor.execute(attempt);
+        }
+
+        Candidate best = original;
+        long deadline = start + m_timeoutMs;
+        for (Attempt attempt : attempts) {
+            try {
+                attempt.m_done.await(Math.max(0, deadline - System.currentTimeMillis()), TimeUnit.MILLISECONDS);
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+                break;
+            }
+            Candidate candidate = attempt.getCandidate();
+            if (candidate.confidence > best.confidence) {
+                best = candidate;
+            }
+        }
+
+        long added = System.currentTimeMillis() - start;
+        synchronized (this) {
+            m_retried++;
+            m_attempts += attempts.size();
+            if (best != original) {
+                m_improved++;
+            }
+            m_addedMs += added;
+            m_maxAddedMs = Math.max(m_maxAddedMs, added);
+        }
+        Log.d("OxfordSpeechRecognition", "retry " + (best != original ? "improved" : "kept") + " in " + added + " ms");
+        return best;
+    }
+
+    public synchronized JSONObject toJSON() {
+        JSONObject metrics = new JSONObject();
+        try {
+            metrics.put("finals", m_finals);
+            metrics.put("retried", m_retried);
+            metrics.put("attempts", m_attempts);
+            metrics.put("improved", m_improved);
+            metrics.put("skipped", m_skipped);
+            metrics.put("improvementRate", m_retried > 0 ? (double) m_improved / m_retried : 0);
+            metrics.put("addedLatencyMs", m_addedMs);
+            metrics.put("avgAddedLatencyMs", m_retried > 0 ? m_addedMs / m_retried : 0);
+            metrics.put("maxAddedLatencyMs", m_maxAddedMs);
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        return metrics;
+    }
+}
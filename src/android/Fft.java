@@ -0,0 +1,101 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+/**
+ * In-place radix-2 complex FFT with precomputed twiddles, so transforms on the
+ * audio thread don't allocate.
+ */
+public class Fft {
+
+    private final int m_size;
+    private final int[] m_bitReverse;
+    private final float[] m_cos;
+    private final float[] m_sin;
+
+    public Fft(int size) {
+        if (Integer.bitCount(size) != 1) {
+            throw new IllegalArgumentException("FFT size must be a power of two: " + size);
+        }
+        m_size = size;
+        m_bitReverse = new int[size];
+        m_cos = new float[size / 2];
+        m_sin = new float[size / 2];
+
+        int bits = Integer.numberOfTrailingZeros(size);
+        for (int i = 0; i < size; i++) {
+            m_bitReverse[i] = Integer.reverse(i) >>> (32 - bits);
+        }
+        for (int i = 0; i < size / 2; i++) {
+            m_cos[i] = (float) Math.cos(-2 * Math.PI * i / size);
+            m_sin[i] = (float) Math.sin(-2 * Math.PI * i / size);
+        }
+    }
+
+    public int size() {
+        return m_size;
+    }
+
+    /**
+     * Transforms re/im in place. The inverse transform is scaled by 1/size.
+     */
+    public void transform(float[] re, float[] im, boolean inverse) {
+        int n = m_size;
+        for (int i = 0; i < n; i++) {
+            int j = m_bitReverse[i];
+            if (j > i) {
+                float t = re[i];
+                re[i] = re[j];
+                re[j] = t;
+                t = im[i];
+                im[i] = im[j];
+                im[j] = t;
+            }
+        }
+
+        float sign = inverse ? -1f : 1f;
+        for (int length = 2; length <= n; length <<= 1) {
+            int half = length >> 1;
+            int stride = n / length;
+            for (int start = 0; start < n; start += length) {
+                for (int k = 0; k < half; k++) {
+                    float wr = m_cos[k * stride];
+                    float wi = sign * m_sin[k * stride];
+                    int a = start + k;
+                    int b = a + half;
+                    float xr = re[b] * wr - im[b] * wi;
+                    float xi = re[b] * wi + im[b] * wr;
+                    re[b] = re[a] - xr;
+                    im[b] = im[a] - xi;
+                    re[a] += xr;
+                    im[a] += xi;
+                }
+            }
+        }
+
+        if (inverse) {
+            float scale = 1f / n;
+            for (int i = 0; i < n; i++) {
+                re[i] *= scale;
+                im[i] *= scale;
+            }
+        }
+    }
+}
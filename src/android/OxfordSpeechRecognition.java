@@ -19,13 +19,22 @@ ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEAL
 
 package com.projectoxford.cordova.speechrecognition;
 
+import java.io.File;
+import java.io.IOException;
+import java.util.ArrayDeque;
 import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Locale;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.atomic.AtomicInteger;
 
 import org.json.JSONArray;
 import org.json.JSONException;
 import org.json.JSONObject;
 
 import org.apache.cordova.CallbackContext;
+import org.apache.cordova.CordovaArgs;
 import org.apache.cordova.CordovaPlugin;
 import org.apache.cordova.PluginResult;
 
@@ -43,25 +52,101 @@ import com.microsoft.ProjectOxford.MicrophoneRecognitionClient;
 import com.microsoft.ProjectOxford.MicrophoneRecognitionClientWithIntent;
 import com.microsoft.ProjectOxford.RecognitionResult;
 import com.microsoft.ProjectOxford.RecognitionStatus;
+import com.microsoft.ProjectOxford.SpeechAudioFormat;
 import com.microsoft.ProjectOxford.SpeechRecognitionMode;
 import com.microsoft.ProjectOxford.SpeechRecognitionServiceFactory;
 
-import java.io.IOException;
 import java.io.InputStream;
 
-public class OxfordSpeechRecognition extends CordovaPlugin implements ISpeechRecognitionServerEvents {
+public class OxfordSpeechRecognition extends CordovaPlugin
+        implements ISpeechRecognitionServerEvents, AudioCapture.Listener, SessionReplayer.Listener,
+        AudioPushQueue.Listener, AudioSendGate.Listener {
 
     public static final String ACTION_INIT = "init";
     public static final String ACTION_SPEECH_RECOGNIZE_START = "start";
     public static final String ACTION_SPEECH_RECOGNIZE_STOP = "stop";
     public static final String ACTION_SPEECH_RECOGNIZE_ABORT = "abort";
+    public static final String ACTION_REPLAY = "replay";
+    public static final String ACTION_LIST_RECORDINGS = "listRecordings";
+    public static final String ACTION_START_AUDIO = "startAudio";
+    public static final String ACTION_PUSH_AUDIO = "pushAudio";
+    public static final String ACTION_END_AUDIO = "endAudio";
+    public static final String ACTION_GET_TRANSCRIPT = "getTranscript";
+    public static final String ACTION_GET_METRICS = "getMetrics";
+    public static final String ACTION_UPDATE_CONTEXT = "updateContext";
+    public static final String ACTION_SET_VOCABULARY = "setVocabulary";
+    public static final String ACTION_GET_COMPLETIONS = "getCompletions";
+    public static final String ACTION_PREPARE = "prepare";
 
-    private CallbackContext speechRecognizerCallbackContext;
+    private volatile CallbackContext speechRecognizerCallbackContext;
 
     int m_waitSeconds = 0;
-    DataRecognitionClient m_dataClient = null;
+    // Swapped on the capture thread at a turn change with one session per turn.
+    volatile DataRecognitionClient m_dataClient = null;
     MicrophoneRecognitionClient m_micClient = null;
     SpeechRecognitionMode m_recoMode;
+    String m_language;
+    String m_primaryKey;
+
+    // Plugin-owned capture path, used instead of the microphone client when the
+    // audio has to be inspected before it is sent to the service.
+    boolean m_useCapture = false;
+    AudioCapture m_capture = null;
+    AudioQualityAnalyzer m_qualityAnalyzer = null;
+    AudioPreprocessor m_preprocessor = null;
+    int m_reportedIssues = 0;
+    byte[] m_frameBytes = new byte[AudioCapture.FRAME_SAMPLES * 2];
+
+    // Opt-in session recording, see SessionRecorder for the container format.
+    File m_recordingDir = null;
+    int m_maxRecordings = 20;
+    // Closed and cleared from the service callback thread; read it into a local before use.
+    volatile SessionRecorder m_recorder = null;
+
+    // Speaker turns for long dictation. With one session per turn, the sessions that
+    // have not delivered EndOfDictation yet are kept in order, the live one last.
+    TurnSegmenter m_turnSegmenter = null;
+    long m_lastFinalSample = 0;
+    final ArrayDeque<TurnSession> m_turnSessions = new ArrayDeque<TurnSession>();
+
+    // Audio pushed from JS, see AudioPushQueue. Sizes are in bytes of 16 kHz 16-bit PCM.
+    AudioPushQueue m_pushQueue = null;
+    int m_pushCapacity = 512 * 1024;
+    int m_pushHighWater = 256 * 1024;
+    int m_pushLowWater = 64 * 1024;
+
+    // Native transcript; with it partials and finals are also delivered as edit operations.
+    Transcript m_transcript = null;
+
+    // Confidence-driven retry. Finals go through a single thread while it is enabled.
+    ConfidenceRetry m_retry = null;
+    ExecutorService m_finalDelivery = null;
+
+    // N-best rescoring against the user vocabulary, kept as a memory mapped trie.
+    PhraseBooster m_booster = null;
+
+    // Typeahead over past finals; partials are answered with completions from it.
+    TypeaheadIndex m_typeahead = null;
+    String m_lastCompletions = null;
+
+    // Battery, thermal and network aware profile, chosen at the start of every session.
+    PipelineGovernor m_governor = null;
+    AudioSendGate m_sendGate = null;
+
+    // init only reads the configuration; the client and the mapped indexes are created by
+    // prepare(), either explicitly in the background or by the first session.
+    volatile boolean m_prepared = false;
+    String m_prepareTrigger = null;
+    long m_initNanos = 0;
+    long m_prepareNanos = 0;
+    long m_indexNanos = 0;
+    long m_clientNanos = 0;
+    long m_firstSessionWaitNanos = -1;
+
+    // A session that would wait for prepare is started here instead of on the bridge thread;
+    // the session actions after it are queued behind it until the queue is empty again.
+    final ExecutorService m_sessionActions = Executors.newSingleThreadExecutor();
+    final AtomicInteger m_queuedSessionActions = new AtomicInteger();
 
     /*
     @Override
@@ -78,24 +163,105 @@ public class OxfordSpeechRecognition extends CordovaPlugin implements ISpeechRec
         // Dispatcher
         if (ACTION_INIT.equals(action)) {
             Log.d("OxfordSpeechRecognition", "initialize");
-            // init
-            initializeRecoClient(args);
+            // init, in order with the session actions queued before it, whose objects it replaces
+            final JSONArray initArgs = args;
+            runSessionAction(false, new Runnable() {
+                public void run() {
+                    initializeRecoClient(initArgs);
+                }
+            });
+        } else if (ACTION_PREPARE.equals(action)) {
+            final CallbackContext prepareContext = callbackContext;
+            cordova.getThreadPool().execute(new Runnable() {
+                public void run() {
+                    prepare(ACTION_PREPARE);
+                    prepareContext.success(getStartup());
+                }
+            });
         } else if (ACTION_SPEECH_RECOGNIZE_START.equals(action)) {
-            Log.d("OxfordSpeechRecognition", "start - 1");
-            speechRecognizerCallbackContext = callbackContext;
-            // Speech recognition from the microphone.  The microphone is turned on and data from the microphone
-            // is sent to the Speech Recognition Service.  A built in Silence Detector
-            // is applied to the microphone data before it is sent to the recognition service.
-            m_micClient.startMicAndRecognition();
-            Log.d("OxfordSpeechRecognition", "start - 2");
-
-            PluginResult pr = new PluginResult(PluginResult.Status.NO_RESULT);
-            pr.setKeepCallback(true);
-            callbackContext.sendPluginResult(pr);
+            final CallbackContext startContext = callbackContext;
+            runSessionAction(true, new Runnable() {
+                public void run() {
+                    start(startContext);
+                }
+            });
         } else if (ACTION_SPEECH_RECOGNIZE_STOP.equals(action)) {
-            stop(false);
+            runSessionAction(false, new Runnable() {
+                public void run() {
+                    stop(false);
+                }
+            });
         } else if (ACTION_SPEECH_RECOGNIZE_ABORT.equals(action)) {
-            stop(true);
+            runSessionAction(false, new Runnable() {
+                public void run() {
+                    stop(true);
+                }
+            });
+        } else if (ACTION_REPLAY.equals(action)) {
+            final JSONArray replayArgs = args;
+            final CallbackContext replayContext = callbackContext;
+            runSessionAction(true, new Runnable() {
+                public void run() {
+                    prepareForSession(ACTION_REPLAY);
+                    speechRecognizerCallbackContext = replayContext;
+                    resetTranscript();
+                    replay(replayArgs);
+                    PluginResult pr = new PluginResult(PluginResult.Status.NO_RESULT);
+                    pr.setKeepCallback(true);
+                    replayContext.sendPluginResult(pr);
+                }
+            });
+        } else if (ACTION_LIST_RECORDINGS.equals(action)) {
+            callbackContext.success(listRecordings());
+        } else if (ACTION_START_AUDIO.equals(action)) {
+            final CallbackContext startContext = callbackContext;
+            runSessionAction(true, new Runnable() {
+                public void run() {
+                    prepareForSession(ACTION_START_AUDIO);
+                    speechRecognizerCallbackContext = startContext;
+                    resetTranscript();
+                    applyGovernor();
+                    startPushSession();
+                    PluginResult pr = new PluginResult(PluginResult.Status.NO_RESULT);
+                    pr.setKeepCallback(true);
+                    startContext.sendPluginResult(pr);
+                }
+            });
+        } else if (ACTION_PUSH_AUDIO.equals(action)) {
+            final JSONArray pushArgs = args;
+            final CallbackContext pushContext = callbackContext;
+            runSessionAction(false, new Runnable() {
+                public void run() {
+                    pushAudio(pushArgs, pushContext);
+                }
+            });
+        } else if (ACTION_END_AUDIO.equals(action)) {
+            final CallbackContext endContext = callbackContext;
+            runSessionAction(false, new Runnable() {
+                public void run() {
+                    if (m_pushQueue != null) {
+                        m_pushQueue.end();
+                    }
+                    endContext.success();
+                }
+            });
+        } else if (ACTION_GET_TRANSCRIPT.equals(action)) {
+            callbackContext.success(getTranscript(args));
+        } else if (ACTION_GET_METRICS.equals(action)) {
+            callbackContext.success(getMetrics());
+        } else if (ACTION_UPDATE_CONTEXT.equals(action)) {
+            // The Android SDK keeps ConversationBase's sendText and setLocation private.
+            Log.d("OxfordSpeechRecognition", "context is not supported by the Android SDK");
+            callbackContext.error("unsupported");
+        } else if (ACTION_SET_VOCABULARY.equals(action)) {
+            setVocabulary(args.optJSONArray(0), callbackContext);
+        } else if (ACTION_GET_COMPLETIONS.equals(action)) {
+            if (m_typeahead == null) {
+                callbackContext.success(new JSONArray());
+            } else {
+                int limit = args.optInt(1, m_typeahead.getLimit());
+                callbackContext.success(TypeaheadIndex.toJSON(m_typeahead.query(args.optString(0), limit)));
+            }
         } else {
             // Invalid action
             String res = "Unknown action: " + action;
@@ -104,9 +270,71 @@ public class OxfordSpeechRecognition extends CordovaPlugin implements ISpeechRec
         return true;
     }
 
+    /**
+     * Runs a session action on the bridge thread, unless a session is still queued waiting for
+     * prepare: then it is queued behind it, so start, push and stop keep their order. A session
+     * start that would itself wait for prepare is queued rather than blocking the bridge thread.
+     */
+    void runSessionAction(boolean needsPrepare, final Runnable action) {
+        if (m_queuedSessionActions.get() == 0 && (!needsPrepare || m_prepared)) {
+            action.run();
+            return;
+        }
+        m_queuedSessionActions.incrementAndGet();
+        m_sessionActions.execute(new Runnable() {
+            public void run() {
+                try {
+                    action.run();
+                } finally {
+                    m_queuedSessionActions.decrementAndGet();
+                }
+            }
+        });
+    }
+
+    void start(CallbackContext callbackContext) {
+        Log.d("OxfordSpeechRecognition", "start - 1");
+        prepareForSession(ACTION_SPEECH_RECOGNIZE_START);
+        speechRecognizerCallbackContext = callbackContext;
+        resetTranscript();
+        applyGovernor();
+        if (m_useCapture) {
+            startCaptureSession();
+            PluginResult pr = new PluginResult(PluginResult.Status.NO_RESULT);
+            pr.setKeepCallback(true);
+            callbackContext.sendPluginResult(pr);
+            return;
+        }
+        // Speech recognition from the microphone.  The microphone is turned on and data from the microphone
+        // is sent to the Speech Recognition Service.  A built in Silence Detector
+        // is applied to the microphone data before it is sent to the recognition service.
+        m_micClient.startMicAndRecognition();
+        Log.d("OxfordSpeechRecognition", "start - 2");
+
+        PluginResult pr = new PluginResult(PluginResult.Status.NO_RESULT);
+        pr.setKeepCallback(true);
+        callbackContext.sendPluginResult(pr);
+    }
+
     private void stop(boolean abort) {
         Log.d("OxfordSpeechRecognition", "end");
 
+        if (m_pushQueue != null) {
+            if (abort) {
+                m_pushQueue.cancel();
+                m_pushQueue = null;
+                m_dataClient.endAudio();
+            } else {
+                m_pushQueue.end();
+            }
+            return;
+        }
+
+        if (m_useCapture) {
+            stopCaptureSession();
+            return;
+        }
+
         boolean isReceivedResponse = false;
         if (m_micClient != null) {
             isReceivedResponse = m_micClient.waitForFinalResponse(m_waitSeconds);
@@ -118,44 +346,250 @@ public class OxfordSpeechRecognition extends CordovaPlugin implements ISpeechRec
 
     public void onPartialResponseReceived(final String response) {
         Log.d("OxfordSpeechRecognition", "partial");
+        SessionRecorder recorder = m_recorder;
+        if (recorder != null) {
+            recorder.writeText(SessionRecorder.RECORD_PARTIAL, response);
+        }
+        if (m_governor != null && !m_governor.allowPartial()) {
+            // A later partial or the final replaces this one anyway.
+            return;
+        }
+        if (m_retry != null) {
+            // Keep partials behind a final that is still being retried, or they would show
+            // up ahead of it and its transcript insert would land after their tail.
+            m_finalDelivery.execute(new Runnable() {
+                public void run() {
+                    sendPartialResult(response);
+                }
+            });
+            return;
+        }
+        sendPartialResult(response);
+    }
 
+    /**
+     * Sends a partial to JS, as a transcript tail edit if there is a transcript.
+     */
+    void sendPartialResult(String response) {
         JSONObject event = new JSONObject();
         try {
-            event.put("partial", response);
+            if (m_transcript != null) {
+                // Only the tail changes, so don't resend the transcript.
+                m_transcript.setTail(response);
+                event.put("edit", Transcript.edit(Transcript.OP_TAIL, -1, response));
+            } else {
+                event.put("partial", response);
+            }
         } catch (JSONException e) {
             // this will never happen
         }
         PluginResult pr = new PluginResult(PluginResult.Status.OK, event);
         pr.setKeepCallback(true);
         speechRecognizerCallbackContext.sendPluginResult(pr);
+
+        if (m_typeahead != null) {
+            sendCompletions(response);
+        }
+    }
+
+    /**
+     * Offers completions of a partial from the typeahead index. Only sent when they change.
+     */
+    void sendCompletions(String partial) {
+        JSONArray completions = TypeaheadIndex.toJSON(m_typeahead.query(partial, m_typeahead.getLimit()));
+        String key = completions.toString();
+        if (key.equals(m_lastCompletions)) {
+            return;
+        }
+        m_lastCompletions = key;
+
+        JSONObject event = new JSONObject();
+        try {
+            event.put("completions", completions);
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        PluginResult pr = new PluginResult(PluginResult.Status.OK, event);
+        pr.setKeepCallback(true);
+        speechRecognizerCallbackContext.sendPluginResult(pr);
+    }
+
+    /**
+     * Writes the phrases counted since the last launch into the typeahead file, off the
+     * service thread.
+     */
+    void persistTypeahead() {
+        final TypeaheadIndex typeahead = m_typeahead;
+        cordova.getThreadPool().execute(new Runnable() {
+            public void run() {
+                typeahead.persist();
+            }
+        });
     }
 
     public void onFinalResponseReceived(final RecognitionResult response) {
+        onFinalResponseReceived(response, null);
+    }
+
+    /**
+     * Handles a final, from the turn session that produced it if there is one session per turn.
+     */
+    void onFinalResponseReceived(final RecognitionResult response, TurnSession session) {
         Log.d("OxfordSpeechRecognition", "final");
         boolean isFinalDicationMessage = m_recoMode == SpeechRecognitionMode.LongDictation &&
                 (response.RecognitionStatus == RecognitionStatus.EndOfDictation ||
                         response.RecognitionStatus == RecognitionStatus.DictationEndSilenceTimeout);
-        if ((m_recoMode == SpeechRecognitionMode.ShortPhrase) || isFinalDicationMessage) {
+        SessionRecorder recorder = m_recorder;
+        if (recorder != null) {
+            recorder.writeText(SessionRecorder.RECORD_FINAL, resultToJSON(response).toString());
+        }
+
+        boolean isDictationEnded = isFinalDicationMessage;
+        TurnSegmenter.Turn turn = null;
+        if (session != null) {
+            turn = session.turn;
+            if (isFinalDicationMessage) {
+                synchronized (m_turnSessions) {
+                    m_turnSessions.remove(session);
+                    // Only the last open session ending finishes the dictation.
+                    isDictationEnded = m_turnSessions.isEmpty();
+                }
+                session.dispose();
+            }
+        } else if (m_turnSegmenter != null) {
+            // Attribute the final to the turn in the middle of the audio it covers.
+            long samples = m_turnSegmenter.getSamples();
+            turn = m_turnSegmenter.turnAt((m_lastFinalSample + samples) / 2);
+            m_lastFinalSample = samples;
+        }
+
+        if ((m_recoMode == SpeechRecognitionMode.ShortPhrase) || isDictationEnded) {
             // we got the final result, so it we can end the mic reco.  No need to do this
             // for dataReco, since we already called endAudio() on it as soon as we were done
             // sending all the data.
-            m_micClient.endMicAndRecognition();
+            if (m_micClient != null) {
+                m_micClient.endMicAndRecognition();
+            }
+            if (m_capture != null) {
+                // Don't join the capture thread from the service callback.
+                final AudioCapture capture = m_capture;
+                m_capture = null;
+                cordova.getThreadPool().execute(new Runnable() {
+                    public void run() {
+                        capture.stop();
+                    }
+                });
+            }
+            boolean pushed = m_pushQueue != null;
+            if (pushed) {
+                // The service is done with this session, drop anything still queued.
+                m_pushQueue.cancel();
+                m_pushQueue = null;
+            }
+            closeRecorder();
+            if (m_typeahead != null) {
+                persistTypeahead();
+            }
+            sendSessionEnd(pushed);
         }
 
         if ((m_recoMode == SpeechRecognitionMode.ShortPhrase) || isFinalDicationMessage) {
             //speechRecognizerCallbackContext.sendPluginResult(pr); 
         }
 
-        JSONObject event = new JSONObject();
         String result = "";
+        int phrase = 0;
         if (!isFinalDicationMessage && response.Results.length > 0) {
             //for (int i = 0; i < response.Results.length; i++) {
             //response.Results[i].DisplayText;
             //}
-            result = response.Results[0].DisplayText;
+            phrase = m_booster != null ? m_booster.choose(response) : 0;
+            result = response.Results[phrase].DisplayText;
         }
+
+        if (m_retry == null) {
+            sendFinalResult(result, turn, null);
+            return;
+        }
+
+        // Finals are delivered in order on one thread, so a retried final holds back the
+        // ones after it instead of being overtaken.
+        final boolean weak = !isFinalDicationMessage && m_retry.shouldRetry(response, phrase);
+        final byte[] audio = m_retry.takeAudio(weak);
+        final String originalText = result;
+        final int originalScore = ConfidenceRetry.score(response, phrase);
+        final TurnSegmenter.Turn resultTurn = turn;
+        m_finalDelivery.execute(new Runnable() {
+            public void run() {
+                if (audio == null) {
+                    sendFinalResult(originalText, resultTurn, null);
+                    return;
+                }
+                ConfidenceRetry.Candidate original = new ConfidenceRetry.Candidate(originalText, originalScore,
+                        m_language, m_recoMode);
+                ConfidenceRetry.Candidate best = m_retry.retry(cordova.getActivity(), m_primaryKey, audio,
+                        original, cordova.getThreadPool());
+                JSONObject retry = new JSONObject();
+                try {
+                    retry.put("improved", best != original);
+                    retry.put("language", best.language);
+                    retry.put("mode", best.mode == SpeechRecognitionMode.LongDictation ? "longDictation" : "shortPhrase");
+                    retry.put("confidence", best.confidence);
+                } catch (JSONException e) {
+                    // this will never happen
+                }
+                sendFinalResult(best.text, resultTurn, retry);
+            }
+        });
+    }
+
+    /**
+     * Sends a final result to JS and adds it to the transcript.
+     */
+    void sendFinalResult(String result, TurnSegmenter.Turn turn, JSONObject retry) {
+        JSONObject event = new JSONObject();
         try {
             event.put("result", result);
+            if (turn != null) {
+                event.put("turn", turn.toJSON());
+            }
+            if (retry != null) {
+                event.put("retry", retry);
+            }
+            if (m_transcript != null) {
+                int segment = m_transcript.append(result);
+                if (segment >= 0) {
+                    event.put("segment", segment);
+                }
+                sendTranscriptEdit(segment >= 0
+                        ? Transcript.edit(Transcript.OP_INSERT, segment, result)
+                        : Transcript.edit(Transcript.OP_TAIL, -1, ""));
+            }
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        PluginResult pr = new PluginResult(PluginResult.Status.OK, event);
+        pr.setKeepCallback(true);
+        speechRecognizerCallbackContext.sendPluginResult(pr);
+
+        if (m_typeahead != null) {
+            m_lastCompletions = null;
+            if (m_typeahead.add(result, 1)) {
+                persistTypeahead();
+            }
+        }
+    }
+
+    void resetTranscript() {
+        if (m_transcript != null) {
+            m_transcript.reset();
+        }
+    }
+
+    void sendTranscriptEdit(JSONObject edit) {
+        JSONObject event = new JSONObject();
+        try {
+            event.put("edit", edit);
         } catch (JSONException e) {
             // this will never happen
         }
@@ -164,45 +598,871 @@ public class OxfordSpeechRecognition extends CordovaPlugin implements ISpeechRec
         speechRecognizerCallbackContext.sendPluginResult(pr);
     }
 
+    File vocabularyFile() {
+        return new File(cordova.getActivity().getFilesDir(), "oxford-vocabulary.trie");
+    }
+
+    File typeaheadFile() {
+        return new File(cordova.getActivity().getFilesDir(), "oxford-typeahead.trie");
+    }
+
+    /**
+     * Replaces the booster vocabulary. Entries are phrases or {text, weight} objects; the trie
+     * is built and mapped on the thread pool and kept for the next launch.
+     */
+    void setVocabulary(final JSONArray phrases, final CallbackContext callbackContext) {
+        // Without the booster option the vocabulary is only stored, for a later init with it.
+        final PhraseBooster booster = m_booster;
+        cordova.getThreadPool().execute(new Runnable() {
+            public void run() {
+                int count = phrases != null ? phrases.length() : 0;
+                String[] keys = new String[count];
+                int[] weights = new int[count];
+                int n = 0;
+                for (int i = 0; i < count; i++) {
+                    JSONObject entry = phrases.optJSONObject(i);
+                    String text = entry != null ? entry.optString("text") : phrases.optString(i);
+                    String key = text.trim().replaceAll("\\s+", " ").toLowerCase(Locale.ROOT);
+                    if (key.length() > 0) {
+                        keys[n] = key;
+                        weights[n] = Math.max(1, entry != null ? entry.optInt("weight", 1) : 1);
+                        n++;
+                    }
+                }
+                try {
+                    File file = vocabularyFile();
+                    CompactTrie.write(file, Arrays.copyOf(keys, n), Arrays.copyOf(weights, n));
+                    CompactTrie trie = CompactTrie.load(file);
+                    if (booster != null) {
+                        booster.setVocabulary(trie);
+                    }
+
+                    JSONObject info = new JSONObject();
+                    info.put("phrases", n);
+                    info.put("nodes", trie.getNodeCount());
+                    info.put("boosting", booster != null);
+                    callbackContext.success(info);
+                } catch (IOException e) {
+                    Log.d("OxfordSpeechRecognition", "vocabulary write failed " + e);
+                    callbackContext.error(e.toString());
+                } catch (JSONException e) {
+                    // this will never happen
+                }
+            }
+        });
+    }
+
+    /**
+     * Collects the metrics of the enabled features, keyed by feature.
+     */
+    JSONObject getMetrics() {
+        JSONObject metrics = new JSONObject();
+        try {
+            if (m_retry != null) {
+                metrics.put("retry", m_retry.toJSON());
+            }
+            if (m_booster != null) {
+                metrics.put("booster", m_booster.toJSON());
+            }
+            if (m_typeahead != null) {
+                metrics.put("typeahead", m_typeahead.toJSON());
+            }
+            if (m_governor != null) {
+                metrics.put("governor", m_governor.toJSON());
+            }
+            metrics.put("startup", getStartup());
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        return metrics;
+    }
+
+    /**
+     * Returns the transcript text, or the [start, end) range of it if given.
+     */
+    JSONObject getTranscript(JSONArray args) {
+        JSONObject transcript = new JSONObject();
+        try {
+            if (m_transcript == null) {
+                transcript.put("text", "");
+                transcript.put("length", 0);
+                transcript.put("segments", 0);
+                return transcript;
+            }
+            synchronized (m_transcript) {
+                int length = m_transcript.length();
+                int start = args.optInt(0, 0);
+                int end = args.isNull(1) ? length : args.optInt(1, length);
+                transcript.put("text", m_transcript.getText(start, end));
+                transcript.put("length", length);
+                transcript.put("segments", m_transcript.getSegmentCount());
+            }
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        return transcript;
+    }
+
     /**
      * Invoked when the audio recording state has changed.
      *
      * @param recording The current recording state
      */
     public void onAudioEvent(boolean recording) {
-        if (!recording) {
+        SessionRecorder recorder = m_recorder;
+        if (recorder != null) {
+            recorder.writeText(SessionRecorder.RECORD_AUDIO_EVENT, recording ? "1" : "0");
+        }
+        if (!recording && m_micClient != null) {
             m_micClient.endMicAndRecognition();
         }
     }
 
     public void onError(final int errorCode, final String response) {
+        SessionRecorder recorder = m_recorder;
+        if (recorder != null) {
+            recorder.writeText(SessionRecorder.RECORD_ERROR, errorCode + " " + response);
+        }
     }
 
     /**
      * Called when a final response is received and its intent is parsed
      */
     public void onIntentReceived(final String payload) {
+        SessionRecorder recorder = m_recorder;
+        if (recorder != null) {
+            recorder.writeText(SessionRecorder.RECORD_INTENT, payload);
+        }
     }
 
     void initializeRecoClient(JSONArray args) {
-        try {
-            // Set the mode and microphone flag to your liking   
-            m_recoMode = SpeechRecognitionMode.ShortPhrase;
-            m_waitSeconds = m_recoMode == SpeechRecognitionMode.ShortPhrase ? 20 : 200;
+        long start = System.nanoTime();
+        // A session still running on the old configuration ends here.
+        if (m_capture != null) {
+            m_capture.stop();
+            m_capture = null;
+        }
+        if (m_pushQueue != null) {
+            m_pushQueue.cancel();
+            m_pushQueue = null;
+        }
+        synchronized (this) {
+            // A new configuration has to be prepared again, as on iOS.
+            m_prepared = false;
+            m_prepareTrigger = null;
+            m_firstSessionWaitNanos = -1;
 
+            // The clients were made for the old language, key and mode.
+            if (m_micClient != null) {
+                m_micClient.dispose();
+                m_micClient = null;
+            }
+
+            // Features the new options leave out are off.
+            m_useCapture = false;
+            m_qualityAnalyzer = null;
+            m_preprocessor = null;
+            m_recordingDir = null;
+            m_turnSegmenter = null;
+            m_retry = null;
+            m_booster = null;
+            m_governor = null;
+            m_typeahead = null;
+            m_transcript = null;
+        }
+        closeTurnSessions();
+        if (m_dataClient != null) {
+            m_dataClient.dispose();
+            m_dataClient = null;
+        }
+        try {
             String language = args.getString(0);
             String primaryOrSecondaryKey = args.getString(1);
             //String luisAppID = args.getString(2);
             //String luisSubscriptionID = args.getString(3);
+            JSONObject options = args.optJSONObject(4);
+
+            // Set the mode and microphone flag to your liking   
+            m_recoMode = options != null && "longDictation".equals(options.optString("mode"))
+                    ? SpeechRecognitionMode.LongDictation
+                    : SpeechRecognitionMode.ShortPhrase;
+            m_waitSeconds = m_recoMode == SpeechRecognitionMode.ShortPhrase ? 20 : 200;
+
+            m_language = language;
+            m_primaryKey = primaryOrSecondaryKey;
+
+            if (options != null && options.has("audioQuality")) {
+                m_qualityAnalyzer = new AudioQualityAnalyzer();
+                m_qualityAnalyzer.configure(options.optJSONObject("audioQuality"));
+                m_useCapture = true;
+            }
+            if (options != null && options.has("preprocessing")) {
+                m_preprocessor = new AudioPreprocessor();
+                m_preprocessor.configure(options.optJSONObject("preprocessing"));
+                m_useCapture = true;
+            }
+            if (options != null && options.has("recorder")) {
+                JSONObject recorder = options.optJSONObject("recorder");
+                m_maxRecordings = recorder != null ? recorder.optInt("maxRecordings", m_maxRecordings) : m_maxRecordings;
+                m_recordingDir = new File(cordova.getActivity().getFilesDir(), "oxford-recordings");
+                m_recordingDir.mkdirs();
+                m_useCapture = true;
+            }
+            if (options != null && options.has("turns")) {
+                m_turnSegmenter = new TurnSegmenter();
+                m_turnSegmenter.configure(options.optJSONObject("turns"));
+                m_useCapture = true;
+            }
+            if (m_finalDelivery != null) {
+                // Finals already queued are still delivered; the thread exits after them.
+                m_finalDelivery.shutdown();
+                m_finalDelivery = null;
+            }
+            if (options != null && options.has("retry")) {
+                m_retry = new ConfidenceRetry();
+                m_retry.configure(options.optJSONObject("retry"), language, m_recoMode);
+                m_finalDelivery = Executors.newSingleThreadExecutor();
+                m_useCapture = true;
+            }
+            if (options != null && options.has("booster")) {
+                m_booster = new PhraseBooster();
+                m_booster.configure(options.optJSONObject("booster"));
+            }
+            if (options != null && options.has("governor")) {
+                m_governor = new PipelineGovernor();
+                m_governor.configure(options.optJSONObject("governor"));
+                m_useCapture = true;
+            }
+            if (options != null && options.has("typeahead")) {
+                m_typeahead = new TypeaheadIndex(typeaheadFile());
+                m_typeahead.configure(options.optJSONObject("typeahead"));
+            }
+            if (options != null && options.optBoolean("transcript", false)) {
+                m_transcript = new Transcript();
+            }
+            JSONObject pushQueue = options != null ? options.optJSONObject("pushQueue") : null;
+            if (pushQueue != null) {
+                m_pushCapacity = pushQueue.optInt("capacityBytes", m_pushCapacity);
+                m_pushHighWater = Math.min(pushQueue.optInt("highWaterBytes", m_pushHighWater), m_pushCapacity);
+                m_pushLowWater = Math.min(pushQueue.optInt("lowWaterBytes", m_pushLowWater), m_pushHighWater);
+            }
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        m_initNanos = System.nanoTime() - start;
+    }
+
+    /**
+     * Maps the persisted indexes and creates the microphone client, once. Called in the
+     * background by the prepare action, or by the first session if the app never called it.
+     */
+    synchronized void prepare(String trigger) {
+        if (m_prepared) {
+            return;
+        }
+        long start = System.nanoTime();
+        if (m_booster != null && m_booster.getVocabulary() == null) {
+            File vocabulary = vocabularyFile();
+            if (vocabulary.exists()) {
+                try {
+                    m_booster.setVocabulary(CompactTrie.load(vocabulary));
+                } catch (IOException e) {
+                    Log.d("OxfordSpeechRecognition", "vocabulary load failed " + e);
+                }
+            }
+        }
+        if (m_typeahead != null) {
+            m_typeahead.load();
+        }
+        long indexed = System.nanoTime();
+
+        if (!m_useCapture && null == m_micClient) {
+            m_micClient = SpeechRecognitionServiceFactory.createMicrophoneClient(m_recoMode,
+                    m_language,
+                    this,
+                    m_primaryKey);
+        }
+        long end = System.nanoTime();
+
+        m_indexNanos = indexed - start;
+        m_clientNanos = end - indexed;
+        m_prepareNanos = end - start;
+        m_prepareTrigger = trigger;
+        m_prepared = true;
+        Log.d("OxfordSpeechRecognition", "prepared by " + trigger + " in " + m_prepareNanos / 1000000 + " ms");
+    }
+
+    /**
+     * Makes sure the session that is starting has its client, waiting for a prepare that is
+     * still running in the background.
+     */
+    void prepareForSession(String trigger) {
+        long start = System.nanoTime();
+        prepare(trigger);
+        if (m_firstSessionWaitNanos < 0) {
+            m_firstSessionWaitNanos = System.nanoTime() - start;
+        }
+    }
+
+    /**
+     * Startup timing: what init cost, what prepare cost and what triggered it, and how long
+     * the first session waited for it.
+     */
+    JSONObject getStartup() {
+        JSONObject startup = new JSONObject();
+        try {
+            startup.put("initMs", m_initNanos / 1000000.0);
+            startup.put("prepared", m_prepared);
+            startup.put("trigger", m_prepareTrigger != null ? m_prepareTrigger : JSONObject.NULL);
+            startup.put("prepareMs", m_prepareNanos / 1000000.0);
+            startup.put("indexesMs", m_indexNanos / 1000000.0);
+            startup.put("clientMs", m_clientNanos / 1000000.0);
+            startup.put("firstSessionWaitMs", m_firstSessionWaitNanos >= 0 ? m_firstSessionWaitNanos / 1000000.0 : JSONObject.NULL);
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        return startup;
+    }
+
+    /**
+     * Starts a recognition session fed by the plugin-owned capture.
+     */
+    void startCaptureSession() {
+        if (m_capture != null) {
+            m_capture.stop();
+        }
+        if (m_pushQueue != null) {
+            m_pushQueue.cancel();
+            m_pushQueue = null;
+        }
+        if (m_turnSegmenter != null) {
+            m_turnSegmenter.reset();
+            m_lastFinalSample = 0;
+        }
+        if (m_turnSegmenter != null && m_turnSegmenter.isSessionPerTurn()) {
+            closeTurnSessions();
+            if (m_dataClient != null) {
+                m_dataClient.dispose();
+            }
+            m_dataClient = openTurnSession(m_turnSegmenter.getCurrentTurn());
+        } else {
+            createDataClient();
+        }
+        openRecorder();
+
+        SpeechAudioFormat format = SpeechAudioFormat.create16BitPCMFormat(AudioCapture.SAMPLE_RATE);
+        m_dataClient.sendAudioFormat(format);
+        SessionRecorder recorder = m_recorder;
+        if (recorder != null) {
+            recorder.writeFormat(format);
+        }
+        m_sendGate = m_governor != null ? m_governor.createGate(m_dataClient, this) : null;
+
+        if (m_qualityAnalyzer != null) {
+            m_qualityAnalyzer.reset();
+        }
+        m_reportedIssues = 0;
+        if (m_preprocessor != null) {
+            m_preprocessor.reset();
+        }
+        if (m_retry != null) {
+            m_retry.clear();
+        }
+
+        m_capture = new AudioCapture(this);
+        m_capture.setEchoCancellation(m_preprocessor != null && m_preprocessor.isEchoCancellationEnabled());
+        m_capture.start();
+    }
+
+    /**
+     * Stops the capture and tells the service no more audio is coming. The final
+     * response arrives through onFinalResponseReceived.
+     */
+    void stopCaptureSession() {
+        if (m_capture != null) {
+            m_capture.stop();
+            m_capture = null;
+        }
+        if (m_dataClient != null) {
+            if (m_sendGate != null) {
+                m_sendGate.flush();
+            }
+            m_dataClient.endAudio();
+            SessionRecorder recorder = m_recorder;
+            if (recorder != null) {
+                recorder.writeEndAudio();
+            }
+        }
+    }
+
+    /**
+     * Lets the governor pick the profile of the session that is starting.
+     */
+    void applyGovernor() {
+        if (m_governor != null) {
+            m_governor.select(PipelineGovernor.sample(cordova.getActivity()));
+        }
+    }
+
+    void createDataClient() {
+        closeTurnSessions();
+        if (m_dataClient != null) {
+            m_dataClient.dispose();
+        }
+        m_dataClient = SpeechRecognitionServiceFactory.createDataClient(cordova.getActivity(),
+                m_recoMode,
+                m_language,
+                this,
+                m_primaryKey);
+    }
+
+    /**
+     * Starts a recognition session fed by pushAudio calls from JS instead of the microphone.
+     */
+    void startPushSession() {
+        if (m_capture != null) {
+            m_capture.stop();
+            m_capture = null;
+        }
+        if (m_pushQueue != null) {
+            m_pushQueue.cancel();
+        }
+        createDataClient();
+        openRecorder();
+
+        SpeechAudioFormat format = SpeechAudioFormat.create16BitPCMFormat(AudioCapture.SAMPLE_RATE);
+        m_dataClient.sendAudioFormat(format);
+        SessionRecorder recorder = m_recorder;
+        if (recorder != null) {
+            recorder.writeFormat(format);
+        }
+
+        m_pushQueue = new AudioPushQueue(m_dataClient, recorder, this,
+                m_pushCapacity, m_pushHighWater, m_pushLowWater);
+        if (m_retry != null) {
+            m_retry.clear();
+            m_pushQueue.setRetryBuffer(m_retry);
+        }
+        m_pushQueue.start();
+    }
+
+    /**
+     * Queues one chunk of 16 kHz mono 16-bit little endian PCM. The reply tells JS how full
+     * the queue is and whether to hold off until the drain event; a chunk that doesn't fit
+     * is refused with a queue_full error.
+     */
+    void pushAudio(JSONArray args, CallbackContext callbackContext) {
+        AudioPushQueue queue = m_pushQueue;
+        if (queue == null) {
+            callbackContext.error("not_started");
+            return;
+        }
+
+        byte[] chunk;
+        try {
+            chunk = new CordovaArgs(args).getArrayBuffer(0);
+        } catch (JSONException e) {
+            callbackContext.error("invalid_audio");
+            return;
+        }
+
+        long sequence = args.optLong(1, 0);
+
+        // Reply with the queue locked so the reply can't overtake a drain event.
+        synchronized (queue) {
+            boolean queued = queue.offer(chunk, sequence);
+            JSONObject status = new JSONObject();
+            try {
+                if (!queued) {
+                    status.put("error", "queue_full");
+                }
+                status.put("seq", sequence);
+                status.put("queued", queue.getQueuedBytes());
+                status.put("capacity", queue.getCapacity());
+                status.put("backpressure", queue.isBackpressure());
+            } catch (JSONException e) {
+                // this will never happen
+            }
+            if (queued) {
+                callbackContext.success(status);
+            } else {
+                callbackContext.error(status);
+            }
+        }
+    }
+
+    public void onQueueDrained(int queuedBytes, long sequence) {
+        if (speechRecognizerCallbackContext == null) {
+            return;
+        }
+        JSONObject event = new JSONObject();
+        try {
+            JSONObject drain = new JSONObject();
+            drain.put("queued", queuedBytes);
+            drain.put("seq", sequence);
+            event.put("drain", drain);
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        PluginResult pr = new PluginResult(PluginResult.Status.OK, event);
+        pr.setKeepCallback(true);
+        speechRecognizerCallbackContext.sendPluginResult(pr);
+    }
+
+    /**
+     * Tells JS the service has finished the session, so pushAudio starts a new one. Sent
+     * before the final result, which a retry can hold back.
+     */
+    void sendSessionEnd(boolean pushed) {
+        if (speechRecognizerCallbackContext == null) {
+            return;
+        }
+        JSONObject event = new JSONObject();
+        try {
+            JSONObject end = new JSONObject();
+            end.put("pushed", pushed);
+            event.put("end", end);
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        PluginResult pr = new PluginResult(PluginResult.Status.OK, event);
+        pr.setKeepCallback(true);
+        speechRecognizerCallbackContext.sendPluginResult(pr);
+    }
+
+    public void onQueueFinished() {
+        Log.d("OxfordSpeechRecognition", "push audio ended");
+    }
+
+    /**
+     * Called on the capture thread for every 20 ms frame.
+     */
+    public void onAudioFrame(short[] frame, int length) {
+        if (m_qualityAnalyzer != null) {
+            int issues = m_qualityAnalyzer.analyze(frame, length);
+            if (issues != m_reportedIssues) {
+                m_reportedIssues = issues;
+                sendQualityEvent();
+            }
+            if (m_qualityAnalyzer.shouldAbort()) {
+                Log.d("OxfordSpeechRecognition", "abort - audio quality");
+                if (m_capture != null) {
+                    m_capture.stop();
+                }
+                if (m_sendGate != null) {
+                    m_sendGate.flush();
+                }
+                m_dataClient.endAudio();
+                SessionRecorder recorder = m_recorder;
+                if (recorder != null) {
+                    recorder.writeEndAudio();
+                }
+                sendError("audio_quality", m_qualityAnalyzer.toJSON());
+                return;
+            }
+        }
+
+        // Quality is judged on the raw capture; the service gets the cleaned up audio.
+        if (m_preprocessor != null && (m_governor == null || m_governor.getProfile().preprocessing)) {
+            m_preprocessor.process(frame, length);
+        }
+
+        if (m_turnSegmenter != null) {
+            TurnSegmenter.Turn turn = m_turnSegmenter.process(frame, length);
+            if (turn != null) {
+                onTurnChanged(turn);
+            }
+        }
+
+        if (m_sendGate != null) {
+            // The recording and the retry buffer get what the gate sends, in onGateSent.
+            m_sendGate.write(frame, length);
+            return;
+        }
+        for (int i = 0; i < length; i++) {
+            m_frameBytes[2 * i] = (byte) (frame[i] & 0xff);
+            m_frameBytes[2 * i + 1] = (byte) ((frame[i] >> 8) & 0xff);
+        }
+        m_dataClient.sendAudio(m_frameBytes, length * 2);
+        onGateSent(m_frameBytes, length * 2);
+    }
+
+    /**
+     * Keeps the recording and the retry buffer to exactly the audio the service got.
+     */
+    public void onGateSent(byte[] audio, int length) {
+        SessionRecorder recorder = m_recorder;
+        if (recorder != null) {
+            recorder.writeAudio(audio, length);
+        }
+        if (m_retry != null) {
+            m_retry.write(audio, length);
+        }
+    }
+
+    public void onCaptureError(String message) {
+        Log.d("OxfordSpeechRecognition", "capture error " + message);
+        sendError("capture", null);
+    }
+
+    /**
+     * The service session of one turn. Its callbacks carry the turn, so results are attributed
+     * to it even while the previous turn's session is still finishing.
+     */
+    class TurnSession implements ISpeechRecognitionServerEvents {
+        final TurnSegmenter.Turn turn;
+        DataRecognitionClient client;
+
+        TurnSession(TurnSegmenter.Turn turn) {
+            this.turn = turn;
+        }
 
-            if (null == m_micClient) {
-                m_micClient = SpeechRecognitionServiceFactory.createMicrophoneClient(m_recoMode,
-                        language,
-                        this,
-                        primaryOrSecondaryKey);
+        /**
+         * Disposes the client off the service callback this is called from.
+         */
+        void dispose() {
+            final DataRecognitionClient finished = client;
+            cordova.getThreadPool().execute(new Runnable() {
+                public void run() {
+                    finished.dispose();
+                }
+            });
+        }
+
+        public void onPartialResponseReceived(String response) {
+            OxfordSpeechRecognition.this.onPartialResponseReceived(response);
+        }
+
+        public void onFinalResponseReceived(RecognitionResult response) {
+            OxfordSpeechRecognition.this.onFinalResponseReceived(response, this);
+        }
+
+        public void onIntentReceived(String payload) {
+            OxfordSpeechRecognition.this.onIntentReceived(payload);
+        }
+
+        public void onError(int errorCode, String response) {
+            OxfordSpeechRecognition.this.onError(errorCode, response);
+        }
+
+        public void onAudioEvent(boolean recording) {
+            OxfordSpeechRecognition.this.onAudioEvent(recording);
+        }
+    }
+
+    /**
+     * Creates the client of a turn's session, kept open until it delivers EndOfDictation.
+     */
+    DataRecognitionClient openTurnSession(TurnSegmenter.Turn turn) {
+        TurnSession session = new TurnSession(turn);
+        session.client = SpeechRecognitionServiceFactory.createDataClient(cordova.getActivity(),
+                m_recoMode,
+                m_language,
+                session,
+                m_primaryKey);
+        synchronized (m_turnSessions) {
+            m_turnSessions.add(session);
+        }
+        return session.client;
+    }
+
+    /**
+     * Disposes the turn sessions still open from a previous session. The live client is one
+     * of them, so it is cleared here too.
+     */
+    void closeTurnSessions() {
+        synchronized (m_turnSessions) {
+            for (TurnSession session : m_turnSessions) {
+                if (session.client == m_dataClient) {
+                    m_dataClient = null;
+                }
+                session.client.dispose();
+            }
+            m_turnSessions.clear();
+        }
+    }
+
+    /**
+     * Reports a speaker change and, if configured, hands the new turn its own session.
+     * The previous client is ended and kept until it has delivered EndOfDictation.
+     * A change is only detected once a window (windowMs) and a quarter of the new speaker
+     * has been heard, so that much of the new turn still goes to the previous session.
+     */
+    void onTurnChanged(TurnSegmenter.Turn turn) {
+        Log.d("OxfordSpeechRecognition", "turn " + turn.id + " speaker " + turn.speaker);
+        if (m_turnSegmenter.isSessionPerTurn()) {
+            if (m_sendGate != null) {
+                m_sendGate.flush();
             }
+            m_dataClient.endAudio();
+            // Set the new client up before the other threads can see it.
+            DataRecognitionClient client = openTurnSession(turn);
+            client.sendAudioFormat(SpeechAudioFormat.create16BitPCMFormat(AudioCapture.SAMPLE_RATE));
+            if (m_sendGate != null) {
+                m_sendGate.setClient(client);
+            }
+            m_dataClient = client;
+        }
+
+        JSONObject event = new JSONObject();
+        try {
+            event.put("turn", turn.toJSON());
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        PluginResult pr = new PluginResult(PluginResult.Status.OK, event);
+        pr.setKeepCallback(true);
+        speechRecognizerCallbackContext.sendPluginResult(pr);
+    }
+
+    /**
+     * Starts a new recording for the session if recording is enabled, dropping the
+     * oldest recordings beyond the configured limit.
+     */
+    void openRecorder() {
+        closeRecorder();
+        if (m_recordingDir == null) {
+            return;
+        }
+
+        File[] existing = m_recordingDir.listFiles();
+        if (existing != null && existing.length >= m_maxRecordings) {
+            Arrays.sort(existing);
+            for (int i = 0; i <= existing.length - m_maxRecordings; i++) {
+                existing[i].delete();
+            }
+        }
+
+        File file = new File(m_recordingDir, "session-" + System.currentTimeMillis() + SessionRecorder.EXTENSION);
+        try {
+            m_recorder = new SessionRecorder(file);
+        } catch (IOException e) {
+            Log.d("OxfordSpeechRecognition", "recorder open failed " + e);
+            return;
+        }
+
+        JSONObject event = new JSONObject();
+        try {
+            event.put("recording", file.getAbsolutePath());
         } catch (JSONException e) {
             // this will never happen
         }
+        PluginResult pr = new PluginResult(PluginResult.Status.OK, event);
+        pr.setKeepCallback(true);
+        speechRecognizerCallbackContext.sendPluginResult(pr);
+    }
+
+    void closeRecorder() {
+        SessionRecorder recorder = m_recorder;
+        m_recorder = null;
+        if (recorder != null) {
+            // Writes that still hold it after this are ignored.
+            recorder.close();
+        }
+    }
+
+    JSONArray listRecordings() {
+        JSONArray paths = new JSONArray();
+        File[] files = m_recordingDir != null ? m_recordingDir.listFiles() : null;
+        if (files != null) {
+            Arrays.sort(files);
+            for (File file : files) {
+                paths.put(file.getAbsolutePath());
+            }
+        }
+        return paths;
+    }
+
+    /**
+     * Replays a recording through a fresh DataRecognitionClient. Results arrive through the
+     * usual callbacks; if recording is enabled the replayed session is recorded as well.
+     */
+    void replay(JSONArray args) {
+        String path = args.optString(0);
+        JSONObject options = args.optJSONObject(1);
+        boolean realtime = options == null || options.optBoolean("realtime", true);
+
+        if (m_capture != null) {
+            m_capture.stop();
+            m_capture = null;
+        }
+        if (m_pushQueue != null) {
+            m_pushQueue.cancel();
+            m_pushQueue = null;
+        }
+        createDataClient();
+        openRecorder();
+        cordova.getThreadPool().execute(new SessionReplayer(new File(path),
+                SessionReplayer.forClient(m_dataClient), m_recorder, realtime, this));
+    }
+
+    public void onReplayFinished(File file, String error) {
+        if (error != null) {
+            try {
+                JSONObject detail = new JSONObject();
+                detail.put("path", file.getAbsolutePath());
+                detail.put("message", error);
+                sendError("replay", detail);
+            } catch (JSONException e) {
+                // this will never happen
+            }
+        }
+    }
+
+    /**
+     * Serializes a final result for the recorder.
+     */
+    static JSONObject resultToJSON(RecognitionResult response) {
+        JSONObject result = new JSONObject();
+        try {
+            result.put("status", response.RecognitionStatus.getValue());
+            JSONArray phrases = new JSONArray();
+            if (response.Results != null) {
+                for (int i = 0; i < response.Results.length; i++) {
+                    JSONObject phrase = new JSONObject();
+                    phrase.put("text", response.Results[i].DisplayText);
+                    phrase.put("lexical", response.Results[i].LexicalForm);
+                    phrase.put("confidence", response.Results[i].Confidence.getValue());
+                    phrases.put(phrase);
+                }
+            }
+            result.put("phrases", phrases);
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        return result;
+    }
+
+    private void sendQualityEvent() {
+        if (speechRecognizerCallbackContext == null) {
+            return;
+        }
+        JSONObject event = new JSONObject();
+        try {
+            event.put("quality", m_qualityAnalyzer.toJSON());
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        PluginResult pr = new PluginResult(PluginResult.Status.OK, event);
+        pr.setKeepCallback(true);
+        speechRecognizerCallbackContext.sendPluginResult(pr);
+    }
+
+    private void sendError(String error, JSONObject detail) {
+        if (speechRecognizerCallbackContext == null) {
+            return;
+        }
+        JSONObject event = new JSONObject();
+        try {
+            event.put("error", error);
+            if (detail != null) {
+                event.put("detail", detail);
+            }
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        PluginResult pr = new PluginResult(PluginResult.Status.ERROR, event);
+        pr.setKeepCallback(true);
+        speechRecognizerCallbackContext.sendPluginResult(pr);
     }
 }
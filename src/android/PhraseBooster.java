@@ -0,0 +1,144 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import java.util.Locale;
+
+import org.json.JSONException;
+import org.json.JSONObject;
+
+import com.microsoft.ProjectOxford.RecognitionResult;
+
+/**
+ * Rescores the N-best phrases of a final result against a user vocabulary.
+ *
+ * The vocabulary is a CompactTrie of lower case phrases.  Each N-best phrase scores its
+ * Confidence value plus the boost times the weight of every vocabulary phrase found in it,
+ * matched greedily on word boundaries (longest match first).  The best score wins; ties keep
+ * the service's order.
+ */
+public class PhraseBooster {
+
+    private volatile CompactTrie m_trie = null;
+    private float m_boost = 0.5f;
+
+    // Metrics
+    private int m_rescored = 0;
+    private int m_changed = 0;
+
+    /**
+     * Reads the "booster" init option.
+     */
+    public void configure(JSONObject options) {
+        if (options == null) {
+            return;
+        }
+        m_boost = (float) options.optDouble("boost", m_boost);
+    }
+
+    public void setVocabulary(CompactTrie trie) {
+        m_trie = trie;
+    }
+
+    public CompactTrie getVocabulary() {
+        return m_trie;
+    }
+
+    /**
+     * Index of the phrase to use, 0 if nothing changes the service's choice.
+     */
+    public int choose(RecognitionResult response) {
+        CompactTrie trie = m_trie;
+        if (trie == null || response.Results == null || response.Results.length < 2) {
+            return 0;
+        }
+
+        int best = 0;
+        float bestScore = Float.NEGATIVE_INFINITY;
+        for (int i = 0; i < response.Results.length; i++) {
+            String lexical = response.Results[i].LexicalForm;
+            String text = lexical != null && lexical.length() > 0 ? lexical : response.Results[i].DisplayText;
+            float score = response.Results[i].Confidence.getValue() + m_boost * matchWeight(trie, text);
+            if (score > bestScore) {
+                best = i;
+                bestScore = score;
+            }
+        }
+
+        synchronized (this) {
+            m_rescored++;
+            if (best != 0) {
+                m_changed++;
+            }
+        }
+        return best;
+    }
+
+    /**
+     * Total weight of the vocabulary phrases found in the text.
+     */
+    static int matchWeight(CompactTrie trie, String text) {
+        if (text == null) {
+            return 0;
+        }
+        String lower = text.toLowerCase(Locale.ROOT);
+        int length = lower.length();
+        int total = 0;
+        int p = 0;
+        while (p < length) {
+            // Longest vocabulary phrase starting at this word that ends on a word boundary.
+            int node = 0;
+            int matchEnd = -1;
+            int matchWeight = 0;
+            for (int q = p; q < length && node >= 0; q++) {
+                node = trie.child(node, lower.charAt(q));
+                if (node >= 0 && trie.weight(node) > 0 && (q + 1 == length || lower.charAt(q + 1) == ' ')) {
+                    matchEnd = q + 1;
+                    matchWeight = trie.weight(node);
+                }
+            }
+            if (matchEnd > 0) {
+                total += matchWeight;
+                p = matchEnd;
+            } else {
+                while (p < length && lower.charAt(p) != ' ') {
+                    p++;
+                }
+            }
+            while (p < length && lower.charAt(p) == ' ') {
+                p++;
+            }
+        }
+        return total;
+    }
+
+    public synchronized JSONObject toJSON() {
+        JSONObject metrics = new JSONObject();
+        try {
+            CompactTrie trie = m_trie;
+            metrics.put("vocabularyNodes", trie != null ? trie.getNodeCount() : 0);
+            metrics.put("rescored", m_rescored);
+            metrics.put("changed", m_changed);
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        return metrics;
+    }
+}
@@ -0,0 +1,367 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import java.util.ArrayDeque;
+import java.util.LinkedHashMap;
+import java.util.Map;
+
+import org.json.JSONArray;
+import org.json.JSONException;
+import org.json.JSONObject;
+
+import android.content.Context;
+import android.content.Intent;
+import android.content.IntentFilter;
+import android.net.ConnectivityManager;
+import android.net.NetworkInfo;
+import android.os.BatteryManager;
+import android.os.Build;
+import android.os.PowerManager;
+import android.os.SystemClock;
+import android.util.Log;
+
+import com.microsoft.ProjectOxford.DataRecognitionClient;
+
+/**
+ * Picks the audio pipeline profile for each session from the battery, thermal and network
+ * state of the device.
+ *
+ * A profile decides whether the preprocessor runs, how often captured audio is sent
+ * (see AudioSendGate), how aggressively leading silence is gated and how often partials
+ * are delivered to JS.  The state is sampled and the profile chosen only when a session
+ * starts, so a session never changes configuration midway.  Every change of profile is
+ * kept, with its reason, for getMetrics.
+ */
+public class PipelineGovernor {
+
+    public static final String PROFILE_FULL = "full";
+    public static final String PROFILE_BALANCED = "balanced";
+    public static final String PROFILE_SAVER = "saver";
+
+    public static final String VAD_OFF = "off";
+    public static final String VAD_NORMAL = "normal";
+    public static final String VAD_AGGRESSIVE = "aggressive";
+
+    // Thermal levels, the same scale as NSProcessInfoThermalState on iOS.
+    public static final int THERMAL_NOMINAL = 0;
+    public static final int THERMAL_FAIR = 1;
+    public static final int THERMAL_SERIOUS = 2;
+    public static final int THERMAL_CRITICAL = 3;
+
+    private static final int MAX_SWITCHES = 50;
+
+    public static class Profile {
+        public final String name;
+        public boolean preprocessing;
+        public int sendIntervalMs;
+        public int partialIntervalMs;
+        public String vad;
+
+        // Metrics
+        long sessions = 0;
+        long sentBytes = 0;
+        long trimmedBytes = 0;
+        long sendCalls = 0;
+        long partialsDropped = 0;
+
+        Profile(String name, boolean preprocessing, int sendIntervalMs, int partialIntervalMs, String vad) {
+            this.name = name;
+            this.preprocessing = preprocessing;
+            this.sendIntervalMs = sendIntervalMs;
+            this.partialIntervalMs = partialIntervalMs;
+            this.vad = vad;
+        }
+
+        void configure(JSONObject options) {
+            if (options == null) {
+                return;
+            }
+            preprocessing = options.optBoolean("preprocessing", preprocessing);
+            sendIntervalMs = options.optInt("sendIntervalMs", sendIntervalMs);
+            partialIntervalMs = options.optInt("partialIntervalMs", partialIntervalMs);
+            vad = options.optString("vad", vad);
+        }
+
+        /**
+         * Speech onset level of the send gate, NaN for no gate.
+         */
+        public float getGateDbfs() {
+            return VAD_AGGRESSIVE.equals(vad) ? -40f : VAD_NORMAL.equals(vad) ? -50f : Float.NaN;
+        }
+
+        public int getPreRollMs() {
+            return VAD_AGGRESSIVE.equals(vad) ? 200 : 300;
+        }
+
+        JSONObject toJSON() {
+            JSONObject profile = new JSONObject();
+            try {
+                profile.put("preprocessing", preprocessing);
+                profile.put("sendIntervalMs", sendIntervalMs);
+                profile.put("partialIntervalMs", partialIntervalMs);
+                profile.put("vad", vad);
+                profile.put("sessions", sessions);
+                profile.put("sentBytes", sentBytes);
+                profile.put("trimmedBytes", trimmedBytes);
+                profile.put("sendCalls", sendCalls);
+                profile.put("partialsDropped", partialsDropped);
+            } catch (JSONException e) {
+                // this will never happen
+            }
+            return profile;
+        }
+    }
+
+    public static class DeviceState {
+        public float battery = -1;          // 0..1, -1 if unknown
+        public boolean charging = false;
+        public boolean powerSave = false;
+        public int thermal = THERMAL_NOMINAL;
+        public String network = "unknown";  // wifi, cellular, other, none
+
+        JSONObject toJSON() {
+            JSONObject state = new JSONObject();
+            try {
+                state.put("battery", battery);
+                state.put("charging", charging);
+                state.put("powerSave", powerSave);
+                state.put("thermal", thermal);
+                state.put("network", network);
+            } catch (JSONException e) {
+                // this will never happen
+            }
+            return state;
+        }
+    }
+
+    private final LinkedHashMap<String, Profile> m_profiles = new LinkedHashMap<String, Profile>();
+    private String m_fixed = null;
+    private float m_lowBattery = 0.2f;
+    private float m_mediumBattery = 0.5f;
+
+    private Profile m_profile;
+    private String m_reason = null;
+    private DeviceState m_state = null;
+    private AudioSendGate m_gate = null;
+    private long m_lastPartial = 0;
+    private final ArrayDeque<JSONObject> m_switches = new ArrayDeque<JSONObject>();
+    private long m_switchCount = 0;
+
+    public PipelineGovernor() {
+        m_profiles.put(PROFILE_FULL, new Profile(PROFILE_FULL, true, 20, 0, VAD_OFF));
+        m_profiles.put(PROFILE_BALANCED, new Profile(PROFILE_BALANCED, true, 100, 250, VAD_NORMAL));
+        m_profiles.put(PROFILE_SAVER, new Profile(PROFILE_SAVER, false, 200, 1000, VAD_AGGRESSIVE));
+        m_profile = m_profiles.get(PROFILE_FULL);
+    }
+
+    /**
+     * Reads the "governor" init option.
+     */
+    public void configure(JSONObject options) {
+        if (options == null) {
+            return;
+        }
+        m_fixed = options.has("profile") ? options.optString("profile") : null;
+        if (m_fixed != null && !m_profiles.containsKey(m_fixed)) {
+            m_fixed = null;
+        }
+        m_lowBattery = (float) options.optDouble("lowBattery", m_lowBattery);
+        m_mediumBattery = (float) options.optDouble("mediumBattery", m_mediumBattery);
+        JSONObject profiles = options.optJSONObject("profiles");
+        if (profiles != null) {
+            for (Profile profile : m_profiles.values()) {
+                profile.configure(profiles.optJSONObject(profile.name));
+            }
+        }
+    }
+
+    /**
+     * Reads the device state without registering for updates: the sticky battery broadcast,
+     * the power manager and the active network.
+     */
+    public static DeviceState sample(Context context) {
+        DeviceState state = new DeviceState();
+
+        Intent battery = context.registerReceiver(null, new IntentFilter(Intent.ACTION_BATTERY_CHANGED));
+        if (battery != null) {
+            int level = battery.getIntExtra(BatteryManager.EXTRA_LEVEL, -1);
+            int scale = battery.getIntExtra(BatteryManager.EXTRA_SCALE, -1);
+            if (level >= 0 && scale > 0) {
+                state.battery = (float) level / scale;
+            }
+            int status = battery.getIntExtra(BatteryManager.EXTRA_STATUS, -1);
+            state.charging = status == BatteryManager.BATTERY_STATUS_CHARGING
+                    || status == BatteryManager.BATTERY_STATUS_FULL;
+        }
+
+        PowerManager power = (PowerManager) context.getSystemService(Context.POWER_SERVICE);
+        if (power != null) {
+            state.powerSave = power.isPowerSaveMode();
+            if (Build.VERSION.SDK_INT >= 29) {
+                int status = power.getCurrentThermalStatus();
+                state.thermal = status >= PowerManager.THERMAL_STATUS_SEVERE ? THERMAL_CRITICAL
+                        : status >= PowerManager.THERMAL_STATUS_MODERATE ? THERMAL_SERIOUS
+                        : status >= PowerManager.THERMAL_STATUS_LIGHT ? THERMAL_FAIR : THERMAL_NOMINAL;
+            }
+        }
+
+        ConnectivityManager connectivity = (ConnectivityManager) context.getSystemService(Context.CONNECTIVITY_SERVICE);
+        NetworkInfo network = connectivity != null ? connectivity.getActiveNetworkInfo() : null;
+        if (network == null || !network.isConnected()) {
+            state.network = "none";
+        } else if (network.getType() == ConnectivityManager.TYPE_WIFI) {
+            state.network = "wifi";
+        } else if (network.getType() == ConnectivityManager.TYPE_MOBILE) {
+            state.network = "cellular";
+        } else {
+            state.network = "other";
+        }
+        return state;
+    }
+
+    /**
+     * Chooses the profile for the session that is starting.
+     */
+    public synchronized Profile select(DeviceState state) {
+        String name;
+        String reason;
+        boolean lowBattery = state.battery >= 0 && state.battery <= m_lowBattery && !state.charging;
+        boolean mediumBattery = state.battery >= 0 && state.battery <= m_mediumBattery && !state.charging;
+        if (m_fixed != null) {
+            name = m_fixed;
+            reason = "fixed";
+        } else if (state.thermal >= THERMAL_SERIOUS) {
+            name = PROFILE_SAVER;
+            reason = "thermal";
+        } else if (state.powerSave) {
+            name = PROFILE_SAVER;
+            reason = "powerSave";
+        } else if (lowBattery) {
+            name = PROFILE_SAVER;
+            reason = "battery";
+        } else if (state.thermal == THERMAL_FAIR) {
+            name = PROFILE_BALANCED;
+            reason = "thermal";
+        } else if (mediumBattery) {
+            name = PROFILE_BALANCED;
+            reason = "battery";
+        } else if ("cellular".equals(state.network)) {
+            name = PROFILE_BALANCED;
+            reason = "cellular";
+        } else {
+            name = PROFILE_FULL;
+            reason = state.charging ? "charging" : "nominal";
+        }
+
+        Profile profile = m_profiles.get(name);
+        if (profile != m_profile || m_reason == null) {
+            Log.d("OxfordSpeechRecognition", "governor " + m_profile.name + " -> " + name + " (" + reason + ")");
+            JSONObject change = new JSONObject();
+            try {
+                change.put("time", System.currentTimeMillis());
+                change.put("from", m_reason != null ? m_profile.name : JSONObject.NULL);
+                change.put("to", name);
+                change.put("reason", reason);
+                change.put("state", state.toJSON());
+            } catch (JSONException e) {
+                // this will never happen
+            }
+            m_switches.add(change);
+            if (m_switches.size() > MAX_SWITCHES) {
+                m_switches.poll();
+            }
+            m_switchCount++;
+        }
+
+        finishGate();
+        m_profile = profile;
+        m_reason = reason;
+        m_state = state;
+        m_lastPartial = 0;
+        profile.sessions++;
+        return profile;
+    }
+
+    public synchronized Profile getProfile() {
+        return m_profile;
+    }
+
+    /**
+     * Creates the send gate for a capture session of the current profile. Its counters are
+     * added to the profile when the next session starts.
+     */
+    public synchronized AudioSendGate createGate(DataRecognitionClient client, AudioSendGate.Listener listener) {
+        finishGate();
+        m_gate = new AudioSendGate(client, listener, m_profile.sendIntervalMs, m_profile.getGateDbfs(), m_profile.getPreRollMs());
+        return m_gate;
+    }
+
+    private void finishGate() {
+        if (m_gate != null) {
+            m_profile.sentBytes += m_gate.getSentBytes();
+            m_profile.trimmedBytes += m_gate.getTrimmedBytes();
+            m_profile.sendCalls += m_gate.getSendCalls();
+            m_gate = null;
+        }
+    }
+
+    /**
+     * Whether a partial may be delivered now under the profile's partial rate.
+     */
+    public synchronized boolean allowPartial() {
+        if (m_profile.partialIntervalMs <= 0) {
+            return true;
+        }
+        long now = SystemClock.elapsedRealtime();
+        if (m_lastPartial != 0 && now - m_lastPartial < m_profile.partialIntervalMs) {
+            m_profile.partialsDropped++;
+            return false;
+        }
+        m_lastPartial = now;
+        return true;
+    }
+
+    public synchronized JSONObject toJSON() {
+        JSONObject metrics = new JSONObject();
+        try {
+            metrics.put("profile", m_profile.name);
+            metrics.put("reason", m_reason != null ? m_reason : JSONObject.NULL);
+            metrics.put("state", m_state != null ? m_state.toJSON() : JSONObject.NULL);
+            metrics.put("switchCount", m_switchCount);
+            metrics.put("switches", new JSONArray(m_switches));
+            if (m_gate != null) {
+                JSONObject session = new JSONObject();
+                session.put("sentBytes", m_gate.getSentBytes());
+                session.put("trimmedBytes", m_gate.getTrimmedBytes());
+                session.put("sendCalls", m_gate.getSendCalls());
+                metrics.put("session", session);
+            }
+            JSONObject profiles = new JSONObject();
+            for (Map.Entry<String, Profile> entry : m_profiles.entrySet()) {
+                profiles.put(entry.getKey(), entry.getValue().toJSON());
+            }
+            metrics.put("profiles", profiles);
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        return metrics;
+    }
+}
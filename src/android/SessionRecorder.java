@@ -0,0 +1,150 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import java.io.BufferedOutputStream;
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.charset.Charset;
+
+import android.util.Log;
+
+import com.microsoft.ProjectOxford.SpeechAudioFormat;
+
+/**
+ * Records one recognition session: the audio format, the exact audio bytes sent to
+ * the service and every callback, each stamped with the time since the session started.
+ *
+ * Container layout (little endian, every record 8-byte aligned so the file can be
+ * memory mapped and walked in place):
+ *
+ *   header:  u32 magic "OXSR" | u32 version | u64 start time (ms since epoch)
+ *   record:  u32 type | u32 payload length | u64 timestamp (us) | payload | pad to 8
+ *
+ * The FORMAT payload is u16 encoding | u16 channels | u32 samples per second |
+ * u32 average bytes per second | u16 block align | u16 bits per sample | format
+ * specific data.  AUDIO is raw bytes, END_AUDIO is empty, the rest are UTF-8 text.
+ */
+public class SessionRecorder {
+
+    public static final int MAGIC = 0x5253584f; // "OXSR"
+    public static final int VERSION = 1;
+    public static final int HEADER_SIZE = 16;
+    public static final int RECORD_HEADER_SIZE = 16;
+
+    public static final int RECORD_FORMAT = 1;
+    public static final int RECORD_AUDIO = 2;
+    public static final int RECORD_END_AUDIO = 3;
+    public static final int RECORD_PARTIAL = 4;
+    public static final int RECORD_FINAL = 5;
+    public static final int RECORD_ERROR = 6;
+    public static final int RECORD_AUDIO_EVENT = 7;
+    public static final int RECORD_INTENT = 8;
+
+    public static final String EXTENSION = ".oxsr";
+
+    private static final Charset UTF8 = Charset.forName("UTF-8");
+    private static final byte[] PADDING = new byte[8];
+
+    private final File m_file;
+    private final long m_startNanos;
+    private final ByteBuffer m_header = ByteBuffer.allocate(RECORD_HEADER_SIZE).order(ByteOrder.LITTLE_ENDIAN);
+    private OutputStream m_out;
+
+    public SessionRecorder(File file) throws IOException {
+        m_file = file;
+        m_startNanos = System.nanoTime();
+        m_out = new BufferedOutputStream(new FileOutputStream(file), 64 * 1024);
+
+        ByteBuffer header = ByteBuffer.allocate(HEADER_SIZE).order(ByteOrder.LITTLE_ENDIAN);
+        header.putInt(MAGIC);
+        header.putInt(VERSION);
+        header.putLong(System.currentTimeMillis());
+        m_out.write(header.array());
+    }
+
+    public File getFile() {
+        return m_file;
+    }
+
+    public synchronized void writeFormat(SpeechAudioFormat format) {
+        byte[] extra = format.FormatSpecificData != null ? format.FormatSpecificData : new byte[0];
+        ByteBuffer payload = ByteBuffer.allocate(16 + extra.length).order(ByteOrder.LITTLE_ENDIAN);
+        payload.putShort(format.EncodingFormat.getValue());
+        payload.putShort(format.ChannelCount);
+        payload.putInt(format.SamplesPerSecond);
+        payload.putInt(format.AverageBytesPerSecond);
+        payload.putShort(format.BlockAlign);
+        payload.putShort(format.BitsPerSample);
+        payload.put(extra);
+        write(RECORD_FORMAT, payload.array(), payload.capacity());
+    }
+
+    public synchronized void writeAudio(byte[] buffer, int length) {
+        write(RECORD_AUDIO, buffer, length);
+    }
+
+    public synchronized void writeEndAudio() {
+        write(RECORD_END_AUDIO, PADDING, 0);
+    }
+
+    public synchronized void writeText(int type, String text) {
+        byte[] bytes = (text != null ? text : "").getBytes(UTF8);
+        write(type, bytes, bytes.length);
+    }
+
+    public synchronized void close() {
+        if (m_out == null) {
+            return;
+        }
+        try {
+            m_out.close();
+        } catch (IOException e) {
+            Log.d("OxfordSpeechRecognition", "recorder close failed " + e);
+        }
+        m_out = null;
+    }
+
+    private void write(int type, byte[] payload, int length) {
+        if (m_out == null) {
+            return;
+        }
+        m_header.clear();
+        m_header.putInt(type);
+        m_header.putInt(length);
+        m_header.putLong((System.nanoTime() - m_startNanos) / 1000);
+        try {
+            m_out.write(m_header.array());
+            m_out.write(payload, 0, length);
+            int pad = (8 - (length & 7)) & 7;
+            if (pad > 0) {
+                m_out.write(PADDING, 0, pad);
+            }
+        } catch (IOException e) {
+            // Recording is best effort; never let it break the session.
+            Log.d("OxfordSpeechRecognition", "recorder write failed " + e);
+            close();
+        }
+    }
+}
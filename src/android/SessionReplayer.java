@@ -0,0 +1,206 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteOrder;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+
+import android.util.Log;
+
+import com.microsoft.ProjectOxford.AudioCompressionType;
+import com.microsoft.ProjectOxford.DataRecognitionClient;
+import com.microsoft.ProjectOxford.SpeechAudioFormat;
+
+/**
+ * Replays a SessionRecorder file into a Recognizer, either paced by the recorded
+ * timestamps or without waiting for them.  The plugin replays into a DataRecognitionClient,
+ * which queues the audio and sends it at the audio rate regardless, so an unpaced replay
+ * only skips the gaps in the recording.  The recorded callbacks are skipped; the new session
+ * produces its own, which can be recorded and diffed against the original with
+ * tools/oxsr.js, on the desktop, where other recognizers can be plugged in as well.
+ */
+public class SessionReplayer implements Runnable {
+
+    public interface Listener {
+        void onReplayFinished(File file, String error);
+    }
+
+    /**
+     * Where the replayed audio goes: the service through a DataRecognitionClient, or any
+     * other recognizer that takes the same calls.
+     */
+    public interface Recognizer {
+        void sendAudioFormat(SpeechAudioFormat format);
+
+        void sendAudio(byte[] buffer, int length);
+
+        void endAudio();
+    }
+
+    public static Recognizer forClient(final DataRecognitionClient client) {
+        return new Recognizer() {
+            public void sendAudioFormat(SpeechAudioFormat format) {
+                client.sendAudioFormat(format);
+            }
+
+            public void sendAudio(byte[] buffer, int length) {
+                client.sendAudio(buffer, length);
+            }
+
+            public void endAudio() {
+                client.endAudio();
+            }
+        };
+    }
+
+    private final File m_file;
+    private final Recognizer m_client;
+    private final SessionRecorder m_recorder;
+    private final boolean m_realtime;
+    private final Listener m_listener;
+
+    public SessionReplayer(File file, Recognizer client, SessionRecorder recorder,
+            boolean realtime, Listener listener) {
+        m_file = file;
+        m_client = client;
+        m_recorder = recorder;
+        m_realtime = realtime;
+        m_listener = listener;
+    }
+
+    public void run() {
+        String error = null;
+        RandomAccessFile raf = null;
+        try {
+            raf = new RandomAccessFile(m_file, "r");
+            FileChannel channel = raf.getChannel();
+            MappedByteBuffer map = channel.map(FileChannel.MapMode.READ_ONLY, 0, channel.size());
+            map.order(ByteOrder.LITTLE_ENDIAN);
+            replay(map);
+        } catch (IOException e) {
+            error = e.toString();
+        } catch (IllegalStateException e) {
+            error = e.getMessage();
+        } catch (InterruptedException e) {
+            error = "interrupted";
+            Thread.currentThread().interrupt();
+        } finally {
+            if (raf != null) {
+                try {
+                    raf.close();
+                } catch (IOException e) {
+                    // nothing to do
+                }
+            }
+        }
+        Log.d("OxfordSpeechRecognition", "replay finished " + (error != null ? error : ""));
+        m_listener.onReplayFinished(m_file, error);
+    }
+
+    private void replay(MappedByteBuffer map) throws InterruptedException {
+        if (map.limit() < SessionRecorder.HEADER_SIZE || map.getInt(0) != SessionRecorder.MAGIC) {
+            throw new IllegalStateException("not a session recording");
+        }
+        if (map.getInt(4) != SessionRecorder.VERSION) {
+            throw new IllegalStateException("unsupported recording version " + map.getInt(4));
+        }
+
+        long startNanos = System.nanoTime();
+        byte[] audio = new byte[0];
+        boolean endSent = false;
+        int position = SessionRecorder.HEADER_SIZE;
+
+        while (position + SessionRecorder.RECORD_HEADER_SIZE <= map.limit()) {
+            int type = map.getInt(position);
+            int length = map.getInt(position + 4);
+            long timestampUs = map.getLong(position + 8);
+            int payload = position + SessionRecorder.RECORD_HEADER_SIZE;
+            if (length < 0 || payload + length > map.limit()) {
+                // Truncated tail, e.g. the app was killed while recording.
+                break;
+            }
+            position = payload + ((length + 7) & ~7);
+
+            if (type != SessionRecorder.RECORD_FORMAT &&
+                    type != SessionRecorder.RECORD_AUDIO &&
+                    type != SessionRecorder.RECORD_END_AUDIO) {
+                continue;
+            }
+
+            if (m_realtime) {
+                long waitUs = timestampUs - (System.nanoTime() - startNanos) / 1000;
+                if (waitUs > 0) {
+                    Thread.sleep(waitUs / 1000, (int) (waitUs % 1000) * 1000);
+                }
+            }
+
+            if (type == SessionRecorder.RECORD_FORMAT) {
+                SpeechAudioFormat format = readFormat(map, payload, length);
+                m_client.sendAudioFormat(format);
+                if (m_recorder != null) {
+                    m_recorder.writeFormat(format);
+                }
+            } else if (type == SessionRecorder.RECORD_AUDIO) {
+                if (audio.length < length) {
+                    audio = new byte[length];
+                }
+                map.position(payload);
+                map.get(audio, 0, length);
+                m_client.sendAudio(audio, length);
+                if (m_recorder != null) {
+                    m_recorder.writeAudio(audio, length);
+                }
+            } else {
+                m_client.endAudio();
+                endSent = true;
+                if (m_recorder != null) {
+                    m_recorder.writeEndAudio();
+                }
+            }
+        }
+
+        if (!endSent) {
+            m_client.endAudio();
+            if (m_recorder != null) {
+                m_recorder.writeEndAudio();
+            }
+        }
+    }
+
+    private static SpeechAudioFormat readFormat(MappedByteBuffer map, int offset, int length) {
+        SpeechAudioFormat format = new SpeechAudioFormat();
+        format.EncodingFormat = AudioCompressionType.Create(map.getShort(offset));
+        format.ChannelCount = map.getShort(offset + 2);
+        format.SamplesPerSecond = map.getInt(offset + 4);
+        format.AverageBytesPerSecond = map.getInt(offset + 8);
+        format.BlockAlign = map.getShort(offset + 12);
+        format.BitsPerSample = map.getShort(offset + 14);
+        if (length > 16) {
+            format.FormatSpecificData = new byte[length - 16];
+            map.position(offset + 16);
+            map.get(format.FormatSpecificData);
+        }
+        return format;
+    }
+}
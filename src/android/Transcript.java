@@ -0,0 +1,228 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import java.util.Arrays;
+
+import org.json.JSONException;
+import org.json.JSONObject;
+
+/**
+ * Session transcript kept as a piece table.
+ *
+ * Final results become segments with stable ids (their index); their text is appended to a
+ * single add-only buffer and each segment points at its piece of it, so replacing a segment
+ * appends the new text and moves the pointer instead of shifting the document.  The current
+ * partial is a separate mutable tail.  A Fenwick tree over the rendered segment lengths gives
+ * the character offset of any segment in O(log n), so a range can be read without building
+ * the whole text.
+ *
+ * The document is the segments joined by single spaces, followed by the tail.  Offsets are in
+ * UTF-16 code units, the same as JS strings.
+ */
+public class Transcript {
+
+    public static final String OP_INSERT = "insert";
+    public static final String OP_REPLACE = "replace";
+    public static final String OP_TAIL = "tail";
+
+    private final StringBuilder m_buffer = new StringBuilder();
+    private int[] m_starts = new int[64];
+    private int[] m_lengths = new int[64];
+    private int[] m_tree = new int[65];          // 1-based Fenwick tree over rendered lengths
+    private int m_count = 0;
+    private String m_tail = "";
+
+    public synchronized void reset() {
+        m_buffer.setLength(0);
+        Arrays.fill(m_tree, 0);
+        m_count = 0;
+        m_tail = "";
+    }
+
+    /**
+     * Appends a final result as a new segment and clears the tail. Returns the segment id,
+     * or -1 if the text is empty.
+     */
+    public synchronized int append(String text) {
+        m_tail = "";
+        if (text == null || text.length() == 0) {
+            return -1;
+        }
+        if (m_count == m_starts.length) {
+            grow();
+        }
+        int id = m_count++;
+        m_starts[id] = m_buffer.length();
+        m_lengths[id] = text.length();
+        m_buffer.append(text);
+        add(id, rendered(id));
+        return id;
+    }
+
+    /**
+     * Replaces the text of a segment. Returns false if there is no such segment.
+     */
+    public synchronized boolean replace(int id, String text) {
+        if (id < 0 || id >= m_count || text == null || text.length() == 0) {
+            return false;
+        }
+        int before = rendered(id);
+        m_starts[id] = m_buffer.length();
+        m_lengths[id] = text.length();
+        m_buffer.append(text);
+        add(id, rendered(id) - before);
+        return true;
+    }
+
+    public synchronized void setTail(String text) {
+        m_tail = text != null ? text : "";
+    }
+
+    public synchronized int getSegmentCount() {
+        return m_count;
+    }
+
+    public synchronized int length() {
+        return prefix(m_count) + tailLength();
+    }
+
+    public synchronized String getText() {
+        return getText(0, length());
+    }
+
+    /**
+     * Returns the document text in [start, end), clamped to the document.
+     */
+    public synchronized String getText(int start, int end) {
+        int segmentsEnd = prefix(m_count);
+        start = Math.max(0, start);
+        end = Math.min(end, segmentsEnd + tailLength());
+        StringBuilder text = new StringBuilder(Math.max(0, end - start));
+        if (start >= end) {
+            return text.toString();
+        }
+
+        int offset = 0;
+        int id = 0;
+        if (start < segmentsEnd) {
+            id = find(start);
+            offset = prefix(id);
+        } else {
+            id = m_count;
+            offset = segmentsEnd;
+        }
+        for (; id < m_count && offset < end; id++) {
+            int length = rendered(id);
+            appendRange(text, id > 0 ? " " : "", m_starts[id], m_lengths[id], start - offset, end - offset);
+            offset += length;
+        }
+        if (offset < end) {
+            String tail = m_count > 0 && m_tail.length() > 0 ? " " + m_tail : m_tail;
+            text.append(tail, Math.max(0, start - offset), end - offset);
+        }
+        return text.toString();
+    }
+
+    /**
+     * Builds the edit operation sent to JS.
+     */
+    public static JSONObject edit(String op, int id, String text) {
+        JSONObject edit = new JSONObject();
+        try {
+            edit.put("op", op);
+            if (id >= 0) {
+                edit.put("id", id);
+            }
+            edit.put("text", text != null ? text : "");
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        return edit;
+    }
+
+    /**
+     * Appends the part of "prefix + buffer[pieceStart, pieceStart + pieceLength)" that falls in [from, to).
+     */
+    private void appendRange(StringBuilder text, String prefix, int pieceStart, int pieceLength, int from, int to) {
+        int p = prefix.length();
+        from = Math.max(0, from);
+        to = Math.min(to, p + pieceLength);
+        if (from < p) {
+            text.append(prefix, from, Math.min(p, to));
+        }
+        int s = Math.max(from, p) - p;
+        int e = to - p;
+        if (s < e) {
+            text.append(m_buffer, pieceStart + s, pieceStart + e);
+        }
+    }
+
+    private int rendered(int id) {
+        return m_lengths[id] + (id > 0 ? 1 : 0);
+    }
+
+    private int tailLength() {
+        return m_tail.length() == 0 ? 0 : m_tail.length() + (m_count > 0 ? 1 : 0);
+    }
+
+    private void add(int id, int delta) {
+        for (int i = id + 1; i < m_tree.length; i += i & -i) {
+            m_tree[i] += delta;
+        }
+    }
+
+    /**
+     * Total rendered length of the first n segments.
+     */
+    private int prefix(int n) {
+        int sum = 0;
+        for (int i = n; i > 0; i -= i & -i) {
+            sum += m_tree[i];
+        }
+        return sum;
+    }
+
+    /**
+     * Index of the segment containing the given offset, which must be below prefix(m_count).
+     */
+    private int find(int offset) {
+        int pos = 0;
+        int step = Integer.highestOneBit(m_tree.length - 1);
+        for (; step > 0; step >>= 1) {
+            int next = pos + step;
+            if (next < m_tree.length && m_tree[next] <= offset) {
+                pos = next;
+                offset -= m_tree[next];
+            }
+        }
+        return pos;
+    }
+
+    private void grow() {
+        int capacity = m_starts.length * 2;
+        m_starts = Arrays.copyOf(m_starts, capacity);
+        m_lengths = Arrays.copyOf(m_lengths, capacity);
+        m_tree = new int[capacity + 1];
+        for (int id = 0; id < m_count; id++) {
+            add(id, rendered(id));
+        }
+    }
+}
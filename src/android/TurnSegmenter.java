@@ -0,0 +1,390 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import java.util.ArrayList;
+
+import org.json.JSONException;
+import org.json.JSONObject;
+
+/**
+ * Streaming speaker-change detector for long dictation.
+ *
+ * Each 20 ms frame is turned into a 24 band log-mel vector.  Speech frames go into
+ * two adjacent sliding windows whose per-band mean and variance are kept as running
+ * sums, so every frame costs O(bands) on top of the FFT.  The symmetric Gaussian
+ * divergence between the windows peaks at a speaker change; a peak above the
+ * threshold that holds for a quarter window, at least minTurnMs after the previous
+ * change, starts a new turn.  Turns
+ * are assigned a speaker id by comparing the new window against the speakers seen so far.
+ *
+ * This stands in for a distance between speaker embeddings: there is no embedding model
+ * on the device and shipping one would mean a model download and a neural network forward pass
+ * per window.  A diagonal Gaussian per window is what a BIC/GLR segmenter compares; it
+ * separates voices with different pitch and formant ranges, which is what turn-taking in
+ * dictation needs, but unlike an embedding it also reacts to a change of microphone or
+ * room, and similar voices can end up as one speaker.
+ */
+public class TurnSegmenter {
+
+    private static final int FRAME = AudioCapture.FRAME_SAMPLES;
+    private static final int FFT_SIZE = 512;
+    private static final int BINS = FFT_SIZE / 2 + 1;
+    private static final int BANDS = 24;
+    private static final float MIN_HZ = 100f;
+    private static final float MAX_HZ = 7600f;
+    private static final float SPEECH_GATE = 1e-5f;     // mean band power, ~ -50 dBFS
+    private static final float VARIANCE_FLOOR = 1e-3f;
+    private static final int FRAME_MS = FRAME * 1000 / AudioCapture.SAMPLE_RATE;
+
+    public static class Turn {
+        public final int id;
+        public final int speaker;
+        public final long startSample;
+
+        Turn(int id, int speaker, long startSample) {
+            this.id = id;
+            this.speaker = speaker;
+            this.startSample = startSample;
+        }
+
+        public JSONObject toJSON() {
+            JSONObject turn = new JSONObject();
+            try {
+                turn.put("id", id);
+                turn.put("speaker", speaker);
+                turn.put("startMs", startSample * 1000 / AudioCapture.SAMPLE_RATE);
+            } catch (JSONException e) {
+                // this will never happen
+            }
+            return turn;
+        }
+    }
+
+    // Configuration
+    int m_windowFrames = 50;                            // 1 s of speech per side
+    int m_minTurnFrames = 100;                          // 2 s
+    float m_threshold = 1.5f;
+    float m_speakerThreshold = 1.0f;
+    boolean m_sessionPerTurn = false;
+
+    private final Fft m_fft = new Fft(FFT_SIZE);
+    private final float[] m_hann = new float[FRAME];
+    private final float[] m_re = new float[FFT_SIZE];
+    private final float[] m_im = new float[FFT_SIZE];
+    private final int[] m_bandStart = new int[BANDS];
+    private final float[][] m_bandWeights = new float[BANDS][];
+    private final float[] m_mel = new float[BANDS];
+
+    // Speech frame history: the left window followed by the right window.
+    private float[] m_history;
+    private long[] m_historySample;
+    private int m_historyHead;
+    private int m_historyCount;
+    private final double[] m_leftSum = new double[BANDS];
+    private final double[] m_leftSquares = new double[BANDS];
+    private final double[] m_rightSum = new double[BANDS];
+    private final double[] m_rightSquares = new double[BANDS];
+    private final float[] m_meanA = new float[BANDS];
+    private final float[] m_varA = new float[BANDS];
+    private final float[] m_meanB = new float[BANDS];
+    private final float[] m_varB = new float[BANDS];
+
+    private volatile long m_samples;
+    private long m_lastChangeSample;
+    private float m_peakDistance;
+    private long m_peakBoundary;
+    private int m_framesSincePeak;
+    private final ArrayList<Turn> m_turns = new ArrayList<Turn>();
+    private final ArrayList<float[]> m_speakerMeans = new ArrayList<float[]>();
+    private final ArrayList<float[]> m_speakerVars = new ArrayList<float[]>();
+
+    public TurnSegmenter() {
+        for (int i = 0; i < FRAME; i++) {
+            m_hann[i] = (float) (0.5 - 0.5 * Math.cos(2 * Math.PI * i / FRAME));
+        }
+        buildMelFilters();
+        allocateHistory();
+        reset();
+    }
+
+    /**
+     * Reads the "turns" init option.
+     */
+    public void configure(JSONObject options) {
+        if (options == null) {
+            return;
+        }
+        m_windowFrames = Math.max(10, options.optInt("windowMs", m_windowFrames * FRAME_MS) / FRAME_MS);
+        m_minTurnFrames = options.optInt("minTurnMs", m_minTurnFrames * FRAME_MS) / FRAME_MS;
+        m_threshold = (float) options.optDouble("threshold", m_threshold);
+        m_speakerThreshold = (float) options.optDouble("speakerThreshold", m_speakerThreshold);
+        m_sessionPerTurn = options.optBoolean("sessionPerTurn", m_sessionPerTurn);
+        allocateHistory();
+        reset();
+    }
+
+    public boolean isSessionPerTurn() {
+        return m_sessionPerTurn;
+    }
+
+    public synchronized void reset() {
+        m_historyHead = 0;
+        m_historyCount = 0;
+        for (int b = 0; b < BANDS; b++) {
+            m_leftSum[b] = 0;
+            m_leftSquares[b] = 0;
+            m_rightSum[b] = 0;
+            m_rightSquares[b] = 0;
+        }
+        m_samples = 0;
+        m_lastChangeSample = 0;
+        m_peakDistance = 0;
+        m_peakBoundary = 0;
+        m_framesSincePeak = 0;
+        m_turns.clear();
+        m_speakerMeans.clear();
+        m_speakerVars.clear();
+        m_turns.add(new Turn(0, 0, 0));
+    }
+
+    /**
+     * Processes one frame. Returns the new turn if a speaker change was detected.
+     */
+    public Turn process(short[] frame, int length) {
+        long frameStart = m_samples;
+        m_samples += length;
+        if (length != FRAME) {
+            return null;
+        }
+
+        computeLogMel(frame);
+        if (m_mel[BANDS - 1] == Float.NEGATIVE_INFINITY) {
+            return null;                                // below the speech gate
+        }
+        push(frameStart);
+
+        int window = m_windowFrames;
+        if (m_historyCount < 2 * window) {
+            return null;
+        }
+
+        stats(m_leftSum, m_leftSquares, window, m_meanA, m_varA);
+        stats(m_rightSum, m_rightSquares, window, m_meanB, m_varB);
+        float distance = divergence(m_meanA, m_varA, m_meanB, m_varB);
+        long boundary = m_historySample[(m_historyHead + window) % (2 * window)];
+
+        Turn turn = null;
+        // The distance wobbles as syllables enter and leave the windows, so a peak only
+        // counts once nothing higher has followed it for a quarter window.
+        if (distance > m_threshold && distance > m_peakDistance) {
+            m_peakDistance = distance;
+            m_peakBoundary = boundary;
+            m_framesSincePeak = 0;
+        } else if (m_peakDistance > 0 && (++m_framesSincePeak >= window / 4 || distance < m_threshold)) {
+            if (m_peakBoundary - m_lastChangeSample >= (long) m_minTurnFrames * FRAME) {
+                turn = startTurn(m_peakBoundary);
+            }
+            m_peakDistance = 0;
+        }
+        return turn;
+    }
+
+    public synchronized Turn getCurrentTurn() {
+        return m_turns.get(m_turns.size() - 1);
+    }
+
+    /**
+     * The turn covering the given capture position.
+     */
+    public synchronized Turn turnAt(long sample) {
+        for (int i = m_turns.size() - 1; i > 0; i--) {
+            if (m_turns.get(i).startSample <= sample) {
+                return m_turns.get(i);
+            }
+        }
+        return m_turns.get(0);
+    }
+
+    public long getSamples() {
+        return m_samples;
+    }
+
+    private synchronized Turn startTurn(long startSample) {
+        if (m_speakerMeans.isEmpty()) {
+            m_speakerMeans.add(m_meanA.clone());
+            m_speakerVars.add(m_varA.clone());
+        }
+
+        int speaker = -1;
+        float best = Float.MAX_VALUE;
+        for (int s = 0; s < m_speakerMeans.size(); s++) {
+            float d = divergence(m_speakerMeans.get(s), m_speakerVars.get(s), m_meanB, m_varB);
+            if (d < best) {
+                best = d;
+                speaker = s;
+            }
+        }
+        if (best > m_speakerThreshold) {
+            speaker = m_speakerMeans.size();
+            m_speakerMeans.add(m_meanB.clone());
+            m_speakerVars.add(m_varB.clone());
+        } else {
+            float[] mean = m_speakerMeans.get(speaker);
+            float[] var = m_speakerVars.get(speaker);
+            for (int b = 0; b < BANDS; b++) {
+                mean[b] = 0.8f * mean[b] + 0.2f * m_meanB[b];
+                var[b] = 0.8f * var[b] + 0.2f * m_varB[b];
+            }
+        }
+
+        Turn turn = new Turn(m_turns.size(), speaker, startSample);
+        m_turns.add(turn);
+        m_lastChangeSample = startSample;
+        return turn;
+    }
+
+    private void computeLogMel(short[] frame) {
+        for (int i = 0; i < FRAME; i++) {
+            m_re[i] = frame[i] / 32768f * m_hann[i];
+            m_im[i] = 0;
+        }
+        for (int i = FRAME; i < FFT_SIZE; i++) {
+            m_re[i] = 0;
+            m_im[i] = 0;
+        }
+        m_fft.transform(m_re, m_im, false);
+
+        float total = 0;
+        for (int b = 0; b < BANDS; b++) {
+            float[] weights = m_bandWeights[b];
+            int start = m_bandStart[b];
+            float energy = 0;
+            for (int i = 0; i < weights.length; i++) {
+                int k = start + i;
+                energy += weights[i] * (m_re[k] * m_re[k] + m_im[k] * m_im[k]);
+            }
+            m_mel[b] = energy;
+            total += energy;
+        }
+        if (total / BANDS < SPEECH_GATE * FFT_SIZE) {
+            m_mel[BANDS - 1] = Float.NEGATIVE_INFINITY;
+            return;
+        }
+        for (int b = 0; b < BANDS; b++) {
+            m_mel[b] = (float) Math.log(m_mel[b] + 1e-10f);
+        }
+    }
+
+    /**
+     * Appends the current log-mel frame; the oldest right frame moves to the left
+     * window and the oldest left frame drops out.
+     */
+    private void push(long frameStart) {
+        int window = m_windowFrames;
+        int capacity = 2 * window;
+        if (m_historyCount == capacity) {
+            int oldest = m_historyHead;
+            int middle = (m_historyHead + window) % capacity;
+            for (int b = 0; b < BANDS; b++) {
+                float left = m_history[oldest * BANDS + b];
+                float moved = m_history[middle * BANDS + b];
+                m_leftSum[b] += moved - left;
+                m_leftSquares[b] += moved * moved - left * left;
+                m_rightSum[b] -= moved;
+                m_rightSquares[b] -= moved * moved;
+            }
+            m_historyHead = (m_historyHead + 1) % capacity;
+            m_historyCount--;
+        }
+
+        int slot = (m_historyHead + m_historyCount) % capacity;
+        System.arraycopy(m_mel, 0, m_history, slot * BANDS, BANDS);
+        m_historySample[slot] = frameStart;
+        for (int b = 0; b < BANDS; b++) {
+            float v = m_mel[b];
+            if (m_historyCount < window) {
+                m_leftSum[b] += v;
+                m_leftSquares[b] += v * v;
+            } else {
+                m_rightSum[b] += v;
+                m_rightSquares[b] += v * v;
+            }
+        }
+        m_historyCount++;
+    }
+
+    private static void stats(double[] sum, double[] squares, int count, float[] mean, float[] var) {
+        for (int b = 0; b < BANDS; b++) {
+            double m = sum[b] / count;
+            mean[b] = (float) m;
+            var[b] = (float) Math.max(squares[b] / count - m * m, VARIANCE_FLOOR);
+        }
+    }
+
+    /**
+     * Symmetric KL divergence between two diagonal Gaussians, averaged over bands.
+     */
+    private static float divergence(float[] meanA, float[] varA, float[] meanB, float[] varB) {
+        float d = 0;
+        for (int b = 0; b < BANDS; b++) {
+            float diff = meanA[b] - meanB[b];
+            d += varA[b] / varB[b] + varB[b] / varA[b] - 2 + diff * diff * (1 / varA[b] + 1 / varB[b]);
+        }
+        return 0.5f * d / BANDS;
+    }
+
+    private void allocateHistory() {
+        m_history = new float[2 * m_windowFrames * BANDS];
+        m_historySample = new long[2 * m_windowFrames];
+    }
+
+    private void buildMelFilters() {
+        double minMel = hzToMel(MIN_HZ);
+        double maxMel = hzToMel(MAX_HZ);
+        int[] edges = new int[BANDS + 2];
+        for (int i = 0; i < BANDS + 2; i++) {
+            double hz = melToHz(minMel + (maxMel - minMel) * i / (BANDS + 1));
+            edges[i] = (int) Math.floor(hz * FFT_SIZE / AudioCapture.SAMPLE_RATE);
+        }
+        for (int b = 0; b < BANDS; b++) {
+            int lo = edges[b];
+            int center = Math.max(edges[b + 1], lo + 1);
+            int hi = Math.max(edges[b + 2], center + 1);
+            hi = Math.min(hi, BINS - 1);
+            float[] weights = new float[hi - lo + 1];
+            for (int k = lo; k <= hi; k++) {
+                weights[k - lo] = k <= center
+                        ? (float) (k - lo) / (center - lo)
+                        : (float) (hi - k) / Math.max(hi - center, 1);
+            }
+            m_bandStart[b] = lo;
+            m_bandWeights[b] = weights;
+        }
+    }
+
+    private static double hzToMel(double hz) {
+        return 2595 * Math.log10(1 + hz / 700);
+    }
+
+    private static double melToHz(double mel) {
+        return 700 * (Math.pow(10, mel / 2595) - 1);
+    }
+}
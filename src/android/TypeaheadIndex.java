@@ -0,0 +1,346 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import java.io.File;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.Comparator;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Locale;
+import java.util.Map;
+import java.util.PriorityQueue;
+
+import org.json.JSONArray;
+import org.json.JSONException;
+import org.json.JSONObject;
+
+import android.util.Log;
+
+/**
+ * Frequency weighted typeahead over past final results (and service suggestions where the
+ * SDK delivers them).
+ *
+ * The persisted index is a memory mapped CompactTrie; phrases seen since it was written are
+ * counted in a small in-memory map and folded in by persist(), which rebuilds the file in the
+ * background and swaps the mapping.  A prefix query is a best-first walk ordered by the
+ * subtree maxima stored in the trie, so it only visits the branches that can still make the
+ * top k, plus a scan of the pending map.
+ */
+public class TypeaheadIndex {
+
+    public static class Completion {
+        public final String text;
+        public final int weight;
+
+        Completion(String text, int weight) {
+            this.text = text;
+            this.weight = weight;
+        }
+    }
+
+    /** Best-first queue entry: a node still to expand, or a key ending at a node. */
+    private static class Step {
+        final int node;
+        final String key;
+        final int priority;
+        final boolean terminal;
+
+        Step(int node, String key, int priority, boolean terminal) {
+            this.node = node;
+            this.key = key;
+            this.priority = priority;
+            this.terminal = terminal;
+        }
+    }
+
+    private static final Comparator<Step> BY_PRIORITY = new Comparator<Step>() {
+        public int compare(Step a, Step b) {
+            return b.priority - a.priority;
+        }
+    };
+
+    private static final Comparator<Completion> BY_WEIGHT = new Comparator<Completion>() {
+        public int compare(Completion a, Completion b) {
+            return b.weight != a.weight ? b.weight - a.weight : a.text.compareTo(b.text);
+        }
+    };
+
+    private final File m_file;
+    private int m_maxEntries = 50000;
+    private int m_maxLength = 200;
+    private int m_persistAfter = 100;
+    private int m_limit = 5;
+
+    private volatile CompactTrie m_trie = null;
+    private final HashMap<String, Integer> m_pending = new HashMap<String, Integer>();
+    private boolean m_persisting = false;
+
+    // Metrics
+    private long m_queries = 0;
+    private long m_queryNanos = 0;
+    private long m_loadNanos = 0;
+
+    public TypeaheadIndex(File file) {
+        m_file = file;
+    }
+
+    /**
+     * Reads the "typeahead" init option.
+     */
+    public void configure(JSONObject options) {
+        if (options == null) {
+            return;
+        }
+        m_maxEntries = options.optInt("maxEntries", m_maxEntries);
+        m_maxLength = options.optInt("maxLength", m_maxLength);
+        m_persistAfter = options.optInt("persistAfter", m_persistAfter);
+        m_limit = options.optInt("limit", m_limit);
+    }
+
+    /**
+     * Completions offered per partial.
+     */
+    public int getLimit() {
+        return m_limit;
+    }
+
+    /**
+     * Maps the persisted index, if there is one.
+     */
+    public void load() {
+        if (!m_file.exists()) {
+            return;
+        }
+        long start = System.nanoTime();
+        try {
+            m_trie = CompactTrie.load(m_file);
+        } catch (IOException e) {
+            Log.d("OxfordSpeechRecognition", "typeahead load failed " + e);
+        }
+        m_loadNanos = System.nanoTime() - start;
+    }
+
+    /**
+     * Lower case, letters, digits and apostrophes only, single spaces. Partials and finals
+     * differ in casing and punctuation, so both are compared in this form.
+     */
+    public static String normalize(String text) {
+        if (text == null) {
+            return "";
+        }
+        StringBuilder normalized = new StringBuilder(text.length());
+        boolean space = false;
+        for (int i = 0; i < text.length(); i++) {
+            char c = text.charAt(i);
+            if (Character.isLetterOrDigit(c) || c == '\'') {
+                if (space && normalized.length() > 0) {
+                    normalized.append(' ');
+                }
+                space = false;
+                normalized.append(c);
+            } else if (Character.isWhitespace(c)) {
+                space = true;
+            }
+        }
+        return normalized.toString().toLowerCase(Locale.ROOT);
+    }
+
+    /**
+     * Counts an occurrence of a phrase. Returns true once enough phrases are pending that the
+     * index should be persisted.
+     */
+    public synchronized boolean add(String text, int weight) {
+        String key = normalize(text);
+        if (key.length() == 0 || key.length() > m_maxLength) {
+            return false;
+        }
+        Integer pending = m_pending.get(key);
+        m_pending.put(key, (pending != null ? pending : 0) + weight);
+        return m_pending.size() >= m_persistAfter && !m_persisting;
+    }
+
+    /**
+     * The most frequent phrases starting with the prefix, best first.
+     */
+    public List<Completion> query(String text, int limit) {
+        long start = System.nanoTime();
+        String prefix = normalize(text);
+        HashMap<String, Completion> found = new HashMap<String, Completion>();
+        CompactTrie trie = m_trie;
+
+        if (trie != null && limit > 0) {
+            int node = trie.find(prefix);
+            if (node >= 0) {
+                PriorityQueue<Step> queue = new PriorityQueue<Step>(16, BY_PRIORITY);
+                queue.add(new Step(node, prefix, trie.maxWeight(node), false));
+                while (!queue.isEmpty() && found.size() < limit) {
+                    Step step = queue.poll();
+                    if (step.terminal) {
+                        found.put(step.key, new Completion(step.key, step.priority));
+                        continue;
+                    }
+                    if (trie.weight(step.node) > 0) {
+                        queue.add(new Step(step.node, step.key, trie.weight(step.node), true));
+                    }
+                    int edges = trie.edgeCount(step.node);
+                    for (int i = 0; i < edges; i++) {
+                        int child = trie.edgeChild(step.node, i);
+                        queue.add(new Step(child, step.key + trie.edgeChar(step.node, i), trie.maxWeight(child), false));
+                    }
+                }
+            }
+        }
+
+        // Pending counts only add weight, so they are merged on top of the persisted top k.
+        synchronized (this) {
+            for (Map.Entry<String, Integer> entry : m_pending.entrySet()) {
+                String key = entry.getKey();
+                if (key.startsWith(prefix)) {
+                    int base = 0;
+                    if (trie != null) {
+                        int node = trie.find(key);
+                        base = node >= 0 ? trie.weight(node) : 0;
+                    }
+                    found.put(key, new Completion(key, base + entry.getValue()));
+                }
+            }
+        }
+
+        ArrayList<Completion> completions = new ArrayList<Completion>(found.values());
+        Collections.sort(completions, BY_WEIGHT);
+        List<Completion> top = completions.subList(0, Math.min(limit, completions.size()));
+        synchronized (this) {
+            m_queries++;
+            m_queryNanos += System.nanoTime() - start;
+        }
+        return top;
+    }
+
+    /**
+     * Folds the pending phrases into the persisted index, keeping the most frequent
+     * maxEntries. Blocking; run it off the UI and service threads.
+     */
+    public void persist() {
+        HashMap<String, Integer> snapshot;
+        synchronized (this) {
+            if (m_pending.isEmpty() || m_persisting) {
+                return;
+            }
+            m_persisting = true;
+            snapshot = new HashMap<String, Integer>(m_pending);
+        }
+
+        try {
+            HashMap<String, Integer> entries = new HashMap<String, Integer>();
+            CompactTrie trie = m_trie;
+            if (trie != null) {
+                collect(trie, 0, new StringBuilder(), entries);
+            }
+            for (Map.Entry<String, Integer> entry : snapshot.entrySet()) {
+                Integer base = entries.get(entry.getKey());
+                entries.put(entry.getKey(), (base != null ? base : 0) + entry.getValue());
+            }
+
+            ArrayList<Map.Entry<String, Integer>> sorted = new ArrayList<Map.Entry<String, Integer>>(entries.entrySet());
+            if (sorted.size() > m_maxEntries) {
+                Collections.sort(sorted, new Comparator<Map.Entry<String, Integer>>() {
+                    public int compare(Map.Entry<String, Integer> a, Map.Entry<String, Integer> b) {
+                        return b.getValue() - a.getValue();
+                    }
+                });
+            }
+            int count = Math.min(sorted.size(), m_maxEntries);
+            String[] keys = new String[count];
+            int[] weights = new int[count];
+            for (int i = 0; i < count; i++) {
+                keys[i] = sorted.get(i).getKey();
+                weights[i] = sorted.get(i).getValue();
+            }
+            CompactTrie.write(m_file, keys, weights);
+            CompactTrie updated = CompactTrie.load(m_file);
+
+            synchronized (this) {
+                m_trie = updated;
+                // Keep whatever was counted while the file was being written.
+                for (Map.Entry<String, Integer> entry : snapshot.entrySet()) {
+                    Integer pending = m_pending.get(entry.getKey());
+                    int left = (pending != null ? pending : 0) - entry.getValue();
+                    if (left > 0) {
+                        m_pending.put(entry.getKey(), left);
+                    } else {
+                        m_pending.remove(entry.getKey());
+                    }
+                }
+            }
+        } catch (IOException e) {
+            Log.d("OxfordSpeechRecognition", "typeahead persist failed " + e);
+        } finally {
+            synchronized (this) {
+                m_persisting = false;
+            }
+        }
+    }
+
+    private static void collect(CompactTrie trie, int node, StringBuilder key, Map<String, Integer> entries) {
+        if (trie.weight(node) > 0) {
+            entries.put(key.toString(), trie.weight(node));
+        }
+        int edges = trie.edgeCount(node);
+        for (int i = 0; i < edges; i++) {
+            key.append(trie.edgeChar(node, i));
+            collect(trie, trie.edgeChild(node, i), key, entries);
+            key.setLength(key.length() - 1);
+        }
+    }
+
+    public static JSONArray toJSON(List<Completion> completions) {
+        JSONArray items = new JSONArray();
+        try {
+            for (Completion completion : completions) {
+                JSONObject item = new JSONObject();
+                item.put("text", completion.text);
+                item.put("weight", completion.weight);
+                items.put(item);
+            }
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        return items;
+    }
+
+    public synchronized JSONObject toJSON() {
+        JSONObject metrics = new JSONObject();
+        try {
+            CompactTrie trie = m_trie;
+            metrics.put("nodes", trie != null ? trie.getNodeCount() : 0);
+            metrics.put("pending", m_pending.size());
+            metrics.put("loadUs", m_loadNanos / 1000);
+            metrics.put("queries", m_queries);
+            metrics.put("avgQueryUs", m_queries > 0 ? m_queryNanos / m_queries / 1000.0 : 0);
+        } catch (JSONException e) {
+            // this will never happen
+        }
+        return metrics;
+    }
+}
@@ -0,0 +1,68 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+#import <AudioToolbox/AudioToolbox.h>
+
+/**
+* Capture format used by the plugin-owned capture path: 16 kHz mono 16-bit PCM in 20 ms frames.
+*/
+enum {
+    OxfordCaptureSampleRate = 16000,
+    OxfordCaptureFrameSamples = 320
+};
+
+@class OxfordAudioCapture;
+
+@protocol OxfordAudioCaptureDelegate
+
+/**
+* Called on the audio queue thread for every captured frame. The samples are only valid during the
+* call and may be modified in place.
+*/
+-(void)audioCapture:(OxfordAudioCapture*)capture didCaptureFrame:(int16_t*)samples count:(int)count;
+
+@end
+
+/**
+* Plugin-owned microphone capture built on an AudioQueue, used when the audio has to be
+* inspected before it is sent to a DataRecognitionClient.
+*/
+@interface OxfordAudioCapture : NSObject
+{
+    AudioQueueRef queue;
+    AudioQueueBufferRef buffers[3];
+}
+
+@property (nonatomic,weak) id<OxfordAudioCaptureDelegate> delegate;
+@property (atomic,readonly) BOOL isRunning;
+
+-(id)initWithDelegate:(id<OxfordAudioCaptureDelegate>)delegate;
+
+/**
+* Starts the audio queue. Returns NO if the queue could not be created or started.
+*/
+-(BOOL)start;
+
+/**
+* Stops and disposes the audio queue. Must not be called from the delegate callback.
+*/
+-(void)stop;
+
+@end
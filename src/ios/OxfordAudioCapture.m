@@ -0,0 +1,114 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import "OxfordAudioCapture.h"
+
+@interface OxfordAudioCapture ()
+@property (atomic,readwrite) BOOL isRunning;
+@end
+
+static void OxfordAudioCaptureInput(void* userData,
+                                    AudioQueueRef queue,
+                                    AudioQueueBufferRef buffer,
+                                    const AudioTimeStamp* startTime,
+                                    UInt32 packetCount,
+                                    const AudioStreamPacketDescription* packetDescs)
+{
+    OxfordAudioCapture* capture = (__bridge OxfordAudioCapture*)userData;
+    if (!capture.isRunning) {
+        return;
+    }
+    if (packetCount > 0) {
+        [capture.delegate audioCapture:capture
+                       didCaptureFrame:(int16_t*)buffer->mAudioData
+                                 count:(int)packetCount];
+    }
+    if (capture.isRunning) {
+        AudioQueueEnqueueBuffer(queue, buffer, 0, NULL);
+    }
+}
+
+@implementation OxfordAudioCapture
+
+-(id)initWithDelegate:(id<OxfordAudioCaptureDelegate>)delegate
+{
+    self = [super init];
+    if (self) {
+        self.delegate = delegate;
+        queue = NULL;
+    }
+    return self;
+}
+
+-(BOOL)start
+{
+    if (self.isRunning) {
+        return YES;
+    }
+
+    AudioStreamBasicDescription format = {0};
+    format.mSampleRate = OxfordCaptureSampleRate;
+    format.mFormatID = kAudioFormatLinearPCM;
+    format.mFormatFlags = kLinearPCMFormatFlagIsSignedInteger | kLinearPCMFormatFlagIsPacked;
+    format.mChannelsPerFrame = 1;
+    format.mBitsPerChannel = 16;
+    format.mBytesPerFrame = 2;
+    format.mFramesPerPacket = 1;
+    format.mBytesPerPacket = 2;
+
+    OSStatus status = AudioQueueNewInput(&format, OxfordAudioCaptureInput, (__bridge void*)self, NULL, NULL, 0, &queue);
+    if (status != noErr) {
+        NSLog(@"OxfordSR - AudioQueueNewInput failed %d", (int)status);
+        queue = NULL;
+        return NO;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        AudioQueueAllocateBuffer(queue, OxfordCaptureFrameSamples * 2, &buffers[i]);
+        AudioQueueEnqueueBuffer(queue, buffers[i], 0, NULL);
+    }
+
+    self.isRunning = YES;
+    status = AudioQueueStart(queue, NULL);
+    if (status != noErr) {
+        NSLog(@"OxfordSR - AudioQueueStart failed %d", (int)status);
+        self.isRunning = NO;
+        AudioQueueDispose(queue, true);
+        queue = NULL;
+        return NO;
+    }
+    return YES;
+}
+
+-(void)stop
+{
+    self.isRunning = NO;
+    if (queue != NULL) {
+        AudioQueueStop(queue, true);
+        AudioQueueDispose(queue, true);
+        queue = NULL;
+    }
+}
+
+-(void)dealloc
+{
+    [self stop];
+}
+
+@end
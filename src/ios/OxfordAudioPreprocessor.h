@@ -0,0 +1,55 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+
+/**
+* Optional pre-processing chain run on the capture thread before audio is uploaded:
+* a spectral-subtraction noise suppressor followed by an automatic gain control.
+* The suppressor uses 20 ms sqrt-Hann windows with a 10 ms hop (fixed 10 ms latency).
+* All buffers live in the object; process does not allocate.
+*/
+@interface OxfordAudioPreprocessor : NSObject
+
+@property (nonatomic) BOOL noiseSuppression;
+@property (nonatomic) BOOL agc;
+@property (nonatomic) BOOL echoCancellation;
+@property (nonatomic) float overSubtraction;
+@property (nonatomic) float gainFloor;
+@property (nonatomic) float agcTarget;
+@property (nonatomic) float agcMaxGain;
+
+/**
+* Creates a preprocessor configured from the "preprocessing" init option.
+*/
+-(id)initWithOptions:(NSDictionary*)options;
+
+-(void)reset;
+
+/**
+* Fixed latency added by the chain.
+*/
+-(int)latencyMs;
+
+/**
+* Processes a frame in place. The count should be a multiple of 10 ms.
+*/
+-(void)process:(int16_t*)samples count:(int)count;
+
+@end
@@ -0,0 +1,216 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import "OxfordAudioPreprocessor.h"
+#import "OxfordAudioCapture.h"
+#import <Accelerate/Accelerate.h>
+
+#define OXFORD_PP_HOP 160                       // 10 ms
+#define OXFORD_PP_WINDOW (OXFORD_PP_HOP * 2)
+#define OXFORD_PP_LOG2N 9
+#define OXFORD_PP_FFT_SIZE (1 << OXFORD_PP_LOG2N)
+#define OXFORD_PP_HALF (OXFORD_PP_FFT_SIZE / 2)
+
+static const int kNoiseInitHops = 10;           // first 100 ms assumed to be noise
+static const float kNoiseSmoothing = 0.05f;      // per hop, while the bin has no speech
+static const float kSpeechRatio = 4.0f;          // 6 dB over the noise counts as speech
+static const float kNoiseRise = 1.002f;          // ~0.9 dB/s, lets a louder noise take over
+static const float kAgcGate = 0.0056f;          // -45 dBFS, don't amplify silence
+static const float kAgcAttack = 0.5f;
+static const float kAgcRelease = 0.05f;
+
+@implementation OxfordAudioPreprocessor
+{
+    FFTSetup fftSetup;
+    float window[OXFORD_PP_WINDOW];
+    float input[OXFORD_PP_WINDOW];
+    float overlap[OXFORD_PP_HOP];
+    float buffer[OXFORD_PP_FFT_SIZE];
+    float realp[OXFORD_PP_HALF];
+    float imagp[OXFORD_PP_HALF];
+    float noise[OXFORD_PP_HALF + 1];
+    int noiseHops;
+    float agcGain;
+}
+
+-(id)initWithOptions:(NSDictionary*)options
+{
+    self = [super init];
+    if (self) {
+        self.noiseSuppression = YES;
+        self.agc = YES;
+        self.echoCancellation = NO;
+        self.overSubtraction = 2.0f;
+        self.gainFloor = 0.1f;
+        float targetDbfs = -20.0f;
+        float maxGainDb = 20.0f;
+
+        if ([options isKindOfClass:[NSDictionary class]]) {
+            if (options[@"noiseSuppression"]) self.noiseSuppression = [options[@"noiseSuppression"] boolValue];
+            if (options[@"agc"]) self.agc = [options[@"agc"] boolValue];
+            if (options[@"echoCancellation"]) self.echoCancellation = [options[@"echoCancellation"] boolValue];
+            if (options[@"overSubtraction"]) self.overSubtraction = [options[@"overSubtraction"] floatValue];
+            if (options[@"gainFloor"]) self.gainFloor = [options[@"gainFloor"] floatValue];
+            if (options[@"agcTargetDbfs"]) targetDbfs = [options[@"agcTargetDbfs"] floatValue];
+            if (options[@"agcMaxGainDb"]) maxGainDb = [options[@"agcMaxGainDb"] floatValue];
+        }
+        self.agcTarget = powf(10.0f, targetDbfs / 20.0f);
+        self.agcMaxGain = powf(10.0f, maxGainDb / 20.0f);
+
+        fftSetup = vDSP_create_fftsetup(OXFORD_PP_LOG2N, kFFTRadix2);
+        // Periodic sqrt-Hann: analysis * synthesis sums to one at 50% overlap.
+        for (int i = 0; i < OXFORD_PP_WINDOW; i++) {
+            window[i] = sqrtf(0.5f - 0.5f * cosf(2.0f * M_PI * i / OXFORD_PP_WINDOW));
+        }
+        [self reset];
+    }
+    return self;
+}
+
+-(void)dealloc
+{
+    vDSP_destroy_fftsetup(fftSetup);
+}
+
+-(void)reset
+{
+    vDSP_vclr(input, 1, OXFORD_PP_WINDOW);
+    vDSP_vclr(overlap, 1, OXFORD_PP_HOP);
+    vDSP_vclr(noise, 1, OXFORD_PP_HALF + 1);
+    noiseHops = 0;
+    agcGain = 1.0f;
+}
+
+-(int)latencyMs
+{
+    return self.noiseSuppression ? OXFORD_PP_HOP * 1000 / OxfordCaptureSampleRate : 0;
+}
+
+-(void)process:(int16_t*)samples count:(int)count
+{
+    if (self.noiseSuppression) {
+        for (int offset = 0; offset + OXFORD_PP_HOP <= count; offset += OXFORD_PP_HOP) {
+            [self suppress:samples + offset];
+        }
+    }
+    if (self.agc) {
+        [self applyGain:samples count:count];
+    }
+}
+
+-(void)suppress:(int16_t*)samples
+{
+    const float toFloat = 1.0f / 32768.0f;
+    memmove(input, input + OXFORD_PP_HOP, OXFORD_PP_HOP * sizeof(float));
+    vDSP_vflt16(samples, 1, input + OXFORD_PP_HOP, 1, OXFORD_PP_HOP);
+    vDSP_vsmul(input + OXFORD_PP_HOP, 1, &toFloat, input + OXFORD_PP_HOP, 1, OXFORD_PP_HOP);
+
+    vDSP_vmul(input, 1, window, 1, buffer, 1, OXFORD_PP_WINDOW);
+    vDSP_vclr(buffer + OXFORD_PP_WINDOW, 1, OXFORD_PP_FFT_SIZE - OXFORD_PP_WINDOW);
+
+    DSPSplitComplex split = { realp, imagp };
+    vDSP_ctoz((DSPComplex*)buffer, 2, &split, 1, OXFORD_PP_HALF);
+    vDSP_fft_zrip(fftSetup, &split, 1, OXFORD_PP_LOG2N, FFT_FORWARD);
+
+    // Packed format: DC in realp[0], Nyquist in imagp[0].
+    float floor = self.gainFloor * self.gainFloor;
+    for (int k = 0; k <= OXFORD_PP_HALF; k++) {
+        float re, im;
+        if (k == 0) {
+            re = realp[0]; im = 0;
+        } else if (k == OXFORD_PP_HALF) {
+            re = imagp[0]; im = 0;
+        } else {
+            re = realp[k]; im = imagp[k];
+        }
+
+        float power = re * re + im * im;
+        if (noiseHops < kNoiseInitHops) {
+            noise[k] += (power - noise[k]) / (noiseHops + 1);
+        } else if (power < kSpeechRatio * noise[k]) {
+            // Averaging the periodogram, rather than tracking its minima, keeps the estimate at
+            // the mean noise power instead of well below it.
+            noise[k] += kNoiseSmoothing * (power - noise[k]);
+        } else {
+            noise[k] *= kNoiseRise;
+        }
+        float gain = power > 0 ? 1.0f - self.overSubtraction * noise[k] / power : 0;
+        gain = sqrtf(MAX(gain, floor));
+
+        if (k == 0) {
+            realp[0] *= gain;
+        } else if (k == OXFORD_PP_HALF) {
+            imagp[0] *= gain;
+        } else {
+            realp[k] *= gain;
+            imagp[k] *= gain;
+        }
+    }
+    if (noiseHops < kNoiseInitHops) {
+        noiseHops++;
+    }
+
+    vDSP_fft_zrip(fftSetup, &split, 1, OXFORD_PP_LOG2N, FFT_INVERSE);
+    vDSP_ztoc(&split, 1, (DSPComplex*)buffer, 2, OXFORD_PP_HALF);
+
+    // zrip round trip scales by 2N; fold that into the synthesis step.
+    const float inverseScale = 32768.0f / (2.0f * OXFORD_PP_FFT_SIZE);
+    vDSP_vsmul(buffer, 1, &inverseScale, buffer, 1, OXFORD_PP_WINDOW);
+    vDSP_vmul(buffer, 1, window, 1, buffer, 1, OXFORD_PP_WINDOW);
+    vDSP_vadd(buffer, 1, overlap, 1, buffer, 1, OXFORD_PP_HOP);
+    memcpy(overlap, buffer + OXFORD_PP_HOP, OXFORD_PP_HOP * sizeof(float));
+
+    const float low = -32768.0f;
+    const float high = 32767.0f;
+    vDSP_vclip(buffer, 1, &low, &high, buffer, 1, OXFORD_PP_HOP);
+    vDSP_vfixr16(buffer, 1, samples, 1, OXFORD_PP_HOP);
+}
+
+-(void)applyGain:(int16_t*)samples count:(int)count
+{
+    float rms = 0;
+    const float toFloat = 1.0f / 32768.0f;
+    for (int offset = 0; offset < count; offset += OXFORD_PP_FFT_SIZE) {
+        vDSP_Length n = MIN(OXFORD_PP_FFT_SIZE, count - offset);
+        float squares;
+        vDSP_vflt16(samples + offset, 1, buffer, 1, n);
+        vDSP_vsmul(buffer, 1, &toFloat, buffer, 1, n);
+        vDSP_svesq(buffer, 1, &squares, n);
+        rms += squares;
+    }
+    rms = sqrtf(rms / count);
+
+    float target = agcGain;
+    if (rms > kAgcGate) {
+        float desired = MIN(self.agcTarget / rms, self.agcMaxGain);
+        target += (desired < agcGain ? kAgcAttack : kAgcRelease) * (desired - agcGain);
+    }
+
+    // Ramp across the frame to avoid zipper noise.
+    float step = (target - agcGain) / count;
+    float gain = agcGain;
+    for (int i = 0; i < count; i++) {
+        gain += step;
+        float value = samples[i] * gain;
+        samples[i] = (int16_t)lrintf(MAX(-32768.0f, MIN(32767.0f, value)));
+    }
+    agcGain = target;
+}
+
+@end
@@ -0,0 +1,88 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+#import "SpeechSDK/SpeechRecognitionService.h"
+#import "OxfordSessionRecorder.h"
+#import "OxfordConfidenceRetry.h"
+
+@class OxfordAudioPushQueue;
+
+@protocol OxfordAudioPushQueueDelegate
+
+/**
+* Called on the queue thread, with the queue locked, when the queue drains below the low water
+* mark after backpressure was signalled. sequence is that of the last offer before the drain.
+*/
+-(void)audioPushQueue:(OxfordAudioPushQueue*)queue didDrain:(NSUInteger)queuedBytes sequence:(long long)sequence;
+
+@end
+
+/**
+* Bounded queue between pushAudio calls from JS and a DataRecognitionClient.
+*
+* sendAudio doesn't block: the SDK keeps the buffer in its own unbounded queue and uploads it at
+* the audio rate from there. So the queue thread paces itself at the audio rate (a little ahead of
+* it, so the SDK never runs dry) and a chunk counts as queued until the pacing has handed all of it
+* to the client. JS can easily push faster than that. Memory is capped at the capacity: a chunk that doesn't fit is refused. Once the queue
+* crosses the high water mark the caller is told to back off, and the delegate is notified when
+* it has drained below the low water mark again. Lock the queue with @synchronized to read its
+* state consistently with the drain notification.
+*/
+@interface OxfordAudioPushQueue : NSObject
+
+@property (nonatomic,weak) id<OxfordAudioPushQueueDelegate> delegate;
+@property (nonatomic,readonly) NSUInteger capacity;
+@property (readonly) NSUInteger queuedBytes;
+@property (readonly) BOOL backpressure;
+
+/**
+* Also buffers the sent audio for confidence retries.
+*/
+@property (nonatomic,strong) OxfordConfidenceRetry* retryBuffer;
+
+-(id)initWithClient:(DataRecognitionClient*)client
+           recorder:(OxfordSessionRecorder*)recorder
+           capacity:(NSUInteger)capacity
+          highWater:(NSUInteger)highWater
+           lowWater:(NSUInteger)lowWater;
+
+/**
+* Starts the thread that sends the queued audio.
+*/
+-(void)start;
+
+/**
+* Queues a chunk. Returns NO, leaving the queue unchanged, if it would exceed the capacity. The
+* caller's sequence number is passed on to drain notifications, so the caller can tell which of its
+* replies a drain came after.
+*/
+-(BOOL)offer:(NSData*)chunk sequence:(long long)sequence;
+
+/**
+* Sends endAudio once everything queued so far has been sent.
+*/
+-(void)end;
+
+/**
+* Drops whatever is queued and stops without sending endAudio.
+*/
+-(void)cancel;
+
+@end
@@ -0,0 +1,169 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import "OxfordAudioPushQueue.h"
+#import "OxfordAudioCapture.h"
+
+static const NSUInteger OxfordPushBytesPerMs = OxfordCaptureSampleRate * 2 / 1000;
+static const NSUInteger OxfordPushSliceMs = 100;
+static const double OxfordPushLeadMs = 200;
+
+@implementation OxfordAudioPushQueue
+{
+    DataRecognitionClient* client;
+    OxfordSessionRecorder* recorder;
+    NSUInteger highWater;
+    NSUInteger lowWater;
+    NSMutableArray* chunks;
+    NSCondition* condition;
+    BOOL ended;
+    BOOL cancelled;
+    long long sequence;
+}
+
+-(id)initWithClient:(DataRecognitionClient*)dataClient
+           recorder:(OxfordSessionRecorder*)sessionRecorder
+           capacity:(NSUInteger)capacity
+          highWater:(NSUInteger)high
+           lowWater:(NSUInteger)low
+{
+    if (self = [super init]) {
+        client = dataClient;
+        recorder = sessionRecorder;
+        _capacity = capacity;
+        highWater = high;
+        lowWater = low;
+        chunks = [[NSMutableArray alloc] init];
+        condition = [[NSCondition alloc] init];
+    }
+    return self;
+}
+
+-(void)start
+{
+    NSThread* thread = [[NSThread alloc] initWithTarget:self selector:@selector(run) object:nil];
+    thread.name = @"OxfordSR push";
+    [thread start];
+}
+
+-(BOOL)offer:(NSData*)chunk sequence:(long long)offerSequence
+{
+    @synchronized(self) {
+        [condition lock];
+        sequence = offerSequence;
+        BOOL queued = !ended && _queuedBytes + chunk.length <= _capacity;
+        if (queued) {
+            [chunks addObject:chunk];
+            _queuedBytes += chunk.length;
+            if (_queuedBytes >= highWater) {
+                _backpressure = YES;
+            }
+            [condition signal];
+        }
+        [condition unlock];
+        return queued;
+    }
+}
+
+-(void)end
+{
+    [condition lock];
+    ended = YES;
+    [condition signal];
+    [condition unlock];
+}
+
+-(void)cancel
+{
+    @synchronized(self) {
+        [condition lock];
+        cancelled = YES;
+        [chunks removeAllObjects];
+        _queuedBytes = 0;
+        [condition signal];
+        [condition unlock];
+    }
+}
+
+-(void)run
+{
+    double due = 0;                                 // when the next slice is due, in ms
+    while (YES) {
+        [condition lock];
+        while (chunks.count == 0 && !ended && !cancelled) {
+            [condition wait];
+        }
+        if (cancelled) {
+            [condition unlock];
+            return;
+        }
+        NSData* chunk = [chunks firstObject];
+        if (chunk != nil) {
+            [chunks removeObjectAtIndex:0];
+        }
+        [condition unlock];
+        if (chunk == nil) {
+            break;                                  // ended and drained
+        }
+
+        for (NSUInteger offset = 0; offset < chunk.length; ) {
+            NSUInteger length = MIN(OxfordPushSliceMs * OxfordPushBytesPerMs, chunk.length - offset);
+
+            // After an idle gap the schedule restarts from now instead of bursting.
+            double now = [[NSProcessInfo processInfo] systemUptime] * 1000;
+            due = MAX(due, now);
+            [condition lock];
+            while (!cancelled && due - now > OxfordPushLeadMs) {
+                [condition waitUntilDate:[NSDate dateWithTimeIntervalSinceNow:(due - now - OxfordPushLeadMs) / 1000]];
+                now = [[NSProcessInfo processInfo] systemUptime] * 1000;
+            }
+            BOOL stop = cancelled;
+            [condition unlock];
+            if (stop) {
+                return;
+            }
+
+            NSData* slice = offset == 0 && length == chunk.length ? chunk : [chunk subdataWithRange:NSMakeRange(offset, length)];
+            [client sendAudio:slice withLength:(int)length];
+            [recorder writeAudio:slice.bytes length:(uint32_t)length];
+            [self.retryBuffer write:slice.bytes length:length];
+            due += (double)length / OxfordPushBytesPerMs;
+            offset += length;
+
+            @synchronized(self) {
+                if (cancelled) {
+                    // cancel already dropped the count.
+                    return;
+                }
+                _queuedBytes -= MIN(_queuedBytes, length);
+                if (_backpressure && _queuedBytes <= lowWater) {
+                    _backpressure = NO;
+                    // Under the lock, so the notification is ordered with the replies to offer:.
+                    [self.delegate audioPushQueue:self didDrain:_queuedBytes sequence:sequence];
+                }
+            }
+        }
+    }
+
+    NSLog(@"OxfordSR - Push queue finished");
+    [client endAudio];
+    [recorder writeEndAudio];
+}
+
+@end
@@ -0,0 +1,66 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+
+typedef NS_OPTIONS(NSUInteger, OxfordAudioIssue) {
+    OxfordAudioIssue_None = 0,
+    OxfordAudioIssue_Clipping = 1 << 0,
+    OxfordAudioIssue_DcOffset = 1 << 1,
+    OxfordAudioIssue_LowSnr = 1 << 2,
+    OxfordAudioIssue_Silence = 1 << 3
+};
+
+/**
+* Streaming quality analyzer for 16-bit PCM capture frames.
+* Measures peak, RMS, clipping ratio and DC offset per frame with vDSP, and tracks a
+* noise floor / speech level pair to estimate the SNR. The issue set is either reported
+* to the app or used to abort the session locally, depending on the policy.
+*/
+@interface OxfordAudioQualityAnalyzer : NSObject
+
+@property (nonatomic,strong) NSString* policy;
+@property (nonatomic) float maxClipRatio;
+@property (nonatomic) float maxDcOffset;
+@property (nonatomic) float minSnrDb;
+@property (nonatomic) int silenceTimeoutMs;
+@property (nonatomic) int abortAfterMs;
+
+@property (nonatomic,readonly) OxfordAudioIssue issues;
+
+/**
+* Creates an analyzer configured from the "audioQuality" init option.
+*/
+-(id)initWithOptions:(NSDictionary*)options;
+
+-(void)reset;
+
+/**
+* Analyzes one frame and returns the current issue set. Does not allocate.
+*/
+-(OxfordAudioIssue)analyze:(const int16_t*)samples count:(int)count;
+
+/**
+* Whether the policy asks for the session to be aborted locally.
+*/
+-(BOOL)shouldAbort;
+
+-(NSDictionary*)toDictionary;
+
+@end
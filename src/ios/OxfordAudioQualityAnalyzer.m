@@ -0,0 +1,196 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import "OxfordAudioQualityAnalyzer.h"
+#import "OxfordAudioCapture.h"
+#import <Accelerate/Accelerate.h>
+
+#define OXFORD_QA_SCRATCH 512
+
+static const float kClipLevel = 32440.0f / 32768.0f;    // ~ -0.09 dBFS
+static const float kSpeechLevel = 0.0056f;              // -45 dBFS
+static const float kMinLevel = 1.0f / 32768.0f;
+static const float kSmoothing = 0.1f;                   // ~200 ms at 20 ms frames
+static const float kNoiseRise = 1.002f;                 // ~0.9 dB/s at 20 ms frames
+static const float kSpeechDecay = 0.995f;
+
+@implementation OxfordAudioQualityAnalyzer
+{
+    float scratch[OXFORD_QA_SCRATCH];
+
+    float peak;
+    float rms;
+    float avgClipRatio;
+    float avgDcOffset;
+    float noiseFloor;
+    float speechLevel;
+    float snrDb;
+    long long samplesAnalyzed;
+    long long issueSamples;
+    BOOL heardSpeech;
+}
+
+-(id)initWithOptions:(NSDictionary*)options
+{
+    self = [super init];
+    if (self) {
+        self.policy = @"warn";
+        self.maxClipRatio = 0.01f;
+        self.maxDcOffset = 0.05f;
+        self.minSnrDb = 10.0f;
+        self.silenceTimeoutMs = 3000;
+        self.abortAfterMs = 1000;
+
+        if ([options isKindOfClass:[NSDictionary class]]) {
+            if (options[@"policy"]) self.policy = options[@"policy"];
+            if (options[@"maxClipRatio"]) self.maxClipRatio = [options[@"maxClipRatio"] floatValue];
+            if (options[@"maxDcOffset"]) self.maxDcOffset = [options[@"maxDcOffset"] floatValue];
+            if (options[@"minSnrDb"]) self.minSnrDb = [options[@"minSnrDb"] floatValue];
+            if (options[@"silenceTimeoutMs"]) self.silenceTimeoutMs = [options[@"silenceTimeoutMs"] intValue];
+            if (options[@"abortAfterMs"]) self.abortAfterMs = [options[@"abortAfterMs"] intValue];
+        }
+        [self reset];
+    }
+    return self;
+}
+
+-(void)reset
+{
+    peak = 0;
+    rms = 0;
+    avgClipRatio = 0;
+    avgDcOffset = 0;
+    noiseFloor = 0;
+    speechLevel = 0;
+    snrDb = 0;
+    samplesAnalyzed = 0;
+    issueSamples = 0;
+    heardSpeech = NO;
+    _issues = OxfordAudioIssue_None;
+}
+
+-(long long)elapsedMs
+{
+    return samplesAnalyzed * 1000 / OxfordCaptureSampleRate;
+}
+
+-(OxfordAudioIssue)analyze:(const int16_t*)samples count:(int)count
+{
+    if (count <= 0) {
+        return _issues;
+    }
+
+    // Process in scratch sized blocks, accumulating sums so the frame stats are exact.
+    float framePeak = 0;
+    float sumSquares = 0;
+    float sum = 0;
+    vDSP_Length clipped = 0;
+    const float scale = 1.0f / 32768.0f;
+    const float low = -kClipLevel;
+    const float high = kClipLevel;
+
+    for (int offset = 0; offset < count; offset += OXFORD_QA_SCRATCH) {
+        vDSP_Length n = MIN(OXFORD_QA_SCRATCH, count - offset);
+        float blockPeak, blockSquares, blockSum;
+        vDSP_Length nLow = 0, nHigh = 0;
+
+        vDSP_vflt16(samples + offset, 1, scratch, 1, n);
+        vDSP_vsmul(scratch, 1, &scale, scratch, 1, n);
+        vDSP_maxmgv(scratch, 1, &blockPeak, n);
+        vDSP_svesq(scratch, 1, &blockSquares, n);
+        vDSP_sve(scratch, 1, &blockSum, n);
+        vDSP_vclipc(scratch, 1, &low, &high, scratch, 1, n, &nLow, &nHigh);
+
+        framePeak = MAX(framePeak, blockPeak);
+        sumSquares += blockSquares;
+        sum += blockSum;
+        clipped += nLow + nHigh;
+    }
+
+    peak = framePeak;
+    rms = sqrtf(sumSquares / count);
+    avgClipRatio += kSmoothing * ((float)clipped / count - avgClipRatio);
+    avgDcOffset += kSmoothing * (sum / count - avgDcOffset);
+
+    // Minimum statistics noise floor: follow drops immediately, rise slowly.
+    float level = MAX(rms, kMinLevel);
+    if (noiseFloor == 0 || level < noiseFloor) {
+        noiseFloor = level;
+    } else {
+        noiseFloor *= kNoiseRise;
+    }
+    // Speech level: fast attack, slow release, never below the floor.
+    if (level > speechLevel) {
+        speechLevel = level;
+    } else {
+        speechLevel = MAX(noiseFloor, speechLevel * kSpeechDecay);
+    }
+    snrDb = 20.0f * log10f(speechLevel / noiseFloor);
+    if (rms >= kSpeechLevel) {
+        heardSpeech = YES;
+    }
+    samplesAnalyzed += count;
+
+    OxfordAudioIssue issues = OxfordAudioIssue_None;
+    if (avgClipRatio > self.maxClipRatio) {
+        issues |= OxfordAudioIssue_Clipping;
+    }
+    if (fabsf(avgDcOffset) > self.maxDcOffset) {
+        issues |= OxfordAudioIssue_DcOffset;
+    }
+    // Give the level trackers a second to settle before judging the SNR.
+    if (heardSpeech && samplesAnalyzed >= OxfordCaptureSampleRate && snrDb < self.minSnrDb) {
+        issues |= OxfordAudioIssue_LowSnr;
+    }
+    if (!heardSpeech && [self elapsedMs] >= self.silenceTimeoutMs) {
+        issues |= OxfordAudioIssue_Silence;
+    }
+
+    issueSamples = issues != OxfordAudioIssue_None ? issueSamples + count : 0;
+    _issues = issues;
+    return issues;
+}
+
+-(BOOL)shouldAbort
+{
+    return [self.policy isEqualToString:@"abort"] &&
+           _issues != OxfordAudioIssue_None &&
+           issueSamples * 1000 / OxfordCaptureSampleRate >= self.abortAfterMs;
+}
+
+-(NSDictionary*)toDictionary
+{
+    NSMutableArray* names = [[NSMutableArray alloc] init];
+    if (_issues & OxfordAudioIssue_Clipping) [names addObject:@"clipping"];
+    if (_issues & OxfordAudioIssue_DcOffset) [names addObject:@"dcOffset"];
+    if (_issues & OxfordAudioIssue_LowSnr) [names addObject:@"lowSnr"];
+    if (_issues & OxfordAudioIssue_Silence) [names addObject:@"silence"];
+
+    return @{
+        @"peak": @(peak),
+        @"rms": @(rms),
+        @"clipRatio": @(avgClipRatio),
+        @"dcOffset": @(avgDcOffset),
+        @"snrDb": @(snrDb),
+        @"elapsedMs": @([self elapsedMs]),
+        @"issues": names
+    };
+}
+
+@end
@@ -0,0 +1,74 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+#import "SpeechSDK/SpeechRecognitionService.h"
+
+/**
+* Sits between the capture frames and the DataRecognitionClient.
+*
+* Frames are batched into one sendAudio call per interval instead of one per 20 ms frame, and with
+* the speech gate enabled nothing is sent until a few consecutive frames are above the gate level.
+* The frames just before the onset are kept in a pre-roll ring and sent first, so the start of the
+* utterance is not clipped; the leading silence before it never leaves the device. Once open the gate
+* stays open for the session, so trailing silence still reaches the service for its end of speech
+* detection. Everything actually sent is also passed to the delegate, so the session recording and
+* the retry buffer hold exactly what the service got. Used from the capture thread only; the
+* counters may be read from anywhere.
+*/
+@class OxfordAudioSendGate;
+
+@protocol OxfordAudioSendGateDelegate
+
+/**
+* Called after each sendAudio, on the thread that wrote or flushed the gate.
+*/
+-(void)audioSendGate:(OxfordAudioSendGate*)gate didSend:(NSData*)audio;
+
+@end
+
+@interface OxfordAudioSendGate : NSObject
+
+@property (nonatomic,weak) id<OxfordAudioSendGateDelegate> delegate;
+@property (atomic,readonly) long long sentBytes;
+@property (atomic,readonly) long long trimmedBytes;
+@property (atomic,readonly) long long sendCalls;
+
+/**
+* @param gateDbfs the speech onset level, NAN to send everything
+* @param preRollMs kept before the onset; at least the onset window, so no onset frame is lost
+*/
+-(id)initWithClient:(DataRecognitionClient*)client batchMs:(int)batchMs gateDbfs:(float)gateDbfs preRollMs:(int)preRollMs;
+
+/**
+* Send what is batched to the current client and switch to another one.
+*/
+-(void)setClient:(DataRecognitionClient*)client;
+
+/**
+* Called for every frame, after preprocessing.
+*/
+-(void)write:(const int16_t*)samples count:(int)count;
+
+/**
+* Send whatever is batched. Call before endAudio.
+*/
+-(void)flush;
+
+@end
@@ -0,0 +1,139 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import "OxfordAudioSendGate.h"
+#import "OxfordAudioCapture.h"
+
+static const int OxfordBytesPerMs = OxfordCaptureSampleRate * 2 / 1000;
+static const int OxfordOnsetFrames = 3;
+
+@interface OxfordAudioSendGate ()
+@property (atomic,readwrite) long long sentBytes;
+@property (atomic,readwrite) long long trimmedBytes;
+@property (atomic,readwrite) long long sendCalls;
+@end
+
+@implementation OxfordAudioSendGate
+{
+    DataRecognitionClient* client;
+    NSMutableData* batch;
+    NSUInteger batchCapacity;
+
+    float gateLevel;        // linear RMS, 0 when the gate is off
+    NSMutableData* preRoll;
+    NSUInteger preRollHead;
+    NSUInteger preRollLength;
+    int loudFrames;
+    BOOL open;
+}
+
+-(id)initWithClient:(DataRecognitionClient*)dataClient batchMs:(int)batchMs gateDbfs:(float)gateDbfs preRollMs:(int)preRollMs
+{
+    if (self = [super init]) {
+        client = dataClient;
+        batchCapacity = MAX(batchMs, OxfordCaptureFrameSamples * 1000 / OxfordCaptureSampleRate) * OxfordBytesPerMs;
+        batch = [[NSMutableData alloc] initWithCapacity:batchCapacity];
+        open = isnan(gateDbfs);
+        gateLevel = open ? 0 : powf(10, gateDbfs / 20);
+        int onsetMs = OxfordOnsetFrames * OxfordCaptureFrameSamples * 1000 / OxfordCaptureSampleRate;
+        preRoll = [[NSMutableData alloc] initWithLength:open ? 0 : MAX(preRollMs, onsetMs) * OxfordBytesPerMs];
+    }
+    return self;
+}
+
+-(void)setClient:(DataRecognitionClient*)dataClient
+{
+    [self flush];
+    client = dataClient;
+}
+
+-(void)write:(const int16_t*)samples count:(int)count
+{
+    const uint8_t* bytes = (const uint8_t*)samples;
+    NSUInteger length = count * sizeof(int16_t);
+    if (open) {
+        [self append:bytes length:length];
+        return;
+    }
+
+    double sumSquares = 0;
+    for (int i = 0; i < count; i++) {
+        sumSquares += (double)samples[i] * samples[i];
+    }
+    float rms = sqrtf(sumSquares / count) / 32768.0f;
+    loudFrames = rms >= gateLevel ? loudFrames + 1 : 0;
+
+    NSUInteger capacity = preRoll.length;
+    uint8_t* ring = preRoll.mutableBytes;
+    long long overwritten = 0;
+    for (NSUInteger i = 0; i < length; i++) {
+        if (preRollLength == capacity) {
+            overwritten++;
+        } else {
+            preRollLength++;
+        }
+        ring[preRollHead] = bytes[i];
+        preRollHead = (preRollHead + 1) % capacity;
+    }
+    self.trimmedBytes += overwritten;
+    if (loudFrames < OxfordOnsetFrames) {
+        return;
+    }
+
+    open = YES;
+    if (preRollLength > 0) {
+        NSUInteger start = (preRollHead + capacity - preRollLength) % capacity;
+        NSUInteger first = MIN(preRollLength, capacity - start);
+        [self append:ring + start length:first];
+        [self append:ring length:preRollLength - first];
+        preRollLength = 0;
+    }
+}
+
+-(void)append:(const uint8_t*)bytes length:(NSUInteger)length
+{
+    while (length > 0) {
+        NSUInteger n = MIN(length, batchCapacity - batch.length);
+        [batch appendBytes:bytes length:n];
+        bytes += n;
+        length -= n;
+        if (batch.length == batchCapacity) {
+            [self flush];
+        }
+    }
+}
+
+-(void)flush
+{
+    if (batch.length > 0) {
+        NSData* audio = [batch copy];
+        [client sendAudio:audio withLength:(int)audio.length];
+        [self.delegate audioSendGate:self didSend:audio];
+        self.sentBytes += audio.length;
+        self.sendCalls++;
+        batch.length = 0;
+    }
+    if (!open) {
+        // No speech at all; the pre-roll was silence too.
+        self.trimmedBytes += preRollLength;
+        preRollLength = 0;
+    }
+}
+
+@end
@@ -0,0 +1,74 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+
+/**
+* Read-only weighted prefix trie stored in a flat file and memory mapped, so loading it costs one
+* mmap and lookups touch only the pages they walk.
+*
+* File layout (little endian, u32 everywhere):
+*   header:  magic "OXTR" | version | node count | edge count
+*   nodes:   first edge | edge count | weight | max weight in subtree      (node 0 is the root)
+*   edges:   UTF-16 code unit | child node                                  (sorted per node)
+* A weight of 0 means no key ends at the node. Nodes are numbered breadth first, so every node's
+* edges are contiguous and children always come after their parent.
+* The Android CompactTrie reads and writes the same format.
+*/
+@interface OxfordCompactTrie : NSObject
+
+@property (nonatomic,readonly) uint32_t nodeCount;
+@property (nonatomic,readonly) uint32_t edgeCount;
+
+/**
+* Map a trie file. Returns nil if it is missing or not a valid trie.
+*/
++(OxfordCompactTrie*)trieWithContentsOfFile:(NSString*)path;
+
+/**
+* Write a trie of the given keys (NSString) and weights (positive NSNumber). The file is replaced
+* atomically, so a mapped old version is never modified in place.
+*/
++(BOOL)writeEntries:(NSDictionary*)entries toFile:(NSString*)path;
+
+/**
+* The child of a node along the given code unit, or -1.
+*/
+-(int32_t)child:(uint32_t)node unit:(unichar)unit;
+
+-(uint32_t)edgeCount:(uint32_t)node;
+-(unichar)edgeUnit:(uint32_t)node at:(uint32_t)index;
+-(uint32_t)edgeChild:(uint32_t)node at:(uint32_t)index;
+
+/**
+* Weight of the key ending at the node, 0 if none does.
+*/
+-(uint32_t)weight:(uint32_t)node;
+
+/**
+* Highest weight of any key at or below the node.
+*/
+-(uint32_t)maxWeight:(uint32_t)node;
+
+/**
+* The node reached by walking the whole string from the root, or -1.
+*/
+-(int32_t)find:(NSString*)key;
+
+@end
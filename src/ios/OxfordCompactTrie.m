@@ -0,0 +1,232 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import "OxfordCompactTrie.h"
+
+static const uint32_t OxfordTrieMagic = 0x5254584f;    // "OXTR"
+static const uint32_t OxfordTrieVersion = 1;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nodeCount;
+    uint32_t edgeCount;
+} OxfordTrieHeader;
+
+typedef struct {
+    uint32_t firstEdge;
+    uint32_t edgeCount;
+    uint32_t weight;
+    uint32_t maxWeight;
+} OxfordTrieNode;
+
+typedef struct {
+    uint32_t unit;
+    uint32_t child;
+} OxfordTrieEdge;
+
+/**
+* Orders strings by UTF-16 code unit, the order the edges are searched in.
+*/
+static NSComparisonResult OxfordCompareUnits(NSString* a, NSString* b)
+{
+    NSUInteger n = MIN(a.length, b.length);
+    for (NSUInteger i = 0; i < n; i++) {
+        unichar x = [a characterAtIndex:i];
+        unichar y = [b characterAtIndex:i];
+        if (x != y) {
+            return x < y ? NSOrderedAscending : NSOrderedDescending;
+        }
+    }
+    return a.length == b.length ? NSOrderedSame : a.length < b.length ? NSOrderedAscending : NSOrderedDescending;
+}
+
+@implementation OxfordCompactTrie
+{
+    NSData* map;
+    const OxfordTrieNode* nodes;
+    const OxfordTrieEdge* edges;
+}
+
++(OxfordCompactTrie*)trieWithContentsOfFile:(NSString*)path
+{
+    NSData* data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:nil];
+    if (data.length < sizeof(OxfordTrieHeader)) {
+        return nil;
+    }
+    const OxfordTrieHeader* header = data.bytes;
+    if (header->magic != OxfordTrieMagic || header->version != OxfordTrieVersion || header->nodeCount < 1 ||
+        sizeof(OxfordTrieHeader) + (uint64_t)header->nodeCount * sizeof(OxfordTrieNode) +
+            (uint64_t)header->edgeCount * sizeof(OxfordTrieEdge) > data.length) {
+        NSLog(@"OxfordSR - Not a trie file %@", path);
+        return nil;
+    }
+    return [[OxfordCompactTrie alloc] initWithData:data];
+}
+
+-(id)initWithData:(NSData*)data
+{
+    if (self = [super init]) {
+        map = data;
+        const OxfordTrieHeader* header = data.bytes;
+        _nodeCount = header->nodeCount;
+        _edgeCount = header->edgeCount;
+        nodes = (const OxfordTrieNode*)(header + 1);
+        edges = (const OxfordTrieEdge*)(nodes + _nodeCount);
+    }
+    return self;
+}
+
+-(int32_t)child:(uint32_t)node unit:(unichar)unit
+{
+    int64_t lo = nodes[node].firstEdge;
+    int64_t hi = lo + nodes[node].edgeCount - 1;
+    while (lo <= hi) {
+        int64_t mid = (lo + hi) / 2;
+        if (edges[mid].unit < unit) {
+            lo = mid + 1;
+        } else if (edges[mid].unit > unit) {
+            hi = mid - 1;
+        } else {
+            return (int32_t)edges[mid].child;
+        }
+    }
+    return -1;
+}
+
+-(uint32_t)edgeCount:(uint32_t)node
+{
+    return nodes[node].edgeCount;
+}
+
+-(unichar)edgeUnit:(uint32_t)node at:(uint32_t)index
+{
+    return (unichar)edges[nodes[node].firstEdge + index].unit;
+}
+
+-(uint32_t)edgeChild:(uint32_t)node at:(uint32_t)index
+{
+    return edges[nodes[node].firstEdge + index].child;
+}
+
+-(uint32_t)weight:(uint32_t)node
+{
+    return nodes[node].weight;
+}
+
+-(uint32_t)maxWeight:(uint32_t)node
+{
+    return nodes[node].maxWeight;
+}
+
+-(int32_t)find:(NSString*)key
+{
+    int32_t node = 0;
+    for (NSUInteger i = 0; i < key.length && node >= 0; i++) {
+        node = [self child:node unit:[key characterAtIndex:i]];
+    }
+    return node;
+}
+
++(BOOL)writeEntries:(NSDictionary*)entries toFile:(NSString*)path
+{
+    NSArray* keys = [entries.allKeys sortedArrayUsingComparator:^NSComparisonResult(id a, id b) {
+        return OxfordCompareUnits(a, b);
+    }];
+    NSUInteger count = keys.count;
+
+    // Breadth first over ranges of the sorted keys that share a prefix of length depth.
+    NSUInteger capacity = 1024;
+    NSUInteger edgeCapacity = 1024;
+    uint32_t* lo = malloc(capacity * sizeof(uint32_t));
+    uint32_t* hi = malloc(capacity * sizeof(uint32_t));
+    uint32_t* depth = malloc(capacity * sizeof(uint32_t));
+    OxfordTrieNode* trieNodes = malloc(capacity * sizeof(OxfordTrieNode));
+    OxfordTrieEdge* trieEdges = malloc(edgeCapacity * sizeof(OxfordTrieEdge));
+    uint32_t nodeCount = 1;
+    uint32_t edgeCount = 0;
+    lo[0] = 0;
+    hi[0] = (uint32_t)count;
+    depth[0] = 0;
+
+    for (uint32_t n = 0; n < nodeCount; n++) {
+        uint32_t start = lo[n];
+        uint32_t d = depth[n];
+        uint32_t weight = 0;
+        if (start < hi[n] && [keys[start] length] == d) {
+            weight = [entries[keys[start]] unsignedIntValue];
+            start++;
+        }
+        trieNodes[n].firstEdge = edgeCount;
+        trieNodes[n].weight = weight;
+        trieNodes[n].maxWeight = weight;
+
+        uint32_t i = start;
+        while (i < hi[n]) {
+            unichar unit = [keys[i] characterAtIndex:d];
+            uint32_t j = i + 1;
+            while (j < hi[n] && [keys[j] characterAtIndex:d] == unit) {
+                j++;
+            }
+            if (nodeCount == capacity) {
+                capacity *= 2;
+                lo = realloc(lo, capacity * sizeof(uint32_t));
+                hi = realloc(hi, capacity * sizeof(uint32_t));
+                depth = realloc(depth, capacity * sizeof(uint32_t));
+                trieNodes = realloc(trieNodes, capacity * sizeof(OxfordTrieNode));
+            }
+            if (edgeCount == edgeCapacity) {
+                edgeCapacity *= 2;
+                trieEdges = realloc(trieEdges, edgeCapacity * sizeof(OxfordTrieEdge));
+            }
+            lo[nodeCount] = i;
+            hi[nodeCount] = j;
+            depth[nodeCount] = d + 1;
+            trieEdges[edgeCount].unit = unit;
+            trieEdges[edgeCount].child = nodeCount;
+            edgeCount++;
+            nodeCount++;
+            i = j;
+        }
+        trieNodes[n].edgeCount = edgeCount - trieNodes[n].firstEdge;
+    }
+
+    // Children come after their parents, so one backwards pass fills in the subtree maxima.
+    for (int64_t n = nodeCount - 1; n >= 0; n--) {
+        for (uint32_t e = trieNodes[n].firstEdge; e < trieNodes[n].firstEdge + trieNodes[n].edgeCount; e++) {
+            trieNodes[n].maxWeight = MAX(trieNodes[n].maxWeight, trieNodes[trieEdges[e].child].maxWeight);
+        }
+    }
+
+    OxfordTrieHeader header = { OxfordTrieMagic, OxfordTrieVersion, nodeCount, edgeCount };
+    NSMutableData* data = [[NSMutableData alloc] initWithCapacity:sizeof(header) +
+                           nodeCount * sizeof(OxfordTrieNode) + edgeCount * sizeof(OxfordTrieEdge)];
+    [data appendBytes:&header length:sizeof(header)];
+    [data appendBytes:trieNodes length:nodeCount * sizeof(OxfordTrieNode)];
+    [data appendBytes:trieEdges length:edgeCount * sizeof(OxfordTrieEdge)];
+
+    free(lo);
+    free(hi);
+    free(depth);
+    free(trieNodes);
+    free(trieEdges);
+    return [data writeToFile:path atomically:YES];
+}
+
+@end
@@ -0,0 +1,94 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+#import "SpeechSDK/SpeechRecognitionService.h"
+
+/**
+* Score of a result without any phrase, below every Confidence value.
+*/
+enum {
+    OxfordRetryNoMatch = -3
+};
+
+/**
+* A recognized text and its score; the original result or a retry's.
+*/
+@interface OxfordRetryCandidate : NSObject
+
+@property (nonatomic,copy) NSString* text;
+@property (nonatomic) int confidence;
+@property (nonatomic,copy) NSString* language;
+@property (nonatomic) SpeechRecognitionMode mode;
+
+@end
+
+/**
+* Re-recognizes low confidence results with fallback languages or modes.
+*
+* The audio sent since the last final is kept in a bounded buffer. Long dictation finals carry no
+* offsets and arrive after the pause that ends the utterance, often with the next one under way, so
+* the buffer is cut at the start of that pause and what follows stays for the next final. When a
+* final comes back as NoMatch or with Low/None confidence, the buffered audio is sent to one
+* DataRecognitionClient per configured fallback, all in parallel, and the candidate with the best
+* confidence wins, the original included. If the buffer overflowed the audio is incomplete and no retry is made.
+*/
+@interface OxfordConfidenceRetry : NSObject
+
+/**
+* Creates a retrier configured from the "retry" init option. Fallbacks default to the session's
+* language and mode.
+*/
+-(id)initWithOptions:(NSDictionary*)options language:(NSString*)language mode:(SpeechRecognitionMode)mode;
+
+/**
+* Buffer audio sent to the service.
+*/
+-(void)write:(const void*)bytes length:(NSUInteger)length;
+
+-(void)clear;
+
+/**
+* Take the audio of the utterance a final is for, returning a copy of it if a retry is wanted.
+* Returns nil if there is nothing complete to retry with, or if the audio is longer than the
+* timeout: the service takes it at the audio rate, so the retry could not finish in time.
+*/
+-(NSData*)takeAudio:(BOOL)wanted;
+
++(int)score:(RecognitionResult*)response;
+
+/**
+* Score the given phrase of a final, e.g. the one the context booster picked.
+*/
++(int)score:(RecognitionResult*)response phrase:(NSUInteger)phrase;
+
+/**
+* Whether the delivered phrase of a final is weak enough to retry: NoMatch, None or Low confidence.
+*/
+-(BOOL)shouldRetry:(RecognitionResult*)response phrase:(NSUInteger)phrase;
+
+/**
+* Run every fallback on the audio in parallel and return the best candidate. Blocks until all
+* attempts are done or the timeout has passed; ties go to the original.
+*/
+-(OxfordRetryCandidate*)retry:(NSData*)audio original:(OxfordRetryCandidate*)original key:(NSString*)key;
+
+-(NSDictionary*)toDictionary;
+
+@end
@@ -0,0 +1,340 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import "OxfordConfidenceRetry.h"
+#import "OxfordAudioCapture.h"
+
+static const NSUInteger OxfordRetryBytesPerMs = OxfordCaptureSampleRate * 2 / 1000;
+static const NSUInteger OxfordRetryFrameBytes = OxfordCaptureFrameSamples * 2;
+static const float kRetrySpeechLevel = 0.0056f;        // -45 dBFS, as OxfordAudioQualityAnalyzer
+static const int kRetryPauseFrames = 15;               // 300 ms
+
+@implementation OxfordRetryCandidate
+@end
+
+/**
+* One retry session. Collects the finals until the session is over.
+*/
+@interface OxfordRetryAttempt : NSObject<SpeechRecognitionProtocol>
+
+@property (nonatomic,readonly) OxfordRetryCandidate* candidate;
+@property (nonatomic,readonly) dispatch_semaphore_t done;
+@property (nonatomic,strong) DataRecognitionClient* client;
+
+-(id)initWithLanguage:(NSString*)language mode:(SpeechRecognitionMode)mode;
+
+@end
+
+@implementation OxfordRetryAttempt
+{
+    NSMutableString* text;
+    BOOL finished;
+}
+
+-(id)initWithLanguage:(NSString*)language mode:(SpeechRecognitionMode)mode
+{
+    if (self = [super init]) {
+        _candidate = [[OxfordRetryCandidate alloc] init];
+        _candidate.language = language;
+        _candidate.mode = mode;
+        _candidate.confidence = OxfordRetryNoMatch;
+        _candidate.text = @"";
+        _done = dispatch_semaphore_create(0);
+        text = [[NSMutableString alloc] init];
+    }
+    return self;
+}
+
+-(void)finish
+{
+    @synchronized(self) {
+        if (finished) {
+            return;
+        }
+        finished = YES;
+    }
+    dispatch_semaphore_signal(_done);
+}
+
+-(void)onPartialResponseReceived:(NSString*)partialResult
+{
+}
+
+-(void)onFinalResponseReceived:(RecognitionResult*)response
+{
+    BOOL ended = _candidate.mode == SpeechRecognitionMode_ShortPhrase ||
+                 response.RecognitionStatus == RecognitionStatus_EndOfDictation ||
+                 response.RecognitionStatus == RecognitionStatus_DictationEndSilenceTimeout;
+    int score = [OxfordConfidenceRetry score:response];
+    if (score != OxfordRetryNoMatch) {
+        // Long dictation may split the audio; its confidence is the weakest part's.
+        @synchronized(self) {
+            if (text.length > 0) {
+                [text appendString:@" "];
+            }
+            [text appendString:((RecognizedPhrase*)response.RecognizedPhrase[0]).DisplayText ?: @""];
+            _candidate.text = [text copy];
+            _candidate.confidence = _candidate.confidence == OxfordRetryNoMatch ? score : MIN(_candidate.confidence, score);
+        }
+    }
+    if (ended) {
+        [self finish];
+    }
+}
+
+-(void)onIntentReceived:(IntentResult*)intent
+{
+}
+
+-(void)onError:(NSString*)errorMessage withErrorCode:(int)errorCode
+{
+    NSLog(@"OxfordSR - Retry error %d %@", errorCode, errorMessage);
+    [self finish];
+}
+
+-(void)onMicrophoneStatus:(Boolean)recording
+{
+}
+
+@end
+
+@implementation OxfordConfidenceRetry
+{
+    NSMutableArray* fallbacks;
+    int timeoutMs;
+    SpeechRecognitionMode recoMode;
+
+    // Audio since the last final
+    NSMutableData* buffer;
+    NSUInteger capacity;
+    BOOL overflow;
+
+    // Pauses in the buffer, classified a frame at a time
+    NSUInteger scanned;
+    int quietFrames;
+    NSInteger pauseStart;               // latest pause of kRetryPauseFrames after speech
+    BOOL heardSpeech;
+
+    // Metrics
+    int finals;
+    int retried;
+    int attempts;
+    int improved;
+    int skipped;
+    long long addedMs;
+    long long maxAddedMs;
+}
+
+-(id)initWithOptions:(NSDictionary*)options language:(NSString*)language mode:(SpeechRecognitionMode)mode
+{
+    if (self = [super init]) {
+        if (![options isKindOfClass:[NSDictionary class]]) {
+            options = nil;
+        }
+        recoMode = mode;
+        pauseStart = -1;
+        timeoutMs = options[@"timeoutMs"] ? [options[@"timeoutMs"] intValue] : 10000;
+        capacity = (options[@"maxBufferMs"] ? [options[@"maxBufferMs"] unsignedIntegerValue] : 30000) * OxfordRetryBytesPerMs;
+        buffer = [[NSMutableData alloc] initWithCapacity:capacity];
+
+        fallbacks = [[NSMutableArray alloc] init];
+        for (NSDictionary* fallback in options[@"fallbacks"]) {
+            if (![fallback isKindOfClass:[NSDictionary class]]) {
+                continue;
+            }
+            OxfordRetryCandidate* config = [[OxfordRetryCandidate alloc] init];
+            config.language = fallback[@"language"] ?: language;
+            config.mode = fallback[@"mode"] == nil ? mode
+                        : [fallback[@"mode"] isEqual:@"longDictation"] ? SpeechRecognitionMode_LongDictation
+                        : SpeechRecognitionMode_ShortPhrase;
+            [fallbacks addObject:config];
+        }
+    }
+    return self;
+}
+
+-(void)write:(const void*)bytes length:(NSUInteger)length
+{
+    @synchronized(self) {
+        if (buffer.length + length > capacity) {
+            overflow = YES;
+            return;
+        }
+        [buffer appendBytes:bytes length:length];
+        if (recoMode == SpeechRecognitionMode_LongDictation) {
+            [self scan];
+        }
+    }
+}
+
+-(void)clear
+{
+    @synchronized(self) {
+        buffer.length = 0;
+        overflow = NO;
+        scanned = 0;
+        quietFrames = 0;
+        pauseStart = -1;
+        heardSpeech = NO;
+    }
+}
+
+-(NSData*)takeAudio:(BOOL)wanted
+{
+    @synchronized(self) {
+        NSUInteger end = overflow ? buffer.length : [self utteranceEnd];
+        NSData* audio = nil;
+        if (wanted && (overflow || end / OxfordRetryBytesPerMs > (NSUInteger)timeoutMs)) {
+            skipped++;
+        } else if (wanted && end > 0) {
+            audio = [buffer subdataWithRange:NSMakeRange(0, end)];
+        }
+        if (end == buffer.length) {
+            [self clear];
+        } else {
+            // The rest is the pause and whatever was said after it.
+            [buffer replaceBytesInRange:NSMakeRange(0, end) withBytes:NULL length:0];
+            scanned -= end;
+            pauseStart = -1;
+            heardSpeech = quietFrames == 0;
+        }
+        return audio;
+    }
+}
+
+/**
+* Where the utterance of the current final ends: at the start of the pause going on now, or, if
+* speech has resumed, of the latest long pause. Short phrase sessions end at their final, so all of
+* the audio is theirs.
+*/
+-(NSUInteger)utteranceEnd
+{
+    if (recoMode != SpeechRecognitionMode_LongDictation || !heardSpeech) {
+        return buffer.length;
+    }
+    if (quietFrames > 0) {
+        return scanned - quietFrames * OxfordRetryFrameBytes;
+    }
+    return pauseStart > 0 ? (NSUInteger)pauseStart : buffer.length;
+}
+
+/**
+* Classify the whole frames written since the last scan as speech or quiet.
+*/
+-(void)scan
+{
+    const int16_t* samples = buffer.bytes;
+    for (; scanned + OxfordRetryFrameBytes <= buffer.length; scanned += OxfordRetryFrameBytes) {
+        const int16_t* frame = samples + scanned / 2;
+        float energy = 0;
+        for (int i = 0; i < OxfordCaptureFrameSamples; i++) {
+            energy += (float)frame[i] * frame[i];
+        }
+        float rms = sqrtf(energy / OxfordCaptureFrameSamples) / 32768.0f;
+        if (rms >= kRetrySpeechLevel) {
+            quietFrames = 0;
+            heardSpeech = YES;
+        } else if (++quietFrames == kRetryPauseFrames && heardSpeech) {
+            pauseStart = (NSInteger)(scanned - (kRetryPauseFrames - 1) * OxfordRetryFrameBytes);
+        }
+    }
+}
+
++(int)score:(RecognitionResult*)response
+{
+    return [OxfordConfidenceRetry score:response phrase:0];
+}
+
++(int)score:(RecognitionResult*)response phrase:(NSUInteger)phrase
+{
+    if (response.RecognitionStatus == RecognitionStatus_NoMatch || response.RecognizedPhrase.count <= phrase) {
+        return OxfordRetryNoMatch;
+    }
+    return ((RecognizedPhrase*)response.RecognizedPhrase[phrase]).Confidence;
+}
+
+-(BOOL)shouldRetry:(RecognitionResult*)response phrase:(NSUInteger)phrase
+{
+    @synchronized(self) {
+        finals++;
+    }
+    return fallbacks.count > 0 && [OxfordConfidenceRetry score:response phrase:phrase] < SpeechRecoConfidence_Normal;
+}
+
+-(OxfordRetryCandidate*)retry:(NSData*)audio original:(OxfordRetryCandidate*)original key:(NSString*)key
+{
+    NSDate* start = [NSDate date];
+    NSMutableArray* running = [[NSMutableArray alloc] init];
+    for (OxfordRetryCandidate* fallback in fallbacks) {
+        OxfordRetryAttempt* attempt = [[OxfordRetryAttempt alloc] initWithLanguage:fallback.language mode:fallback.mode];
+        [running addObject:attempt];
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            attempt.client = [SpeechRecognitionServiceFactory createDataClient:fallback.mode
+                                                                  withLanguage:fallback.language
+                                                                       withKey:key
+                                                                  withProtocol:attempt];
+            [attempt.client sendAudioFormat:[SpeechAudioFormat create16BitPCMFormat:OxfordCaptureSampleRate]];
+            [attempt.client sendAudio:audio withLength:(int)audio.length];
+            [attempt.client endAudio];
+        });
+    }
+
+    OxfordRetryCandidate* best = original;
+    dispatch_time_t deadline = dispatch_time(DISPATCH_TIME_NOW, (int64_t)timeoutMs * NSEC_PER_MSEC);
+    for (OxfordRetryAttempt* attempt in running) {
+        dispatch_semaphore_wait(attempt.done, deadline);
+        @synchronized(attempt) {
+            if (attempt.candidate.confidence > best.confidence) {
+                best = attempt.candidate;
+            }
+        }
+    }
+
+    long long added = (long long)(-[start timeIntervalSinceNow] * 1000);
+    @synchronized(self) {
+        retried++;
+        attempts += (int)running.count;
+        if (best != original) {
+            improved++;
+        }
+        addedMs += added;
+        maxAddedMs = MAX(maxAddedMs, added);
+    }
+    NSLog(@"OxfordSR - Retry %@ in %lld ms", best != original ? @"improved" : @"kept", added);
+    return best;
+}
+
+-(NSDictionary*)toDictionary
+{
+    @synchronized(self) {
+        return @{
+            @"finals": @(finals),
+            @"retried": @(retried),
+            @"attempts": @(attempts),
+            @"improved": @(improved),
+            @"skipped": @(skipped),
+            @"improvementRate": @(retried > 0 ? (double)improved / retried : 0),
+            @"addedLatencyMs": @(addedMs),
+            @"avgAddedLatencyMs": @(retried > 0 ? addedMs / retried : 0),
+            @"maxAddedLatencyMs": @(maxAddedMs)
+        };
+    }
+}
+
+@end
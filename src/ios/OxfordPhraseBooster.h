@@ -0,0 +1,48 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+#import "SpeechSDK/SpeechRecognitionService.h"
+#import "OxfordCompactTrie.h"
+
+/**
+* Rescores the N-best phrases of a final result against a user vocabulary.
+*
+* The vocabulary is an OxfordCompactTrie of lower case phrases. Each N-best phrase scores its
+* Confidence value plus the boost times the weight of every vocabulary phrase found in it, matched
+* greedily on word boundaries (longest match first). The best score wins; ties keep the service's
+* order.
+*/
+@interface OxfordPhraseBooster : NSObject
+
+@property (atomic,strong) OxfordCompactTrie* vocabulary;
+
+/**
+* Creates a booster configured from the "booster" init option.
+*/
+-(id)initWithOptions:(NSDictionary*)options;
+
+/**
+* Index of the phrase to use, 0 if nothing changes the service's choice.
+*/
+-(NSUInteger)choose:(RecognitionResult*)response;
+
+-(NSDictionary*)toDictionary;
+
+@end
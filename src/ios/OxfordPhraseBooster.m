@@ -0,0 +1,123 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import "OxfordPhraseBooster.h"
+
+static uint32_t OxfordMatchWeight(OxfordCompactTrie* trie, NSString* text);
+
+@implementation OxfordPhraseBooster
+{
+    float boost;
+
+    // Metrics
+    int rescored;
+    int changed;
+}
+
+-(id)initWithOptions:(NSDictionary*)options
+{
+    if (self = [super init]) {
+        if (![options isKindOfClass:[NSDictionary class]]) {
+            options = nil;
+        }
+        boost = options[@"boost"] ? [options[@"boost"] floatValue] : 0.5f;
+    }
+    return self;
+}
+
+-(NSUInteger)choose:(RecognitionResult*)response
+{
+    OxfordCompactTrie* trie = self.vocabulary;
+    if (trie == nil || response.RecognizedPhrase.count < 2) {
+        return 0;
+    }
+
+    NSUInteger best = 0;
+    float bestScore = -INFINITY;
+    for (NSUInteger i = 0; i < response.RecognizedPhrase.count; i++) {
+        RecognizedPhrase* phrase = response.RecognizedPhrase[i];
+        NSString* text = phrase.LexicalForm.length > 0 ? phrase.LexicalForm : phrase.DisplayText;
+        float score = phrase.Confidence + boost * OxfordMatchWeight(trie, text);
+        if (score > bestScore) {
+            best = i;
+            bestScore = score;
+        }
+    }
+
+    @synchronized(self) {
+        rescored++;
+        if (best != 0) {
+            changed++;
+        }
+    }
+    return best;
+}
+
+/**
+* Total weight of the vocabulary phrases found in the text.
+*/
+static uint32_t OxfordMatchWeight(OxfordCompactTrie* trie, NSString* text)
+{
+    NSString* lower = [text lowercaseString];
+    NSUInteger length = lower.length;
+    unichar* units = malloc(MAX(length, 1) * sizeof(unichar));
+    [lower getCharacters:units range:NSMakeRange(0, length)];
+
+    uint32_t total = 0;
+    NSUInteger p = 0;
+    while (p < length) {
+        // Longest vocabulary phrase starting at this word that ends on a word boundary.
+        int32_t node = 0;
+        NSUInteger matchEnd = 0;
+        uint32_t matchWeight = 0;
+        for (NSUInteger q = p; q < length && node >= 0; q++) {
+            node = [trie child:node unit:units[q]];
+            if (node >= 0 && [trie weight:node] > 0 && (q + 1 == length || units[q + 1] == ' ')) {
+                matchEnd = q + 1;
+                matchWeight = [trie weight:node];
+            }
+        }
+        if (matchEnd > 0) {
+            total += matchWeight;
+            p = matchEnd;
+        } else {
+            while (p < length && units[p] != ' ') {
+                p++;
+            }
+        }
+        while (p < length && units[p] == ' ') {
+            p++;
+        }
+    }
+    free(units);
+    return total;
+}
+
+-(NSDictionary*)toDictionary
+{
+    @synchronized(self) {
+        return @{
+            @"vocabularyNodes": @(self.vocabulary.nodeCount),
+            @"rescored": @(rescored),
+            @"changed": @(changed)
+        };
+    }
+}
+
+@end
@@ -0,0 +1,99 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+#import "SpeechSDK/SpeechRecognitionService.h"
+#import "OxfordAudioSendGate.h"
+
+/**
+* One audio pipeline configuration: whether the preprocessor runs, how often captured audio is sent,
+* how aggressively leading silence is gated ("off", "normal", "aggressive") and how often partials
+* are delivered to JS.
+*/
+@interface OxfordPipelineProfile : NSObject
+
+@property (nonatomic,strong) NSString* name;
+@property (nonatomic) BOOL preprocessing;
+@property (nonatomic) int sendIntervalMs;
+@property (nonatomic) int partialIntervalMs;
+@property (nonatomic,strong) NSString* vad;
+
+/**
+* Speech onset level of the send gate, NAN for no gate.
+*/
+-(float)gateDbfs;
+-(int)preRollMs;
+
+@end
+
+/**
+* Device state sampled when a session starts. battery is 0..1, or -1 if unknown; thermal uses the
+* NSProcessInfoThermalState scale; network is "wifi", "cellular", "none" or "unknown".
+*/
+@interface OxfordDeviceState : NSObject
+
+@property (nonatomic) float battery;
+@property (nonatomic) BOOL charging;
+@property (nonatomic) BOOL powerSave;
+@property (nonatomic) NSInteger thermal;
+@property (nonatomic,strong) NSString* network;
+
+/**
+* Read the battery, thermal, low power and reachability state. Call on the main thread.
+*/
++(OxfordDeviceState*)sample;
+
+-(NSDictionary*)toDictionary;
+
+@end
+
+/**
+* Picks the pipeline profile ("full", "balanced" or "saver") for each session from the battery,
+* thermal and network state. The state is sampled and the profile chosen only when a session
+* starts, so a session never changes configuration midway. Every change of profile is kept, with
+* its reason, for getMetrics.
+*/
+@interface OxfordPipelineGovernor : NSObject
+
+@property (atomic,readonly) OxfordPipelineProfile* profile;
+
+/**
+* Creates a governor configured from the "governor" init option.
+*/
+-(id)initWithOptions:(NSDictionary*)options;
+
+/**
+* Choose the profile for the session that is starting.
+*/
+-(OxfordPipelineProfile*)select:(OxfordDeviceState*)state;
+
+/**
+* Create the send gate for a capture session of the current profile. Its counters are added to
+* the profile when the next session starts.
+*/
+-(OxfordAudioSendGate*)createGate:(DataRecognitionClient*)client delegate:(id<OxfordAudioSendGateDelegate>)delegate;
+
+/**
+* Whether a partial may be delivered now under the profile's partial rate.
+*/
+-(BOOL)allowPartial;
+
+-(NSDictionary*)toDictionary;
+
+@end
@@ -0,0 +1,312 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import "OxfordPipelineGovernor.h"
+#import <UIKit/UIKit.h>
+#import <SystemConfiguration/SystemConfiguration.h>
+#import <netinet/in.h>
+#import <mach/mach_time.h>
+
+static const NSUInteger OxfordMaxSwitches = 50;
+
+@implementation OxfordPipelineProfile
+{
+@public
+    // Metrics
+    long long sessions;
+    long long sentBytes;
+    long long trimmedBytes;
+    long long sendCalls;
+    long long partialsDropped;
+}
+
++(OxfordPipelineProfile*)profile:(NSString*)name preprocessing:(BOOL)preprocessing
+                    sendInterval:(int)sendIntervalMs partialInterval:(int)partialIntervalMs vad:(NSString*)vad
+{
+    OxfordPipelineProfile* profile = [[OxfordPipelineProfile alloc] init];
+    profile.name = name;
+    profile.preprocessing = preprocessing;
+    profile.sendIntervalMs = sendIntervalMs;
+    profile.partialIntervalMs = partialIntervalMs;
+    profile.vad = vad;
+    return profile;
+}
+
+-(void)configure:(NSDictionary*)options
+{
+    if (![options isKindOfClass:[NSDictionary class]]) {
+        return;
+    }
+    if (options[@"preprocessing"] != nil) {
+        self.preprocessing = [options[@"preprocessing"] boolValue];
+    }
+    if (options[@"sendIntervalMs"] != nil) {
+        self.sendIntervalMs = [options[@"sendIntervalMs"] intValue];
+    }
+    if (options[@"partialIntervalMs"] != nil) {
+        self.partialIntervalMs = [options[@"partialIntervalMs"] intValue];
+    }
+    if ([options[@"vad"] isKindOfClass:[NSString class]]) {
+        self.vad = options[@"vad"];
+    }
+}
+
+-(float)gateDbfs
+{
+    return [self.vad isEqualToString:@"aggressive"] ? -40.0f : [self.vad isEqualToString:@"normal"] ? -50.0f : NAN;
+}
+
+-(int)preRollMs
+{
+    return [self.vad isEqualToString:@"aggressive"] ? 200 : 300;
+}
+
+-(NSDictionary*)toDictionary
+{
+    return @{
+        @"preprocessing": @(self.preprocessing),
+        @"sendIntervalMs": @(self.sendIntervalMs),
+        @"partialIntervalMs": @(self.partialIntervalMs),
+        @"vad": self.vad,
+        @"sessions": @(sessions),
+        @"sentBytes": @(sentBytes),
+        @"trimmedBytes": @(trimmedBytes),
+        @"sendCalls": @(sendCalls),
+        @"partialsDropped": @(partialsDropped)
+    };
+}
+
+@end
+
+@implementation OxfordDeviceState
+
++(OxfordDeviceState*)sample
+{
+    OxfordDeviceState* state = [[OxfordDeviceState alloc] init];
+
+    UIDevice* device = [UIDevice currentDevice];
+    device.batteryMonitoringEnabled = YES;
+    state.battery = device.batteryLevel;
+    state.charging = device.batteryState == UIDeviceBatteryStateCharging || device.batteryState == UIDeviceBatteryStateFull;
+
+    NSProcessInfo* process = [NSProcessInfo processInfo];
+    if ([process respondsToSelector:@selector(isLowPowerModeEnabled)]) {
+        state.powerSave = process.lowPowerModeEnabled;
+    }
+    if ([process respondsToSelector:@selector(thermalState)]) {
+        state.thermal = process.thermalState;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_len = sizeof(address);
+    address.sin_family = AF_INET;
+    SCNetworkReachabilityRef reachability = SCNetworkReachabilityCreateWithAddress(NULL, (const struct sockaddr*)&address);
+    SCNetworkReachabilityFlags flags = 0;
+    state.network = @"unknown";
+    if (reachability != NULL) {
+        if (SCNetworkReachabilityGetFlags(reachability, &flags)) {
+            state.network = !(flags & kSCNetworkReachabilityFlagsReachable) ? @"none"
+                          : (flags & kSCNetworkReachabilityFlagsIsWWAN) ? @"cellular" : @"wifi";
+        }
+        CFRelease(reachability);
+    }
+    return state;
+}
+
+-(NSDictionary*)toDictionary
+{
+    return @{
+        @"battery": @(self.battery),
+        @"charging": @(self.charging),
+        @"powerSave": @(self.powerSave),
+        @"thermal": @(self.thermal),
+        @"network": self.network ?: @"unknown"
+    };
+}
+
+@end
+
+@implementation OxfordPipelineGovernor
+{
+    NSDictionary* profiles;
+    NSString* fixed;
+    float lowBattery;
+    float mediumBattery;
+
+    NSString* reason;
+    OxfordDeviceState* state;
+    OxfordAudioSendGate* gate;
+    uint64_t lastPartial;
+    NSMutableArray* switches;
+    long long switchCount;
+}
+
+-(id)initWithOptions:(NSDictionary*)options
+{
+    if (self = [super init]) {
+        if (![options isKindOfClass:[NSDictionary class]]) {
+            options = nil;
+        }
+        profiles = @{
+            @"full": [OxfordPipelineProfile profile:@"full" preprocessing:YES sendInterval:20 partialInterval:0 vad:@"off"],
+            @"balanced": [OxfordPipelineProfile profile:@"balanced" preprocessing:YES sendInterval:100 partialInterval:250 vad:@"normal"],
+            @"saver": [OxfordPipelineProfile profile:@"saver" preprocessing:NO sendInterval:200 partialInterval:1000 vad:@"aggressive"]
+        };
+        NSDictionary* overrides = [options[@"profiles"] isKindOfClass:[NSDictionary class]] ? options[@"profiles"] : nil;
+        for (NSString* name in profiles) {
+            [profiles[name] configure:overrides[name]];
+        }
+        fixed = profiles[options[@"profile"]] != nil ? options[@"profile"] : nil;
+        lowBattery = options[@"lowBattery"] ? [options[@"lowBattery"] floatValue] : 0.2f;
+        mediumBattery = options[@"mediumBattery"] ? [options[@"mediumBattery"] floatValue] : 0.5f;
+        switches = [[NSMutableArray alloc] init];
+        _profile = profiles[@"full"];
+    }
+    return self;
+}
+
+-(OxfordPipelineProfile*)select:(OxfordDeviceState*)current
+{
+    NSString* name;
+    NSString* why;
+    BOOL low = current.battery >= 0 && current.battery <= lowBattery && !current.charging;
+    BOOL medium = current.battery >= 0 && current.battery <= mediumBattery && !current.charging;
+    if (fixed != nil) {
+        name = fixed;
+        why = @"fixed";
+    } else if (current.thermal >= NSProcessInfoThermalStateSerious) {
+        name = @"saver";
+        why = @"thermal";
+    } else if (current.powerSave) {
+        name = @"saver";
+        why = @"powerSave";
+    } else if (low) {
+        name = @"saver";
+        why = @"battery";
+    } else if (current.thermal == NSProcessInfoThermalStateFair) {
+        name = @"balanced";
+        why = @"thermal";
+    } else if (medium) {
+        name = @"balanced";
+        why = @"battery";
+    } else if ([current.network isEqualToString:@"cellular"]) {
+        name = @"balanced";
+        why = @"cellular";
+    } else {
+        name = @"full";
+        why = current.charging ? @"charging" : @"nominal";
+    }
+
+    @synchronized(self) {
+        OxfordPipelineProfile* selected = profiles[name];
+        if (selected != _profile || reason == nil) {
+            NSLog(@"OxfordSR - Governor %@ -> %@ (%@)", _profile.name, name, why);
+            [switches addObject:@{
+                @"time": @((long long)([[NSDate date] timeIntervalSince1970] * 1000)),
+                @"from": reason != nil ? _profile.name : [NSNull null],
+                @"to": name,
+                @"reason": why,
+                @"state": [current toDictionary]
+            }];
+            if (switches.count > OxfordMaxSwitches) {
+                [switches removeObjectAtIndex:0];
+            }
+            switchCount++;
+        }
+
+        [self finishGate];
+        _profile = selected;
+        reason = why;
+        state = current;
+        lastPartial = 0;
+        selected->sessions++;
+        return selected;
+    }
+}
+
+-(OxfordAudioSendGate*)createGate:(DataRecognitionClient*)client delegate:(id<OxfordAudioSendGateDelegate>)delegate
+{
+    @synchronized(self) {
+        [self finishGate];
+        gate = [[OxfordAudioSendGate alloc] initWithClient:client
+                                                  batchMs:_profile.sendIntervalMs
+                                                 gateDbfs:[_profile gateDbfs]
+                                                preRollMs:[_profile preRollMs]];
+        gate.delegate = delegate;
+        return gate;
+    }
+}
+
+-(void)finishGate
+{
+    if (gate != nil) {
+        _profile->sentBytes += gate.sentBytes;
+        _profile->trimmedBytes += gate.trimmedBytes;
+        _profile->sendCalls += gate.sendCalls;
+        gate = nil;
+    }
+}
+
+-(BOOL)allowPartial
+{
+    @synchronized(self) {
+        if (_profile.partialIntervalMs <= 0) {
+            return YES;
+        }
+        static mach_timebase_info_data_t timebase;
+        if (timebase.denom == 0) {
+            mach_timebase_info(&timebase);
+        }
+        uint64_t now = mach_absolute_time() * timebase.numer / timebase.denom / 1000000;
+        if (lastPartial != 0 && now - lastPartial < (uint64_t)_profile.partialIntervalMs) {
+            _profile->partialsDropped++;
+            return NO;
+        }
+        lastPartial = now;
+        return YES;
+    }
+}
+
+-(NSDictionary*)toDictionary
+{
+    @synchronized(self) {
+        NSMutableDictionary* metrics = [[NSMutableDictionary alloc] init];
+        [metrics setValue:_profile.name forKey:@"profile"];
+        [metrics setValue:reason ?: [NSNull null] forKey:@"reason"];
+        [metrics setValue:state != nil ? [state toDictionary] : [NSNull null] forKey:@"state"];
+        [metrics setValue:@(switchCount) forKey:@"switchCount"];
+        [metrics setValue:[switches copy] forKey:@"switches"];
+        if (gate != nil) {
+            [metrics setValue:@{
+                @"sentBytes": @(gate.sentBytes),
+                @"trimmedBytes": @(gate.trimmedBytes),
+                @"sendCalls": @(gate.sendCalls)
+            } forKey:@"session"];
+        }
+        NSMutableDictionary* byName = [[NSMutableDictionary alloc] init];
+        for (NSString* name in profiles) {
+            byName[name] = [profiles[name] toDictionary];
+        }
+        [metrics setValue:byName forKey:@"profiles"];
+        return metrics;
+    }
+}
+
+@end
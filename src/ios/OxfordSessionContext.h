@@ -0,0 +1,47 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+#import "SpeechSDK/SpeechRecognitionService.h"
+
+/**
+* Location and text context for recognition sessions.
+*
+* JS sends only changes; the cache keeps the current context and remembers, per client, the
+* version it has already sent, so a long-lived client only gets what is new and a new client
+* gets everything once. Clearing only affects clients created afterwards, since sent context
+* can't be taken back.
+*/
+@interface OxfordSessionContext : NSObject
+
+/**
+* Apply a change: location {latitude, longitude}, text (a string or an array of strings to
+* add) and clear (drop everything first).
+*/
+-(void)update:(NSDictionary*)change;
+
+/**
+* Send the client whatever context it hasn't had yet, via setLocationLatitude:withLongitude:
+* and sendText:.
+*/
+-(void)applyTo:(ConversationBase*)client;
+
+-(NSDictionary*)toDictionary;
+
+@end
@@ -0,0 +1,117 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import "OxfordSessionContext.h"
+
+@implementation OxfordSessionContext
+{
+    long long version;
+    BOOL hasLocation;
+    double latitude;
+    double longitude;
+    long long locationVersion;
+    NSMutableArray* texts;          // text strings
+    NSMutableArray* textVersions;   // version each text was added at
+    NSMapTable* appliedVersions;    // client -> last version it was sent
+
+    // Metrics
+    int locationsSent;
+    int textsSent;
+}
+
+-(id)init
+{
+    if (self = [super init]) {
+        texts = [[NSMutableArray alloc] init];
+        textVersions = [[NSMutableArray alloc] init];
+        appliedVersions = [NSMapTable weakToStrongObjectsMapTable];
+    }
+    return self;
+}
+
+-(void)update:(NSDictionary*)change
+{
+    @synchronized(self) {
+        version++;
+        if ([change[@"clear"] boolValue]) {
+            hasLocation = NO;
+            [texts removeAllObjects];
+            [textVersions removeAllObjects];
+        }
+
+        NSDictionary* location = change[@"location"];
+        if ([location isKindOfClass:[NSDictionary class]] && location[@"latitude"] && location[@"longitude"]) {
+            hasLocation = YES;
+            latitude = [location[@"latitude"] doubleValue];
+            longitude = [location[@"longitude"] doubleValue];
+            locationVersion = version;
+        }
+
+        id text = change[@"text"];
+        NSArray* added = [text isKindOfClass:[NSArray class]] ? text : [text isKindOfClass:[NSString class]] ? @[text] : nil;
+        for (NSString* entry in added) {
+            if ([entry isKindOfClass:[NSString class]] && entry.length > 0) {
+                [texts addObject:entry];
+                [textVersions addObject:@(version)];
+            }
+        }
+    }
+}
+
+-(void)applyTo:(ConversationBase*)client
+{
+    if (client == nil) {
+        return;
+    }
+    @synchronized(self) {
+        NSNumber* applied = [appliedVersions objectForKey:client];
+        long long since = applied != nil ? applied.longLongValue : 0;
+        if (applied != nil && since == version) {
+            return;
+        }
+
+        if (hasLocation && (applied == nil || locationVersion > since)) {
+            [client setLocationLatitude:latitude withLongitude:longitude];
+            locationsSent++;
+        }
+        for (NSUInteger i = 0; i < texts.count; i++) {
+            if (applied == nil || [textVersions[i] longLongValue] > since) {
+                [client sendText:texts[i]];
+                textsSent++;
+            }
+        }
+        [appliedVersions setObject:@(version) forKey:client];
+    }
+}
+
+-(NSDictionary*)toDictionary
+{
+    @synchronized(self) {
+        NSMutableDictionary* info = [[NSMutableDictionary alloc] init];
+        if (hasLocation) {
+            [info setValue:@{ @"latitude": @(latitude), @"longitude": @(longitude) } forKey:@"location"];
+        }
+        [info setValue:@(texts.count) forKey:@"texts"];
+        [info setValue:@(locationsSent) forKey:@"locationsSent"];
+        [info setValue:@(textsSent) forKey:@"textsSent"];
+        return info;
+    }
+}
+
+@end
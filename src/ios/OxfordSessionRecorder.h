@@ -0,0 +1,87 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+#import "SpeechSDK/SpeechRecognitionService.h"
+
+/**
+* Record types of the session container. See OxfordSessionRecorder for the layout.
+*/
+typedef NS_ENUM(uint32_t, OxfordRecordType) {
+    OxfordRecordType_Format = 1,
+    OxfordRecordType_Audio = 2,
+    OxfordRecordType_EndAudio = 3,
+    OxfordRecordType_Partial = 4,
+    OxfordRecordType_Final = 5,
+    OxfordRecordType_Error = 6,
+    OxfordRecordType_AudioEvent = 7,
+    OxfordRecordType_Intent = 8
+};
+
+/**
+* Records one recognition session: the audio format, the exact audio bytes sent to the service
+* and every callback, each stamped with the time since the session started.
+*
+* Container layout (little endian, every record 8-byte aligned so the file can be memory mapped
+* and walked in place):
+*   header:  u32 magic "OXSR" | u32 version | u64 start time (ms since epoch)
+*   record:  u32 type | u32 payload length | u64 timestamp (us) | payload | pad to 8
+* The Format payload is u16 encoding | u16 channels | u32 samples per second |
+* u32 average bytes per second | u16 block align | u16 bits per sample | format specific data.
+* Audio is raw bytes, EndAudio is empty, the rest are UTF-8 text.
+* The Android recorder writes the same format.
+*/
+@interface OxfordSessionRecorder : NSObject
+
+@property (nonatomic,readonly) NSString* path;
+
+-(id)initWithPath:(NSString*)path;
+
+-(void)writeFormat:(SpeechAudioFormat*)format;
+-(void)writeAudio:(const void*)bytes length:(uint32_t)length;
+-(void)writeEndAudio;
+-(void)writeText:(NSString*)text type:(OxfordRecordType)type;
+-(void)close;
+
+@end
+
+/**
+* Where replayed audio goes: the service through a DataRecognitionClient, which conforms, or any
+* other recognizer that takes the same calls.
+*/
+@protocol OxfordReplayRecognizer <NSObject>
+
+-(void)sendAudioFormat:(SpeechAudioFormat*)audioFormat;
+-(void)sendAudio:(NSData*)buffer withLength:(int)actualAudioSizeInBytes;
+-(void)endAudio;
+
+@end
+
+@interface DataRecognitionClient (OxfordReplay) <OxfordReplayRecognizer>
+@end
+
+/**
+* Replays a recording into a recognizer, paced by the recorded timestamps or without waiting for
+* them. A DataRecognitionClient sends at the audio rate regardless, so an unpaced replay only skips
+* the gaps in the recording. Recorded callbacks are skipped; the recognizer produces its own, and
+* the sent audio is written to the optional recorder so the two runs can be diffed with
+* tools/oxsr.js on the desktop.
+* Blocks the calling thread; returns an error message, or nil on success.
+*/
+NSString* OxfordReplaySession(NSString* path, id<OxfordReplayRecognizer> client, OxfordSessionRecorder* recorder, BOOL realtime);
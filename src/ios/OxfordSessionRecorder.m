@@ -0,0 +1,236 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import "OxfordSessionRecorder.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <mach/mach_time.h>
+
+static const uint32_t kMagic = 0x5253584f;  // "OXSR"
+static const uint32_t kVersion = 1;
+static const uint32_t kHeaderSize = 16;
+static const uint32_t kRecordHeaderSize = 16;
+
+static uint64_t OxfordNowMicros(void)
+{
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom / 1000;
+}
+
+@implementation OxfordSessionRecorder
+{
+    FILE* file;
+    uint64_t startMicros;
+}
+
+-(id)initWithPath:(NSString*)path
+{
+    self = [super init];
+    if (self) {
+        _path = path;
+        file = fopen([path fileSystemRepresentation], "wb");
+        if (file == NULL) {
+            NSLog(@"OxfordSR - couldn't open recording %@", path);
+            return nil;
+        }
+        setvbuf(file, NULL, _IOFBF, 64 * 1024);
+        startMicros = OxfordNowMicros();
+
+        uint64_t startMs = (uint64_t)([[NSDate date] timeIntervalSince1970] * 1000);
+        fwrite(&kMagic, 4, 1, file);
+        fwrite(&kVersion, 4, 1, file);
+        fwrite(&startMs, 8, 1, file);
+    }
+    return self;
+}
+
+-(void)dealloc
+{
+    [self close];
+}
+
+-(void)write:(OxfordRecordType)type bytes:(const void*)bytes length:(uint32_t)length
+{
+    @synchronized(self) {
+        if (file == NULL) {
+            return;
+        }
+        static const uint8_t padding[8] = {0};
+        uint32_t header[2] = { type, length };
+        uint64_t timestamp = OxfordNowMicros() - startMicros;
+        uint32_t pad = (8 - (length & 7)) & 7;
+
+        // Recording is best effort; never let it break the session.
+        if (fwrite(header, sizeof(header), 1, file) != 1 ||
+            fwrite(&timestamp, sizeof(timestamp), 1, file) != 1 ||
+            (length > 0 && fwrite(bytes, length, 1, file) != 1) ||
+            (pad > 0 && fwrite(padding, pad, 1, file) != 1)) {
+            NSLog(@"OxfordSR - recorder write failed");
+            fclose(file);
+            file = NULL;
+        }
+    }
+}
+
+-(void)writeFormat:(SpeechAudioFormat*)format
+{
+    NSMutableData* payload = [NSMutableData dataWithCapacity:16 + format.FormatSpecificData.length];
+    uint16_t encoding = (uint16_t)format.EncodingFormat;
+    uint16_t channels = (uint16_t)format.ChannelCount;
+    uint32_t samplesPerSecond = (uint32_t)format.SamplesPerSecond;
+    uint32_t averageBytesPerSecond = (uint32_t)format.AverageBytesPerSecond;
+    uint16_t blockAlign = (uint16_t)format.BlockAlign;
+    uint16_t bitsPerSample = (uint16_t)format.BitsPerSample;
+    [payload appendBytes:&encoding length:2];
+    [payload appendBytes:&channels length:2];
+    [payload appendBytes:&samplesPerSecond length:4];
+    [payload appendBytes:&averageBytesPerSecond length:4];
+    [payload appendBytes:&blockAlign length:2];
+    [payload appendBytes:&bitsPerSample length:2];
+    if (format.FormatSpecificData != nil) {
+        [payload appendData:format.FormatSpecificData];
+    }
+    [self write:OxfordRecordType_Format bytes:payload.bytes length:(uint32_t)payload.length];
+}
+
+-(void)writeAudio:(const void*)bytes length:(uint32_t)length
+{
+    [self write:OxfordRecordType_Audio bytes:bytes length:length];
+}
+
+-(void)writeEndAudio
+{
+    [self write:OxfordRecordType_EndAudio bytes:NULL length:0];
+}
+
+-(void)writeText:(NSString*)text type:(OxfordRecordType)type
+{
+    NSData* utf8 = [(text ?: @"") dataUsingEncoding:NSUTF8StringEncoding];
+    [self write:type bytes:utf8.bytes length:(uint32_t)utf8.length];
+}
+
+-(void)close
+{
+    @synchronized(self) {
+        if (file != NULL) {
+            fclose(file);
+            file = NULL;
+        }
+    }
+}
+
+@end
+
+@implementation DataRecognitionClient (OxfordReplay)
+@end
+
+NSString* OxfordReplaySession(NSString* path, id<OxfordReplayRecognizer> client, OxfordSessionRecorder* recorder, BOOL realtime)
+{
+    NSError* error = nil;
+    NSData* map = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:&error];
+    if (map == nil) {
+        return [error localizedDescription];
+    }
+
+    const uint8_t* bytes = (const uint8_t*)map.bytes;
+    NSUInteger size = map.length;
+    uint32_t magic, version;
+    if (size < kHeaderSize) {
+        return @"not a session recording";
+    }
+    memcpy(&magic, bytes, 4);
+    memcpy(&version, bytes + 4, 4);
+    if (magic != kMagic) {
+        return @"not a session recording";
+    }
+    if (version != kVersion) {
+        return [NSString stringWithFormat:@"unsupported recording version %u", version];
+    }
+
+    uint64_t startMicros = OxfordNowMicros();
+    BOOL endSent = NO;
+    NSUInteger position = kHeaderSize;
+
+    while (position + kRecordHeaderSize <= size) {
+        uint32_t type, length;
+        uint64_t timestamp;
+        memcpy(&type, bytes + position, 4);
+        memcpy(&length, bytes + position + 4, 4);
+        memcpy(&timestamp, bytes + position + 8, 8);
+        NSUInteger payload = position + kRecordHeaderSize;
+        if (payload + length > size) {
+            // Truncated tail, e.g. the app was killed while recording.
+            break;
+        }
+        position = payload + ((length + 7) & ~7u);
+
+        if (type != OxfordRecordType_Format && type != OxfordRecordType_Audio && type != OxfordRecordType_EndAudio) {
+            continue;
+        }
+
+        if (realtime) {
+            uint64_t elapsed = OxfordNowMicros() - startMicros;
+            if (timestamp > elapsed) {
+                usleep((useconds_t)(timestamp - elapsed));
+            }
+        }
+
+        if (type == OxfordRecordType_Format && length >= 16) {
+            uint16_t encoding, channels, blockAlign, bitsPerSample;
+            uint32_t samplesPerSecond, averageBytesPerSecond;
+            const uint8_t* p = bytes + payload;
+            memcpy(&encoding, p, 2);
+            memcpy(&channels, p + 2, 2);
+            memcpy(&samplesPerSecond, p + 4, 4);
+            memcpy(&averageBytesPerSecond, p + 8, 4);
+            memcpy(&blockAlign, p + 12, 2);
+            memcpy(&bitsPerSample, p + 14, 2);
+
+            SpeechAudioFormat* format = [[SpeechAudioFormat alloc] init];
+            format.EncodingFormat = (AudioCompressionType)encoding;
+            format.ChannelCount = channels;
+            format.SamplesPerSecond = samplesPerSecond;
+            format.AverageBytesPerSecond = averageBytesPerSecond;
+            format.BlockAlign = blockAlign;
+            format.BitsPerSample = bitsPerSample;
+            if (length > 16) {
+                format.FormatSpecificData = [NSData dataWithBytes:p + 16 length:length - 16];
+            }
+            [client sendAudioFormat:format];
+            [recorder writeFormat:format];
+        } else if (type == OxfordRecordType_Audio) {
+            NSData* chunk = [map subdataWithRange:NSMakeRange(payload, length)];
+            [client sendAudio:chunk withLength:(int)length];
+            [recorder writeAudio:bytes + payload length:length];
+        } else if (type == OxfordRecordType_EndAudio) {
+            [client endAudio];
+            [recorder writeEndAudio];
+            endSent = YES;
+        }
+    }
+
+    if (!endSent) {
+        [client endAudio];
+        [recorder writeEndAudio];
+    }
+    return nil;
+}
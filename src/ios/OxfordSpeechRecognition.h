@@ -19,19 +19,101 @@ ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEAL
 
 #import <Cordova/CDV.h>
 #import "SpeechSDK/SpeechRecognitionService.h"
+#import "OxfordAudioCapture.h"
+#import "OxfordAudioQualityAnalyzer.h"
+#import "OxfordAudioPreprocessor.h"
+#import "OxfordSessionRecorder.h"
+#import "OxfordTurnSegmenter.h"
+#import "OxfordAudioPushQueue.h"
+#import "OxfordTranscript.h"
+#import "OxfordConfidenceRetry.h"
+#import "OxfordSessionContext.h"
+#import "OxfordPhraseBooster.h"
+#import "OxfordTypeaheadIndex.h"
+#import "OxfordPipelineGovernor.h"
+
+@class OxfordTurnSession;
 
 /**
 * The Main App
 */
-@interface OxfordSpeechRecognition : CDVPlugin<SpeechRecognitionProtocol>
+@interface OxfordSpeechRecognition : CDVPlugin<SpeechRecognitionProtocol, OxfordAudioCaptureDelegate, OxfordAudioPushQueueDelegate, OxfordAudioSendGateDelegate>
 {
     MicrophoneRecognitionClient* micClient;
     SpeechRecognitionMode recoMode;
     int waitSeconds;
+    NSString* language;
+    NSString* primaryKey;
+
+    // Plugin-owned capture path, used instead of the microphone client when the
+    // audio has to be inspected before it is sent to the service.
+    BOOL useCapture;
+    BOOL captureAborted;
+    DataRecognitionClient* dataClient;
+    OxfordAudioCapture* capture;
+    OxfordAudioQualityAnalyzer* qualityAnalyzer;
+    OxfordAudioPreprocessor* preprocessor;
+    OxfordAudioIssue reportedIssues;
+
+    // Opt-in session recording, see OxfordSessionRecorder for the container format. The recorder
+    // itself is the atomic recorder property: it is cleared on the service callback thread while
+    // the audio thread may still be writing to it.
+    NSString* recordingDir;
+    int maxRecordings;
+
+    // Speaker turns for long dictation. With one session per turn, the sessions that have not
+    // delivered EndOfDictation yet are kept in order, the live one last. dataClient is swapped
+    // on the audio queue thread at a turn change, under the turnSessions lock.
+    OxfordTurnSegmenter* turnSegmenter;
+    long long lastFinalSample;
+    NSMutableArray* turnSessions;
+
+    // Audio pushed from JS, see OxfordAudioPushQueue. Sizes are in bytes of 16 kHz 16-bit PCM.
+    OxfordAudioPushQueue* pushQueue;
+    NSUInteger pushCapacity;
+    NSUInteger pushHighWater;
+    NSUInteger pushLowWater;
+
+    // Native transcript; with it partials and finals are also delivered as edit operations.
+    OxfordTranscript* transcript;
+
+    // Confidence-driven retry. Finals go through a serial queue while it is enabled.
+    OxfordConfidenceRetry* retry;
+    dispatch_queue_t finalDelivery;
+
+    // Location and text context sent to every client, and N-best rescoring against the user
+    // vocabulary, kept as a memory mapped trie.
+    OxfordSessionContext* context;
+    OxfordPhraseBooster* booster;
+
+    // Typeahead over past finals and suggestions; partials are answered with completions from it.
+    OxfordTypeaheadIndex* typeahead;
+    NSArray* lastCompletions;
+
+    // Battery, thermal and network aware profile, chosen at the start of every session.
+    OxfordPipelineGovernor* governor;
+    OxfordAudioSendGate* sendGate;
+
+    // init only reads the configuration; the audio session, the client and the mapped indexes are
+    // set up on prepareQueue, either by an explicit prepare or by the first session. prepared and
+    // the timings are only touched on prepareQueue. Session commands run on the main thread; those
+    // arriving while a start waits for prepare are counted and queued behind it.
+    dispatch_queue_t prepareQueue;
+    int pendingSessionCommands;
+    BOOL prepared;
+    NSString* prepareTrigger;
+    double initMs;
+    double prepareMs;
+    double audioSessionMs;
+    double indexesMs;
+    double clientMs;
+    double firstSessionWaitMs;
 }
 
 @property (nonatomic,strong) CDVInvokedUrlCommand * command;
 @property (nonatomic,strong) CDVPluginResult* pluginResult;
+@property (atomic,strong) OxfordSessionRecorder* recorder;
+@property (atomic,copy) NSDictionary* startup;
 
 /**
 * Called when a partial response is received; 
@@ -43,11 +125,21 @@ ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEAL
 */
 -(void)onFinalResponseReceived:(RecognitionResult*)result;
 
+/**
+* Called when a final response is received by the session of a turn, with one session per turn.
+*/
+-(void)onFinalResponseReceived:(RecognitionResult*)result session:(OxfordTurnSession*)session;
+
 /**
 * Called when an intent is parsed and received. 
 */
 -(void)onIntentReceived:(NSString*)payload;
 
+/**
+* Called when the service suggests a completion of the current utterance.
+*/
+-(void)onSuggestion:(NSString*)suggestionText;
+
 /**
 * Called when an error is received.
 */
@@ -59,5 +151,20 @@ ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEAL
 */
 -(void)onMicrophoneStatus:(Boolean)recording;
 
+/**
+* Called on the audio queue thread for every frame of the plugin-owned capture.
+*/
+-(void)audioCapture:(OxfordAudioCapture*)capture didCaptureFrame:(int16_t*)samples count:(int)count;
+
+/**
+* Called with the audio the send gate actually sent, for the recording and the retry buffer.
+*/
+-(void)audioSendGate:(OxfordAudioSendGate*)gate didSend:(NSData*)audio;
+
+/**
+* Called on the push queue thread when pushed audio has drained below the low water mark.
+*/
+-(void)audioPushQueue:(OxfordAudioPushQueue*)queue didDrain:(NSUInteger)queuedBytes sequence:(long long)sequence;
+
 @end
 
@@ -20,29 +20,278 @@ ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEAL
 #import "OxfordSpeechRecognition.h"
 #import <Cordova/CDV.h>
 #import <AVFoundation/AVAudioSession.h>
+#import <mach/mach_time.h>
+
+static double OxfordNowMs()
+{
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return (double)mach_absolute_time() * timebase.numer / timebase.denom / 1000000.0;
+}
+
+/**
+* The service session of one turn. Its callbacks carry the turn, so results are attributed to it
+* even while the previous turn's session is still finishing.
+*/
+@interface OxfordTurnSession : NSObject<SpeechRecognitionProtocol>
+
+@property (nonatomic,weak) OxfordSpeechRecognition* plugin;
+@property (nonatomic,strong) OxfordTurn* turn;
+@property (nonatomic,strong) DataRecognitionClient* client;
+
+@end
+
+@implementation OxfordTurnSession
+
+-(void)onPartialResponseReceived:(NSString*)response
+{
+    [self.plugin onPartialResponseReceived:response];
+}
+
+-(void)onFinalResponseReceived:(RecognitionResult*)response
+{
+    [self.plugin onFinalResponseReceived:response session:self];
+}
+
+-(void)onIntentReceived:(NSString*)payload
+{
+    [self.plugin onIntentReceived:payload];
+}
+
+-(void)onSuggestion:(NSString*)suggestionText
+{
+    [self.plugin onSuggestion:suggestionText];
+}
+
+-(void)onError:(NSString*)errorMessage withErrorCode:(int)errorCode
+{
+    [self.plugin onError:errorMessage withErrorCode:errorCode];
+}
+
+-(void)onMicrophoneStatus:(Boolean)recording
+{
+    [self.plugin onMicrophoneStatus:recording];
+}
+
+@end
 
 @implementation OxfordSpeechRecognition
 
 - (void) init:(CDVInvokedUrlCommand*)command {
     NSLog(@"OxfordSR - Init");
+    // In order with the session commands queued before it, whose objects it replaces.
+    [self afterSessionStart:^{
+        double start = OxfordNowMs();
+
+        language = [[command arguments] objectAtIndex:0];
+    
+        NSString* primaryOrSecondaryKey = [[command arguments] objectAtIndex:1];
+        //NSString* luisAppID = [[command arguments] objectAtIndex:2];
+        //NSString* luisSubscriptionID = [[command arguments] objectAtIndex:3];
+        NSDictionary* options = [command argumentAtIndex:4 withDefault:nil andClass:[NSDictionary class]];
 
-    // Setup the type of reco we want
-    recoMode = SpeechRecognitionMode_ShortPhrase;
+        // Setup the type of reco we want
+        recoMode = [options[@"mode"] isEqual:@"longDictation"] ? SpeechRecognitionMode_LongDictation
+                                                                : SpeechRecognitionMode_ShortPhrase;
     
-    waitSeconds = recoMode == SpeechRecognitionMode_ShortPhrase ? 20 : 200;
+        waitSeconds = recoMode == SpeechRecognitionMode_ShortPhrase ? 20 : 200;
+
+        primaryKey = primaryOrSecondaryKey;
+
+        // A session still running on the old configuration ends here, and its clients go.
+        [capture stop];
+        capture = nil;
+        [pushQueue cancel];
+        pushQueue = nil;
+        [self closeTurnSessions];
+        dataClient = nil;
+        micClient = nil;
+
+        // Features the new options leave out are off.
+        useCapture = NO;
+        qualityAnalyzer = nil;
+        preprocessor = nil;
+        recordingDir = nil;
+        turnSegmenter = nil;
+        turnSessions = nil;
+        retry = nil;
+        booster = nil;
+        governor = nil;
+        typeahead = nil;
+        transcript = nil;
+
+        if (options[@"audioQuality"] != nil) {
+            qualityAnalyzer = [[OxfordAudioQualityAnalyzer alloc] initWithOptions:options[@"audioQuality"]];
+            useCapture = YES;
+        }
+        if (options[@"preprocessing"] != nil) {
+            preprocessor = [[OxfordAudioPreprocessor alloc] initWithOptions:options[@"preprocessing"]];
+            useCapture = YES;
+        }
+        if (options[@"recorder"] != nil) {
+            NSDictionary* recorderOptions = [options[@"recorder"] isKindOfClass:[NSDictionary class]] ? options[@"recorder"] : nil;
+            maxRecordings = recorderOptions[@"maxRecordings"] ? [recorderOptions[@"maxRecordings"] intValue] : 20;
+            NSString* library = NSSearchPathForDirectoriesInDomains(NSLibraryDirectory, NSUserDomainMask, YES)[0];
+            recordingDir = [library stringByAppendingPathComponent:@"OxfordRecordings"];
+            [[NSFileManager defaultManager] createDirectoryAtPath:recordingDir withIntermediateDirectories:YES attributes:nil error:nil];
+            useCapture = YES;
+        }
+        if (options[@"turns"] != nil) {
+            turnSegmenter = [[OxfordTurnSegmenter alloc] initWithOptions:options[@"turns"]];
+            turnSessions = [[NSMutableArray alloc] init];
+            useCapture = YES;
+        }
+        if (options[@"retry"] != nil) {
+            retry = [[OxfordConfidenceRetry alloc] initWithOptions:options[@"retry"] language:language mode:recoMode];
+            finalDelivery = dispatch_queue_create("OxfordSR.finals", DISPATCH_QUEUE_SERIAL);
+            useCapture = YES;
+        }
+        context = [[OxfordSessionContext alloc] init];
+        if (options[@"booster"] != nil) {
+            booster = [[OxfordPhraseBooster alloc] initWithOptions:options[@"booster"]];
+        }
+        if (options[@"governor"] != nil) {
+            governor = [[OxfordPipelineGovernor alloc] initWithOptions:options[@"governor"]];
+            useCapture = YES;
+        }
+        if (options[@"typeahead"] != nil) {
+            typeahead = [[OxfordTypeaheadIndex alloc] initWithPath:[self typeaheadPath] options:options[@"typeahead"]];
+        }
+        if ([options[@"transcript"] boolValue]) {
+            transcript = [[OxfordTranscript alloc] init];
+        }
+        NSDictionary* pushOptions = [options[@"pushQueue"] isKindOfClass:[NSDictionary class]] ? options[@"pushQueue"] : nil;
+        pushCapacity = pushOptions[@"capacityBytes"] ? [pushOptions[@"capacityBytes"] unsignedIntegerValue] : 512 * 1024;
+        pushHighWater = MIN(pushOptions[@"highWaterBytes"] ? [pushOptions[@"highWaterBytes"] unsignedIntegerValue] : 256 * 1024, pushCapacity);
+        pushLowWater = MIN(pushOptions[@"lowWaterBytes"] ? [pushOptions[@"lowWaterBytes"] unsignedIntegerValue] : 64 * 1024, pushHighWater);
+
+        if (prepareQueue == nil) {
+            prepareQueue = dispatch_queue_create("OxfordSR.prepare", DISPATCH_QUEUE_SERIAL);
+        }
+        double elapsed = OxfordNowMs() - start;
+        dispatch_async(prepareQueue, ^{
+            prepared = NO;
+            prepareTrigger = nil;
+            prepareMs = audioSessionMs = indexesMs = clientMs = 0;
+            firstSessionWaitMs = -1;
+            initMs = elapsed;
+            self.startup = [self startupTiming];
+        });
+    }];
+}
+
+/**
+* Set up the audio session, map the persisted indexes and create the microphone client, once.
+* Runs on prepareQueue.
+*/
+-(void)prepareWithTrigger:(NSString*)trigger
+{
+    if (prepared) {
+        return;
+    }
+    double start = OxfordNowMs();
+
     // In the case of microphone use, setup things so microphone can be turned on later.
     [self activateAudioSession];
+    double activated = OxfordNowMs();
 
-    NSString* language = [[command arguments] objectAtIndex:0];
-    
-    NSString* primaryOrSecondaryKey = [[command arguments] objectAtIndex:1];
-    //NSString* luisAppID = [[command arguments] objectAtIndex:2];
-    //NSString* luisSubscriptionID = [[command arguments] objectAtIndex:3];
-    
-    micClient = [SpeechRecognitionServiceFactory createMicrophoneClient:(recoMode)
-                                                           withLanguage:(language)
-                                                                withKey:(primaryOrSecondaryKey)
-                                                           withProtocol:(self)];
+    if (booster != nil && booster.vocabulary == nil) {
+        booster.vocabulary = [OxfordCompactTrie trieWithContentsOfFile:[self vocabularyPath]];
+    }
+    [typeahead load];
+    double indexed = OxfordNowMs();
+
+    if (!useCapture) {
+        micClient = [SpeechRecognitionServiceFactory createMicrophoneClient:(recoMode)
+                                                               withLanguage:(language)
+                                                                    withKey:(primaryKey)
+                                                               withProtocol:(self)];
+        [context applyTo:micClient];
+    }
+    double end = OxfordNowMs();
+
+    audioSessionMs = activated - start;
+    indexesMs = indexed - activated;
+    clientMs = end - indexed;
+    prepareMs = end - start;
+    prepareTrigger = trigger;
+    prepared = YES;
+    self.startup = [self startupTiming];
+    NSLog(@"OxfordSR - Prepared by %@ in %.1f ms", trigger, prepareMs);
+}
+
+/**
+* Prepare in the background ahead of the first session. Replies with the startup timing.
+*/
+- (void) prepare:(CDVInvokedUrlCommand*)command
+{
+    dispatch_async(prepareQueue, ^{
+        [self prepareWithTrigger:@"prepare"];
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:[self startupTiming]];
+        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+    });
+}
+
+/**
+* Make sure the session that is starting has its audio session and client, then start it. The
+* prepare, or the wait for one still running in the background, happens on prepareQueue; the start
+* continues on the main thread like the other session commands, which queue behind it meanwhile.
+*/
+-(void)prepareForSession:(NSString*)trigger then:(dispatch_block_t)block
+{
+    double start = OxfordNowMs();
+    pendingSessionCommands++;
+    dispatch_async(prepareQueue, ^{
+        [self prepareWithTrigger:trigger];
+        if (firstSessionWaitMs < 0) {
+            firstSessionWaitMs = OxfordNowMs() - start;
+            self.startup = [self startupTiming];
+        }
+        dispatch_async(dispatch_get_main_queue(), ^{
+            pendingSessionCommands--;
+            block();
+        });
+    });
+}
+
+/**
+* Run a session command on the main thread after the starts still waiting for prepare, keeping the
+* order the commands arrived in. Straight away when none is waiting.
+*/
+-(void)afterSessionStart:(dispatch_block_t)block
+{
+    if (pendingSessionCommands == 0) {
+        block();
+        return;
+    }
+    pendingSessionCommands++;
+    dispatch_async(prepareQueue, ^{
+        dispatch_async(dispatch_get_main_queue(), ^{
+            pendingSessionCommands--;
+            block();
+        });
+    });
+}
+
+/**
+* Startup timing: what init cost, what prepare cost and what triggered it, and how long the first
+* session waited for it. Runs on prepareQueue, which owns these fields; other threads read the
+* startup property.
+*/
+-(NSDictionary*)startupTiming
+{
+    return @{
+        @"initMs": @(initMs),
+        @"prepared": @(prepared),
+        @"trigger": prepareTrigger ?: [NSNull null],
+        @"prepareMs": @(prepareMs),
+        @"audioSessionMs": @(audioSessionMs),
+        @"indexesMs": @(indexesMs),
+        @"clientMs": @(clientMs),
+        @"firstSessionWaitMs": firstSessionWaitMs >= 0 ? @(firstSessionWaitMs) : [NSNull null]
+    };
 }
 
 /**
@@ -53,28 +302,29 @@ ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEAL
     NSError * err = nil;
     AVAudioSession* session = [AVAudioSession sharedInstance];
 
-    if (![session setActive:YES error:&err])
+    // Configure first and activate once; the category and mode don't need an active session.
+    if ( ![session setCategory:AVAudioSessionCategoryPlayAndRecord
+                         error:&err] )
     {
-        NSLog(@"OxfordSR - ERROR INITIALIZING AUDIO SESSION! %@\n", [err description]);
-    }
-    else
-    {
-        if ( ![session setCategory:AVAudioSessionCategoryPlayAndRecord
-                             error:&err] )
-        {
-            NSLog(@"OxfordSR - couldn't set audio category! %@", err);
-        }
+        NSLog(@"OxfordSR - couldn't set audio category! %@", err);
     }
     
-    if ( ![session overrideOutputAudioPort:AVAudioSessionPortOverrideSpeaker
-                                     error:&err] )
+    // Voice chat mode turns on the system echo canceller for the speaker output.
+    if (preprocessor.echoCancellation && ![session setMode:AVAudioSessionModeVoiceChat error:&err])
     {
-        NSLog(@"OxfordSR - couldn't set audio category! %@", err);
+        NSLog(@"OxfordSR - couldn't set voice chat mode! %@", err);
     }
-        
+
     if ( ![session setActive:YES error:&err] )
     {
         NSLog(@"OxfordSR - AudioSessionSetActive (true) failed %@", err);
+        return;
+    }
+
+    if ( ![session overrideOutputAudioPort:AVAudioSessionPortOverrideSpeaker
+                                     error:&err] )
+    {
+        NSLog(@"OxfordSR - couldn't set audio category! %@", err);
     }
 }
 
@@ -84,23 +334,125 @@ ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEAL
 -(void)onPartialResponseReceived:(NSString*) response
 {
     NSLog(@"OxfordSR - Partial");
+    [self.recorder writeText:response type:OxfordRecordType_Partial];
+    if (governor != nil && ![governor allowPartial]) {
+        // A later partial or the final replaces this one anyway.
+        return;
+    }
+    if (retry != nil) {
+        // Keep partials behind a final that is still being retried, or they would show up ahead
+        // of it and its transcript insert would land after their tail.
+        dispatch_async(finalDelivery, ^{
+            [self sendPartialResult:response];
+        });
+        return;
+    }
+    [self sendPartialResult:response];
+}
+
+/**
+* Send a partial to JS, as a transcript tail edit if there is a transcript.
+*/
+-(void)sendPartialResult:(NSString*)response
+{
     dispatch_async(dispatch_get_main_queue(), ^{
         NSLog(@"OxfordSR - Partial %@", response);
 
         NSMutableDictionary * event = [[NSMutableDictionary alloc]init];
-        [event setValue:response forKey:@"partial"];
+        if (transcript != nil) {
+            // Only the tail changes, so don't resend the transcript.
+            transcript.tail = response;
+            [event setValue:[OxfordTranscript edit:@"tail" segment:-1 text:response] forKey:@"edit"];
+        } else {
+            [event setValue:response forKey:@"partial"];
+        }
         
         self.pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:event];
         [self.pluginResult setKeepCallbackAsBool:YES];
         [self.commandDelegate sendPluginResult:self.pluginResult callbackId:self.command.callbackId];
+
+        if (typeahead != nil) {
+            [self sendCompletions:response];
+        }
+    });
+}
+
+/**
+* Offer completions of a partial from the typeahead index. Only sent when they change.
+*/
+-(void)sendCompletions:(NSString*)partial
+{
+    NSArray* completions = [typeahead query:partial limit:typeahead.limit];
+    if ([completions isEqualToArray:lastCompletions]) {
+        return;
+    }
+    lastCompletions = completions;
+
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK
+                                            messageAsDictionary:@{ @"completions": completions }];
+    [result setKeepCallbackAsBool:YES];
+    [self.commandDelegate sendPluginResult:result callbackId:self.command.callbackId];
+}
+
+/**
+* Called when the service suggests a completion of the current utterance. Forwarded to JS and
+* counted in the typeahead index.
+*/
+-(void)onSuggestion:(NSString*)suggestionText
+{
+    if (suggestionText.length == 0) {
+        return;
+    }
+    if ([typeahead add:suggestionText weight:1]) {
+        [self persistTypeahead];
+    }
+    dispatch_async(dispatch_get_main_queue(), ^{
+        NSLog(@"OxfordSR - Suggestion %@", suggestionText);
+
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK
+                                                messageAsDictionary:@{ @"suggestion": suggestionText }];
+        [result setKeepCallbackAsBool:YES];
+        [self.commandDelegate sendPluginResult:result callbackId:self.command.callbackId];
     });
 }
 
+/**
+* Write the phrases counted since the last launch into the typeahead file, in the background.
+*/
+-(void)persistTypeahead
+{
+    OxfordTypeaheadIndex* index = typeahead;
+    [self.commandDelegate runInBackground:^{
+        [index persist];
+    }];
+}
+
+-(NSString*)typeaheadPath
+{
+    NSString* library = NSSearchPathForDirectoriesInDomains(NSLibraryDirectory, NSUserDomainMask, YES)[0];
+    return [library stringByAppendingPathComponent:@"OxfordTypeahead.trie"];
+}
+
+/**
+* Return the completions of a prefix from the typeahead index.
+*/
+- (void) getCompletions:(CDVInvokedUrlCommand*)command
+{
+    NSString* prefix = [command argumentAtIndex:0 withDefault:@"" andClass:[NSString class]];
+    NSNumber* limit = [command argumentAtIndex:1 withDefault:nil andClass:[NSNumber class]];
+    NSArray* completions = typeahead != nil
+        ? [typeahead query:prefix limit:(limit != nil ? [limit unsignedIntegerValue] : typeahead.limit)] : @[];
+
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsArray:completions];
+    [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+}
+
 /**
 * Called when an intent is parsed and received. 
 */
 -(void)onIntentReceived:(NSString*) result
 {
+    [self.recorder writeText:[result description] type:OxfordRecordType_Intent];
     dispatch_async(dispatch_get_main_queue(), ^{
     });
 }
@@ -109,35 +461,251 @@ ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEAL
 * Called when a final response is received. 
 */
 -(void)onFinalResponseReceived:(RecognitionResult*)response
+{
+    [self onFinalResponseReceived:response session:nil];
+}
+
+-(void)onFinalResponseReceived:(RecognitionResult*)response session:(OxfordTurnSession*)session
 {
     NSLog(@"OxfordSR - Final");
     bool isFinalDicationMessage = recoMode == SpeechRecognitionMode_LongDictation &&
                                                 (response.RecognitionStatus == RecognitionStatus_EndOfDictation ||
                                                  response.RecognitionStatus == RecognitionStatus_DictationEndSilenceTimeout);
-    if ((recoMode == SpeechRecognitionMode_ShortPhrase) || isFinalDicationMessage) {
+    OxfordSessionRecorder* finalRecorder = self.recorder;
+    if (finalRecorder != nil) {
+        NSData* json = [NSJSONSerialization dataWithJSONObject:ConvertRecognitionResultToDictionary(response) options:0 error:nil];
+        [finalRecorder writeText:[[NSString alloc] initWithData:json encoding:NSUTF8StringEncoding] type:OxfordRecordType_Final];
+    }
+
+    bool isDictationEnded = isFinalDicationMessage;
+    OxfordTurn* turn = nil;
+    if (session != nil) {
+        turn = session.turn;
+        if (isFinalDicationMessage) {
+            @synchronized(turnSessions) {
+                [turnSessions removeObject:session];
+                // Only the last open session ending finishes the dictation.
+                isDictationEnded = turnSessions.count == 0;
+            }
+        }
+    } else if (turnSegmenter != nil) {
+        // Attribute the final to the turn in the middle of the audio it covers.
+        long long samples = turnSegmenter.samples;
+        turn = [turnSegmenter turnAt:(lastFinalSample + samples) / 2];
+        lastFinalSample = samples;
+    }
+
+    if ((recoMode == SpeechRecognitionMode_ShortPhrase) || isDictationEnded) {
         // we got the fial result, so we can end the mic reco.  No need to do this for dataReco, since
         // we already called endAudio on it as soon as we were don sending all the data.
         [micClient endMicAndRecognition];
+        [self closeRecorder];
+        if (capture != nil) {
+            // The audio queue is torn down on the main queue, away from the service callback.
+            OxfordAudioCapture* finished = capture;
+            capture = nil;
+            dispatch_async(dispatch_get_main_queue(), ^{
+                [finished stop];
+            });
+        }
+        // The service is done with this session, drop any pushed audio still queued.
+        BOOL pushed = pushQueue != nil;
+        [pushQueue cancel];
+        pushQueue = nil;
+        if (typeahead != nil) {
+            [self persistTypeahead];
+        }
+        [self sendSessionEnd:pushed];
     }
 
     if ((recoMode == SpeechRecognitionMode_ShortPhrase) || isFinalDicationMessage) {
     }
     
-    if (!isFinalDicationMessage && [response.RecognizedPhrase count] > 0) {
+    NSUInteger phrase = !isFinalDicationMessage && [response.RecognizedPhrase count] > 0 ? [booster choose:response] : 0;
+    NSString* result = !isFinalDicationMessage && [response.RecognizedPhrase count] > 0
+                     ? ((RecognizedPhrase*)response.RecognizedPhrase[phrase]).DisplayText : nil;
+    if (retry == nil) {
+        [self sendFinalResult:result turn:turn retry:nil];
+        return;
+    }
+
+    // Finals are delivered in order on one queue, so a retried final holds back the ones after
+    // it instead of being overtaken.
+    BOOL weak = !isFinalDicationMessage && [retry shouldRetry:response phrase:phrase];
+    NSData* audio = [retry takeAudio:weak];
+    OxfordRetryCandidate* original = [[OxfordRetryCandidate alloc] init];
+    original.text = result;
+    original.confidence = [OxfordConfidenceRetry score:response phrase:phrase];
+    original.language = language;
+    original.mode = recoMode;
+    dispatch_async(finalDelivery, ^{
+        if (audio == nil) {
+            [self sendFinalResult:result turn:turn retry:nil];
+            return;
+        }
+        OxfordRetryCandidate* best = [retry retry:audio original:original key:primaryKey];
+        [self sendFinalResult:best.text turn:turn retry:@{
+            @"improved": @(best != original),
+            @"language": best.language ?: @"",
+            @"mode": best.mode == SpeechRecognitionMode_LongDictation ? @"longDictation" : @"shortPhrase",
+            @"confidence": @(best.confidence)
+        }];
+    });
+}
+
+/**
+* Send a final result to JS and add it to the transcript. Without a result only the transcript
+* tail is cleared.
+*/
+-(void)sendFinalResult:(NSString*)result turn:(OxfordTurn*)turn retry:(NSDictionary*)retryInfo
+{
+    if (result.length > 0) {
         dispatch_async(dispatch_get_main_queue(), ^{
-            RecognizedPhrase* phrase = response.RecognizedPhrase[0];
-            NSString* result = phrase.DisplayText;
             NSLog(@"OxfordSR - Final %@", result);
 
             NSMutableDictionary * event = [[NSMutableDictionary alloc]init];
             [event setValue:result forKey:@"result"];
+            [event setValue:[turn toDictionary] forKey:@"turn"];
+            [event setValue:retryInfo forKey:@"retry"];
+            if (transcript != nil) {
+                NSInteger segment = [transcript append:result];
+                if (segment >= 0) {
+                    [event setValue:@(segment) forKey:@"segment"];
+                }
+                [self sendTranscriptEdit:(segment >= 0 ? [OxfordTranscript edit:@"insert" segment:segment text:result]
+                                                       : [OxfordTranscript edit:@"tail" segment:-1 text:@""])];
+            }
             
             self.pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:event];
             [self.pluginResult setKeepCallbackAsBool:YES];
             [self.commandDelegate sendPluginResult:self.pluginResult callbackId:self.command.callbackId];
+
+            if (typeahead != nil) {
+                lastCompletions = nil;
+                if ([typeahead add:result weight:1]) {
+                    [self persistTypeahead];
+                }
+            }
+        });
+    } else if (transcript != nil) {
+        // Nothing recognized, but the partial shown so far is gone.
+        dispatch_async(dispatch_get_main_queue(), ^{
+            transcript.tail = @"";
+            [self sendTranscriptEdit:[OxfordTranscript edit:@"tail" segment:-1 text:@""]];
         });
     }
-    
+}
+
+/**
+* Update the location and text context. Only the change crosses the bridge; the clients of the
+* current session get what is new right away and later clients get all of it.
+*/
+- (void) updateContext:(CDVInvokedUrlCommand*)command
+{
+    NSDictionary* change = [command argumentAtIndex:0 withDefault:nil andClass:[NSDictionary class]];
+    [context update:change];
+    [context applyTo:dataClient];
+    [context applyTo:micClient];
+
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:[context toDictionary]];
+    [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+}
+
+-(NSString*)vocabularyPath
+{
+    NSString* library = NSSearchPathForDirectoriesInDomains(NSLibraryDirectory, NSUserDomainMask, YES)[0];
+    return [library stringByAppendingPathComponent:@"OxfordVocabulary.trie"];
+}
+
+/**
+* Replace the booster vocabulary. Entries are phrases or {text, weight} objects; the trie is built
+* and mapped in the background and kept for the next launch.
+*/
+- (void) setVocabulary:(CDVInvokedUrlCommand*)command
+{
+    NSArray* phrases = [command argumentAtIndex:0 withDefault:@[] andClass:[NSArray class]];
+    // Without the booster option the vocabulary is only stored, for a later init with it.
+    OxfordPhraseBooster* target = booster;
+    NSString* path = [self vocabularyPath];
+    [self.commandDelegate runInBackground:^{
+        NSMutableDictionary* entries = [[NSMutableDictionary alloc] init];
+        NSCharacterSet* whitespace = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+        for (id entry in phrases) {
+            BOOL isObject = [entry isKindOfClass:[NSDictionary class]];
+            NSString* text = isObject ? entry[@"text"] : entry;
+            if (![text isKindOfClass:[NSString class]]) {
+                continue;
+            }
+            NSArray* words = [[text lowercaseString] componentsSeparatedByCharactersInSet:whitespace];
+            NSString* key = [[words filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"length > 0"]]
+                             componentsJoinedByString:@" "];
+            if (key.length > 0) {
+                uint32_t weight = MAX(1, isObject && entry[@"weight"] ? [entry[@"weight"] intValue] : 1);
+                entries[key] = @([entries[key] unsignedIntValue] + weight);
+            }
+        }
+
+        CDVPluginResult* result;
+        OxfordCompactTrie* trie = nil;
+        if ([OxfordCompactTrie writeEntries:entries toFile:path]) {
+            trie = [OxfordCompactTrie trieWithContentsOfFile:path];
+        }
+        if (trie != nil) {
+            target.vocabulary = trie;
+            result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK
+                                   messageAsDictionary:@{ @"phrases": @(entries.count), @"nodes": @(trie.nodeCount),
+                                                          @"boosting": @(target != nil) }];
+        } else {
+            result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsString:@"vocabulary write failed"];
+        }
+        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+    }];
+}
+
+/**
+* Return the metrics of the enabled features, keyed by feature.
+*/
+- (void) getMetrics:(CDVInvokedUrlCommand*)command
+{
+    NSMutableDictionary * metrics = [[NSMutableDictionary alloc]init];
+    [metrics setValue:[retry toDictionary] forKey:@"retry"];
+    [metrics setValue:[booster toDictionary] forKey:@"booster"];
+    [metrics setValue:[context toDictionary] forKey:@"context"];
+    [metrics setValue:[typeahead toDictionary] forKey:@"typeahead"];
+    [metrics setValue:[governor toDictionary] forKey:@"governor"];
+    [metrics setValue:self.startup forKey:@"startup"];
+
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:metrics];
+    [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+}
+
+-(void)sendTranscriptEdit:(NSDictionary*)edit
+{
+    NSMutableDictionary * event = [[NSMutableDictionary alloc]init];
+    [event setValue:edit forKey:@"edit"];
+
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:event];
+    [result setKeepCallbackAsBool:YES];
+    [self.commandDelegate sendPluginResult:result callbackId:self.command.callbackId];
+}
+
+/**
+* Return the transcript text, or the [start, end) range of it if given.
+*/
+- (void) getTranscript:(CDVInvokedUrlCommand*)command
+{
+    NSMutableDictionary * info = [[NSMutableDictionary alloc]init];
+    @synchronized(transcript) {
+        NSUInteger length = transcript.length;
+        NSNumber* start = [command argumentAtIndex:0 withDefault:@0 andClass:[NSNumber class]];
+        NSNumber* end = [command argumentAtIndex:1 withDefault:@(length) andClass:[NSNumber class]];
+        [info setValue:([transcript textFrom:MAX(0, start.integerValue) to:MAX(0, end.integerValue)] ?: @"") forKey:@"text"];
+        [info setValue:@(length) forKey:@"length"];
+        [info setValue:@(transcript.segmentCount) forKey:@"segments"];
+    }
+
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:info];
+    [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
 }
 
 /**
@@ -145,6 +713,7 @@ ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEAL
 */
 -(void)onError:(NSString*)errorMessage withErrorCode:(int)errorCode
 {
+    [self.recorder writeText:[NSString stringWithFormat:@"%d %@", errorCode, errorMessage] type:OxfordRecordType_Error];
     dispatch_async(dispatch_get_main_queue(), ^{
     });
 }
@@ -155,6 +724,7 @@ ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEAL
 */
 -(void)onMicrophoneStatus:(Boolean)recording
 {
+    [self.recorder writeText:(recording ? @"1" : @"0") type:OxfordRecordType_AudioEvent];
     if (!recording) {
         [micClient endMicAndRecognition];
     }
@@ -183,22 +753,47 @@ NSString* ConvertSpeechRecoConfidenceEnumToString(Confidence confidence)
     }
 }
 
+/**
+* Serialize a final result for the recorder.
+*/
+NSDictionary* ConvertRecognitionResultToDictionary(RecognitionResult* response)
+{
+    NSMutableArray* phrases = [[NSMutableArray alloc] init];
+    for (RecognizedPhrase* phrase in response.RecognizedPhrase) {
+        [phrases addObject:@{
+            @"text": phrase.DisplayText ?: @"",
+            @"lexical": phrase.LexicalForm ?: @"",
+            @"confidence": @(phrase.Confidence)
+        }];
+    }
+    return @{ @"status": @(response.RecognitionStatus), @"phrases": phrases };
+}
+
 /**
 * Action for pressing the "Start" button
 */
 - (void) start:(CDVInvokedUrlCommand*)command
 {
     NSLog(@"OxfordSR - Start");
-    [micClient startMicAndRecognition];
-    NSLog(@"OxfordSR - Start 2");
+    [self prepareForSession:@"start" then:^{
+        self.command = command;
+        [transcript reset];
+        [self applyGovernor];
+        if (useCapture) {
+            [self startCaptureSession];
+        } else {
+            [context applyTo:micClient];
+            [micClient startMicAndRecognition];
+        }
+        NSLog(@"OxfordSR - Start 2");
 
-    self.command = command;
-    NSString* result = @"";
-    NSMutableDictionary * event = [[NSMutableDictionary alloc]init];
-    [event setValue:result forKey:@"start"];
-    self.pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:event];
-    [self.pluginResult setKeepCallbackAsBool:YES];
-    [self.commandDelegate sendPluginResult:self.pluginResult callbackId:self.command.callbackId];
+        NSString* result = @"";
+        NSMutableDictionary * event = [[NSMutableDictionary alloc]init];
+        [event setValue:result forKey:@"start"];
+        self.pluginResult = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:event];
+        [self.pluginResult setKeepCallbackAsBool:YES];
+        [self.commandDelegate sendPluginResult:self.pluginResult callbackId:self.command.callbackId];
+    }];
 }
 
 /**
@@ -207,14 +802,447 @@ NSString* ConvertSpeechRecoConfidenceEnumToString(Confidence confidence)
 - (void) stop:(CDVInvokedUrlCommand*)command
 {
     NSLog(@"OxfordSR - Stop");
-    bool isRecieivedResponse = false;
+    [self afterSessionStart:^{
+        if (pushQueue != nil) {
+            [pushQueue end];
+            return;
+        }
+        if (useCapture) {
+            [self stopCaptureSession];
+            return;
+        }
+
+        bool isRecieivedResponse = false;
     
-    if (micClient != nil) {
-        isRecieivedResponse = [micClient waitForFinalResponse:(waitSeconds)];
-        [micClient endMicAndRecognition];
-        //[micClient finalize];
+        if (micClient != nil) {
+            isRecieivedResponse = [micClient waitForFinalResponse:(waitSeconds)];
+            [micClient endMicAndRecognition];
+            //[micClient finalize];
+        }
+    }];
+}
+
+/**
+* Starts a recognition session fed by the plugin-owned capture.
+*/
+-(void)startCaptureSession
+{
+    [capture stop];
+    [pushQueue cancel];
+    pushQueue = nil;
+
+    [turnSegmenter reset];
+    lastFinalSample = 0;
+    if (turnSegmenter.sessionPerTurn) {
+        [self closeTurnSessions];
+        dataClient = [self openTurnSession:[turnSegmenter currentTurn]];
+    } else {
+        [self createDataClient];
+    }
+    [self openRecorder];
+
+    SpeechAudioFormat* format = [SpeechAudioFormat create16BitPCMFormat:OxfordCaptureSampleRate];
+    [dataClient sendAudioFormat:format];
+    [self.recorder writeFormat:format];
+    sendGate = [governor createGate:dataClient delegate:self];
+
+    [qualityAnalyzer reset];
+    [preprocessor reset];
+    [retry clear];
+    reportedIssues = OxfordAudioIssue_None;
+    captureAborted = NO;
+
+    capture = [[OxfordAudioCapture alloc] initWithDelegate:self];
+    if (![capture start]) {
+        [self sendError:@"capture" withDetail:nil];
+    }
+}
+
+/**
+* Stops the capture and tells the service no more audio is coming. The final
+* response arrives through onFinalResponseReceived.
+*/
+-(void)stopCaptureSession
+{
+    [capture stop];
+    capture = nil;
+    @synchronized(turnSessions) {
+        [sendGate flush];
+        [dataClient endAudio];
+    }
+    [self.recorder writeEndAudio];
+}
+
+/**
+* Let the governor pick the profile of the session that is starting.
+*/
+-(void)applyGovernor
+{
+    if (governor != nil) {
+        [governor select:[OxfordDeviceState sample]];
+    }
+}
+
+-(void)createDataClient
+{
+    [self closeTurnSessions];
+    dataClient = [SpeechRecognitionServiceFactory createDataClient:(recoMode)
+                                                      withLanguage:(language)
+                                                           withKey:(primaryKey)
+                                                      withProtocol:(self)];
+    [context applyTo:dataClient];
+}
+
+/**
+* Create the client of a turn's session, kept alive until it has delivered EndOfDictation.
+*/
+-(DataRecognitionClient*)openTurnSession:(OxfordTurn*)turn
+{
+    OxfordTurnSession* session = [[OxfordTurnSession alloc] init];
+    session.plugin = self;
+    session.turn = turn;
+    session.client = [SpeechRecognitionServiceFactory createDataClient:(recoMode)
+                                                           withLanguage:(language)
+                                                                withKey:(primaryKey)
+                                                           withProtocol:(session)];
+    [context applyTo:session.client];
+    @synchronized(turnSessions) {
+        [turnSessions addObject:session];
+    }
+    return session.client;
+}
+
+/**
+* Drop the turn sessions still open from a previous session.
+*/
+-(void)closeTurnSessions
+{
+    @synchronized(turnSessions) {
+        [turnSessions removeAllObjects];
+    }
+}
+
+/**
+* Report a speaker change and, if configured, hand the new turn its own session. The previous
+* client is ended, and kept alive until it has delivered EndOfDictation. A change is only
+* detected once a window (windowMs) and a quarter of the new speaker has been heard, so that much
+* of the new turn still goes to the previous session.
+*/
+-(void)turnChanged:(OxfordTurn*)turn
+{
+    NSLog(@"OxfordSR - Turn %d speaker %d", turn.turnId, turn.speaker);
+    if (turnSegmenter.sessionPerTurn) {
+        DataRecognitionClient* client = [self openTurnSession:turn];
+        [client sendAudioFormat:[SpeechAudioFormat create16BitPCMFormat:OxfordCaptureSampleRate]];
+        @synchronized(turnSessions) {
+            [sendGate flush];
+            [dataClient endAudio];
+            [sendGate setClient:client];
+            dataClient = client;
+        }
+    }
+
+    NSDictionary* turnInfo = [turn toDictionary];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        NSMutableDictionary * event = [[NSMutableDictionary alloc]init];
+        [event setValue:turnInfo forKey:@"turn"];
+
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:event];
+        [result setKeepCallbackAsBool:YES];
+        [self.commandDelegate sendPluginResult:result callbackId:self.command.callbackId];
+    });
+}
+
+/**
+* Start a new recording for the session if recording is enabled, dropping the oldest
+* recordings beyond the configured limit.
+*/
+-(void)openRecorder
+{
+    [self closeRecorder];
+    if (recordingDir == nil) {
+        return;
     }
 
+    NSArray* existing = [self listRecordingPaths];
+    for (NSUInteger i = 0; existing.count >= maxRecordings && i <= existing.count - maxRecordings; i++) {
+        [[NSFileManager defaultManager] removeItemAtPath:existing[i] error:nil];
+    }
+
+    long long now = (long long)([[NSDate date] timeIntervalSince1970] * 1000);
+    NSString* path = [recordingDir stringByAppendingPathComponent:[NSString stringWithFormat:@"session-%lld.oxsr", now]];
+    self.recorder = [[OxfordSessionRecorder alloc] initWithPath:path];
+    if (self.recorder == nil) {
+        return;
+    }
+
+    NSMutableDictionary * event = [[NSMutableDictionary alloc]init];
+    [event setValue:path forKey:@"recording"];
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:event];
+    [result setKeepCallbackAsBool:YES];
+    [self.commandDelegate sendPluginResult:result callbackId:self.command.callbackId];
+}
+
+-(void)closeRecorder
+{
+    // Writes that still hold it after this are ignored.
+    OxfordSessionRecorder* finished = self.recorder;
+    self.recorder = nil;
+    [finished close];
+}
+
+-(NSArray*)listRecordingPaths
+{
+    NSMutableArray* paths = [[NSMutableArray alloc] init];
+    if (recordingDir == nil) {
+        return paths;
+    }
+    NSArray* names = [[[NSFileManager defaultManager] contentsOfDirectoryAtPath:recordingDir error:nil]
+                      sortedArrayUsingSelector:@selector(compare:)];
+    for (NSString* name in names) {
+        [paths addObject:[recordingDir stringByAppendingPathComponent:name]];
+    }
+    return paths;
+}
+
+/**
+* List the session recordings, oldest first.
+*/
+- (void) listRecordings:(CDVInvokedUrlCommand*)command
+{
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsArray:[self listRecordingPaths]];
+    [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+}
+
+/**
+* Replay a recording through a fresh DataRecognitionClient. Results arrive through the usual
+* callbacks; if recording is enabled the replayed session is recorded as well.
+*/
+- (void) replay:(CDVInvokedUrlCommand*)command
+{
+    NSLog(@"OxfordSR - Replay");
+    [self prepareForSession:@"replay" then:^{
+        NSString* path = [command argumentAtIndex:0];
+        NSDictionary* options = [command argumentAtIndex:1 withDefault:nil andClass:[NSDictionary class]];
+        BOOL realtime = options[@"realtime"] == nil || [options[@"realtime"] boolValue];
+
+        self.command = command;
+        [transcript reset];
+        [capture stop];
+        capture = nil;
+        [pushQueue cancel];
+        pushQueue = nil;
+        [self createDataClient];
+        [self openRecorder];
+
+        DataRecognitionClient* client = dataClient;
+        OxfordSessionRecorder* replayRecorder = self.recorder;
+        [self.commandDelegate runInBackground:^{
+            NSString* error = OxfordReplaySession(path, client, replayRecorder, realtime);
+            NSLog(@"OxfordSR - Replay finished %@", error ?: @"");
+            if (error != nil) {
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    [self sendError:@"replay" withDetail:@{ @"path": path, @"message": error }];
+                });
+            }
+        }];
+    }];
+}
+
+/**
+* Start a recognition session fed by pushAudio calls from JS instead of the microphone.
+*/
+- (void) startAudio:(CDVInvokedUrlCommand*)command
+{
+    NSLog(@"OxfordSR - Start audio");
+    [self prepareForSession:@"startAudio" then:^{
+        self.command = command;
+        [transcript reset];
+        [self applyGovernor];
+        [capture stop];
+        capture = nil;
+        [pushQueue cancel];
+
+        [self createDataClient];
+        [self openRecorder];
+
+        SpeechAudioFormat* format = [SpeechAudioFormat create16BitPCMFormat:OxfordCaptureSampleRate];
+        [dataClient sendAudioFormat:format];
+        [self.recorder writeFormat:format];
+
+        pushQueue = [[OxfordAudioPushQueue alloc] initWithClient:dataClient
+                                                        recorder:self.recorder
+                                                        capacity:pushCapacity
+                                                       highWater:pushHighWater
+                                                        lowWater:pushLowWater];
+        pushQueue.delegate = self;
+        pushQueue.retryBuffer = retry;
+        [retry clear];
+        [pushQueue start];
+
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_NO_RESULT];
+        [result setKeepCallbackAsBool:YES];
+        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+    }];
+}
+
+/**
+* Queue one chunk of 16 kHz mono 16-bit little endian PCM. The reply tells JS how full the queue is
+* and whether to hold off until the drain event; a chunk that doesn't fit is refused with a
+* queue_full error.
+*/
+- (void) pushAudio:(CDVInvokedUrlCommand*)command
+{
+    [self afterSessionStart:^{
+        OxfordAudioPushQueue* queue = pushQueue;
+        NSData* chunk = [command argumentAtIndex:0 withDefault:nil andClass:[NSData class]];
+        if (queue == nil || chunk == nil) {
+            CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR
+                                                        messageAsString:(queue == nil ? @"not_started" : @"invalid_audio")];
+            [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+            return;
+        }
+
+        NSNumber* sequence = [command argumentAtIndex:1 withDefault:@0 andClass:[NSNumber class]];
+
+        // Replies and drains can still reach JS out of order (drains go through the main queue), so
+        // both carry the sequence number and JS ignores a drain older than its latest reply.
+        @synchronized(queue) {
+            BOOL queued = [queue offer:chunk sequence:[sequence longLongValue]];
+            NSMutableDictionary * status = [[NSMutableDictionary alloc]init];
+            if (!queued) {
+                [status setValue:@"queue_full" forKey:@"error"];
+            }
+            [status setValue:sequence forKey:@"seq"];
+            [status setValue:@(queue.queuedBytes) forKey:@"queued"];
+            [status setValue:@(queue.capacity) forKey:@"capacity"];
+            [status setValue:@(queue.backpressure) forKey:@"backpressure"];
+
+            CDVPluginResult* result = [CDVPluginResult resultWithStatus:(queued ? CDVCommandStatus_OK : CDVCommandStatus_ERROR)
+                                                    messageAsDictionary:status];
+            [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+        }
+    }];
+}
+
+/**
+* End the pushed audio. The final result arrives through the startAudio callback.
+*/
+- (void) endAudio:(CDVInvokedUrlCommand*)command
+{
+    [self afterSessionStart:^{
+        [pushQueue end];
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK];
+        [self.commandDelegate sendPluginResult:result callbackId:command.callbackId];
+    }];
+}
+
+/**
+* Tell JS the service has finished the session, so pushAudio starts a new one. Sent before the
+* final result, which a retry can hold back.
+*/
+-(void)sendSessionEnd:(BOOL)pushed
+{
+    dispatch_async(dispatch_get_main_queue(), ^{
+        NSMutableDictionary * event = [[NSMutableDictionary alloc]init];
+        [event setValue:@{ @"pushed": @(pushed) } forKey:@"end"];
+
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:event];
+        [result setKeepCallbackAsBool:YES];
+        [self.commandDelegate sendPluginResult:result callbackId:self.command.callbackId];
+    });
+}
+
+-(void)audioPushQueue:(OxfordAudioPushQueue*)queue didDrain:(NSUInteger)queuedBytes sequence:(long long)sequence
+{
+    dispatch_async(dispatch_get_main_queue(), ^{
+        NSMutableDictionary * event = [[NSMutableDictionary alloc]init];
+        [event setValue:@{ @"queued": @(queuedBytes), @"seq": @(sequence) } forKey:@"drain"];
+
+        CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:event];
+        [result setKeepCallbackAsBool:YES];
+        [self.commandDelegate sendPluginResult:result callbackId:self.command.callbackId];
+    });
+}
+
+/**
+* Called on the audio queue thread for every 20 ms frame.
+*/
+-(void)audioCapture:(OxfordAudioCapture*)source didCaptureFrame:(int16_t*)samples count:(int)count
+{
+    if (captureAborted) {
+        return;
+    }
+
+    if (qualityAnalyzer != nil) {
+        OxfordAudioIssue issues = [qualityAnalyzer analyze:samples count:count];
+        if (issues != reportedIssues) {
+            reportedIssues = issues;
+            NSDictionary* quality = [qualityAnalyzer toDictionary];
+            dispatch_async(dispatch_get_main_queue(), ^{
+                NSMutableDictionary * event = [[NSMutableDictionary alloc]init];
+                [event setValue:quality forKey:@"quality"];
+
+                CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_OK messageAsDictionary:event];
+                [result setKeepCallbackAsBool:YES];
+                [self.commandDelegate sendPluginResult:result callbackId:self.command.callbackId];
+            });
+        }
+        if ([qualityAnalyzer shouldAbort]) {
+            // The audio queue can't be stopped from its own callback, so hop to the main queue.
+            NSLog(@"OxfordSR - Abort, audio quality");
+            captureAborted = YES;
+            NSDictionary* quality = [qualityAnalyzer toDictionary];
+            dispatch_async(dispatch_get_main_queue(), ^{
+                [self stopCaptureSession];
+                [self sendError:@"audio_quality" withDetail:quality];
+            });
+            return;
+        }
+    }
+
+    // Quality is judged on the raw capture; the service gets the cleaned up audio.
+    if (governor == nil || governor.profile.preprocessing) {
+        [preprocessor process:samples count:count];
+    }
+
+    OxfordTurn* turn = [turnSegmenter process:samples count:count];
+    if (turn != nil) {
+        [self turnChanged:turn];
+    }
+
+    if (sendGate != nil) {
+        // The recording and the retry buffer get what the gate sends, in audioSendGate:didSend:.
+        [sendGate write:samples count:count];
+        return;
+    }
+    [dataClient sendAudio:[NSData dataWithBytes:samples length:count * sizeof(int16_t)]
+               withLength:count * sizeof(int16_t)];
+    [self.recorder writeAudio:samples length:count * sizeof(int16_t)];
+    [retry write:samples length:count * sizeof(int16_t)];
+}
+
+/**
+* Keep the recording and the retry buffer to exactly the audio the service got.
+*/
+-(void)audioSendGate:(OxfordAudioSendGate*)gate didSend:(NSData*)audio
+{
+    [self.recorder writeAudio:audio.bytes length:(uint32_t)audio.length];
+    [retry write:audio.bytes length:audio.length];
+}
+
+/**
+* Report a locally detected error through the start callback.
+*/
+-(void)sendError:(NSString*)error withDetail:(NSDictionary*)detail
+{
+    NSMutableDictionary * event = [[NSMutableDictionary alloc]init];
+    [event setValue:error forKey:@"error"];
+    [event setValue:detail forKey:@"detail"];
+
+    CDVPluginResult* result = [CDVPluginResult resultWithStatus:CDVCommandStatus_ERROR messageAsDictionary:event];
+    [result setKeepCallbackAsBool:YES];
+    [self.commandDelegate sendPluginResult:result callbackId:self.command.callbackId];
 }
 
 @end
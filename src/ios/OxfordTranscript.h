@@ -0,0 +1,65 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+
+/**
+* Session transcript kept as a piece table.
+*
+* Final results become segments with stable ids (their index); their text is appended to a single
+* add-only buffer and each segment points at its piece of it, so replacing a segment appends the
+* new text and moves the pointer instead of shifting the document. The current partial is a
+* separate mutable tail. A Fenwick tree over the rendered segment lengths gives the character
+* offset of any segment in O(log n), so a range can be read without building the whole text.
+*
+* The document is the segments joined by single spaces, followed by the tail. Offsets are in
+* UTF-16 code units, the same as JS strings. The Android Transcript is the same model.
+*/
+@interface OxfordTranscript : NSObject
+
+@property (nonatomic,readonly) NSUInteger segmentCount;
+@property (nonatomic,readonly) NSUInteger length;
+@property (nonatomic,copy) NSString* tail;
+
+-(void)reset;
+
+/**
+* Append a final result as a new segment and clear the tail. Returns the segment id, or -1 if
+* the text is empty.
+*/
+-(NSInteger)append:(NSString*)text;
+
+/**
+* Replace the text of a segment. Returns NO if there is no such segment.
+*/
+-(BOOL)replaceSegment:(NSInteger)segmentId withText:(NSString*)text;
+
+-(NSString*)text;
+
+/**
+* The document text in [start, end), clamped to the document.
+*/
+-(NSString*)textFrom:(NSUInteger)start to:(NSUInteger)end;
+
+/**
+* The edit operation sent to JS: op is insert, replace or tail; a negative id is left out.
+*/
++(NSDictionary*)edit:(NSString*)op segment:(NSInteger)segmentId text:(NSString*)text;
+
+@end
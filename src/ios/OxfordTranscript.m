@@ -0,0 +1,232 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import "OxfordTranscript.h"
+
+@implementation OxfordTranscript
+{
+    NSMutableString* buffer;
+    NSUInteger* starts;
+    NSUInteger* lengths;
+    NSUInteger* tree;           // 1-based Fenwick tree over rendered lengths
+    NSUInteger capacity;
+}
+
+@synthesize tail = _tail;
+
+-(id)init
+{
+    if (self = [super init]) {
+        buffer = [[NSMutableString alloc] init];
+        capacity = 64;
+        starts = calloc(capacity, sizeof(NSUInteger));
+        lengths = calloc(capacity, sizeof(NSUInteger));
+        tree = calloc(capacity + 1, sizeof(NSUInteger));
+        _tail = @"";
+    }
+    return self;
+}
+
+-(void)dealloc
+{
+    free(starts);
+    free(lengths);
+    free(tree);
+}
+
+-(void)reset
+{
+    @synchronized(self) {
+        [buffer setString:@""];
+        memset(tree, 0, (capacity + 1) * sizeof(NSUInteger));
+        _segmentCount = 0;
+        _tail = @"";
+    }
+}
+
+-(NSInteger)append:(NSString*)text
+{
+    @synchronized(self) {
+        _tail = @"";
+        if (text.length == 0) {
+            return -1;
+        }
+        if (_segmentCount == capacity) {
+            [self grow];
+        }
+        NSUInteger segmentId = _segmentCount++;
+        starts[segmentId] = buffer.length;
+        lengths[segmentId] = text.length;
+        [buffer appendString:text];
+        [self add:[self rendered:segmentId] at:segmentId];
+        return segmentId;
+    }
+}
+
+-(BOOL)replaceSegment:(NSInteger)segmentId withText:(NSString*)text
+{
+    @synchronized(self) {
+        if (segmentId < 0 || segmentId >= _segmentCount || text.length == 0) {
+            return NO;
+        }
+        NSUInteger before = [self rendered:segmentId];
+        starts[segmentId] = buffer.length;
+        lengths[segmentId] = text.length;
+        [buffer appendString:text];
+        // Unsigned wrap-around makes a shorter replacement subtract.
+        [self add:[self rendered:segmentId] - before at:segmentId];
+        return YES;
+    }
+}
+
+-(void)setTail:(NSString*)tail
+{
+    @synchronized(self) {
+        _tail = [tail copy] ?: @"";
+    }
+}
+
+-(NSString*)tail
+{
+    @synchronized(self) {
+        return _tail;
+    }
+}
+
+-(NSUInteger)length
+{
+    @synchronized(self) {
+        return [self prefix:_segmentCount] + [self tailLength];
+    }
+}
+
+-(NSString*)text
+{
+    @synchronized(self) {
+        return [self textFrom:0 to:self.length];
+    }
+}
+
+-(NSString*)textFrom:(NSUInteger)start to:(NSUInteger)end
+{
+    @synchronized(self) {
+        NSUInteger segmentsEnd = [self prefix:_segmentCount];
+        end = MIN(end, segmentsEnd + [self tailLength]);
+        NSMutableString* text = [[NSMutableString alloc] init];
+        if (start >= end) {
+            return text;
+        }
+
+        NSUInteger segmentId = start < segmentsEnd ? [self find:start] : _segmentCount;
+        NSUInteger offset = start < segmentsEnd ? [self prefix:segmentId] : segmentsEnd;
+        for (; segmentId < _segmentCount && offset < end; segmentId++) {
+            NSUInteger separator = segmentId > 0 ? 1 : 0;
+            NSUInteger from = start > offset ? start - offset : 0;
+            NSUInteger to = MIN(end - offset, separator + lengths[segmentId]);
+            if (from < separator) {
+                [text appendString:@" "];
+            }
+            NSUInteger s = MAX(from, separator) - separator;
+            if (s + separator < to) {
+                [text appendString:[buffer substringWithRange:NSMakeRange(starts[segmentId] + s, to - separator - s)]];
+            }
+            offset += [self rendered:segmentId];
+        }
+        if (offset < end) {
+            NSString* tail = _segmentCount > 0 && _tail.length > 0 ? [@" " stringByAppendingString:_tail] : _tail;
+            NSUInteger from = start > offset ? start - offset : 0;
+            [text appendString:[tail substringWithRange:NSMakeRange(from, end - offset - from)]];
+        }
+        return text;
+    }
+}
+
++(NSDictionary*)edit:(NSString*)op segment:(NSInteger)segmentId text:(NSString*)text
+{
+    NSMutableDictionary* edit = [[NSMutableDictionary alloc] init];
+    [edit setValue:op forKey:@"op"];
+    if (segmentId >= 0) {
+        [edit setValue:@(segmentId) forKey:@"id"];
+    }
+    [edit setValue:(text ?: @"") forKey:@"text"];
+    return edit;
+}
+
+-(NSUInteger)rendered:(NSUInteger)segmentId
+{
+    return lengths[segmentId] + (segmentId > 0 ? 1 : 0);
+}
+
+-(NSUInteger)tailLength
+{
+    return _tail.length == 0 ? 0 : _tail.length + (_segmentCount > 0 ? 1 : 0);
+}
+
+-(void)add:(NSUInteger)delta at:(NSUInteger)segmentId
+{
+    for (NSUInteger i = segmentId + 1; i <= capacity; i += i & -i) {
+        tree[i] += delta;
+    }
+}
+
+/**
+* Total rendered length of the first n segments.
+*/
+-(NSUInteger)prefix:(NSUInteger)n
+{
+    NSUInteger sum = 0;
+    for (NSUInteger i = n; i > 0; i -= i & -i) {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+/**
+* Index of the segment containing the offset, which must be below the segments' total length.
+*/
+-(NSUInteger)find:(NSUInteger)offset
+{
+    NSUInteger pos = 0;
+    NSUInteger step = 1;
+    while (step * 2 <= capacity) {
+        step *= 2;
+    }
+    for (; step > 0; step >>= 1) {
+        NSUInteger next = pos + step;
+        if (next <= capacity && tree[next] <= offset) {
+            pos = next;
+            offset -= tree[next];
+        }
+    }
+    return pos;
+}
+
+-(void)grow
+{
+    capacity *= 2;
+    starts = realloc(starts, capacity * sizeof(NSUInteger));
+    lengths = realloc(lengths, capacity * sizeof(NSUInteger));
+    free(tree);
+    tree = calloc(capacity + 1, sizeof(NSUInteger));
+    for (NSUInteger i = 0; i < _segmentCount; i++) {
+        [self add:[self rendered:i] at:i];
+    }
+}
+
+@end
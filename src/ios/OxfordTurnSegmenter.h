@@ -0,0 +1,69 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+
+/**
+* A speaker turn: a stretch of audio attributed to one speaker.
+*/
+@interface OxfordTurn : NSObject
+
+@property (nonatomic,readonly) int turnId;
+@property (nonatomic,readonly) int speaker;
+@property (nonatomic,readonly) long long startSample;
+
+-(NSDictionary*)toDictionary;
+
+@end
+
+/**
+* Streaming speaker-change detector for long dictation.
+* Each 20 ms frame becomes a 24 band log-mel vector (vDSP). Speech frames go into two adjacent
+* sliding windows whose per-band mean and variance are kept as running sums; the symmetric
+* Gaussian divergence between them peaks at a speaker change. A peak above the threshold that
+* holds for a quarter window, at least minTurnMs after the previous change, starts a new turn, and the new window is matched
+* against the speakers seen so far to pick a speaker id.
+* The divergence stands in for a speaker embedding distance, since there is no embedding model on
+* the device; see TurnSegmenter.java for the trade-off.
+*/
+@interface OxfordTurnSegmenter : NSObject
+
+@property (nonatomic,readonly) BOOL sessionPerTurn;
+@property (atomic,readonly) long long samples;
+
+/**
+* Creates a segmenter configured from the "turns" init option.
+*/
+-(id)initWithOptions:(NSDictionary*)options;
+
+-(void)reset;
+
+/**
+* Processes one frame. Returns the new turn if a speaker change was detected.
+*/
+-(OxfordTurn*)process:(const int16_t*)samples count:(int)count;
+
+-(OxfordTurn*)currentTurn;
+
+/**
+* The turn covering the given capture position.
+*/
+-(OxfordTurn*)turnAt:(long long)sample;
+
+@end
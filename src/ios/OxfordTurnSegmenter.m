@@ -0,0 +1,374 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import "OxfordTurnSegmenter.h"
+#import "OxfordAudioCapture.h"
+#import <Accelerate/Accelerate.h>
+
+#define OXFORD_TS_LOG2N 9
+#define OXFORD_TS_FFT_SIZE (1 << OXFORD_TS_LOG2N)
+#define OXFORD_TS_HALF (OXFORD_TS_FFT_SIZE / 2)
+#define OXFORD_TS_BINS (OXFORD_TS_HALF + 1)
+#define OXFORD_TS_BANDS 24
+
+static const float kMinHz = 100.0f;
+static const float kMaxHz = 7600.0f;
+static const float kSpeechGate = 1e-5f;         // mean band power, ~ -50 dBFS
+static const float kVarianceFloor = 1e-3f;
+static const int kFrameMs = OxfordCaptureFrameSamples * 1000 / OxfordCaptureSampleRate;
+
+@implementation OxfordTurn
+
+-(id)initWithId:(int)turnId speaker:(int)speaker startSample:(long long)startSample
+{
+    self = [super init];
+    if (self) {
+        _turnId = turnId;
+        _speaker = speaker;
+        _startSample = startSample;
+    }
+    return self;
+}
+
+-(NSDictionary*)toDictionary
+{
+    return @{
+        @"id": @(self.turnId),
+        @"speaker": @(self.speaker),
+        @"startMs": @(self.startSample * 1000 / OxfordCaptureSampleRate)
+    };
+}
+
+@end
+
+/**
+* Symmetric KL divergence between two diagonal Gaussians, averaged over bands.
+*/
+static float OxfordDivergence(const float* meanA, const float* varA, const float* meanB, const float* varB)
+{
+    float d = 0;
+    for (int b = 0; b < OXFORD_TS_BANDS; b++) {
+        float diff = meanA[b] - meanB[b];
+        d += varA[b] / varB[b] + varB[b] / varA[b] - 2 + diff * diff * (1 / varA[b] + 1 / varB[b]);
+    }
+    return 0.5f * d / OXFORD_TS_BANDS;
+}
+
+static float OxfordHzToMel(float hz) { return 2595.0f * log10f(1.0f + hz / 700.0f); }
+static float OxfordMelToHz(float mel) { return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f); }
+
+@implementation OxfordTurnSegmenter
+{
+    int windowFrames;
+    int minTurnFrames;
+    float threshold;
+    float speakerThreshold;
+
+    FFTSetup fftSetup;
+    float hann[OxfordCaptureFrameSamples];
+    float buffer[OXFORD_TS_FFT_SIZE];
+    float realp[OXFORD_TS_HALF];
+    float imagp[OXFORD_TS_HALF];
+    float power[OXFORD_TS_BINS];
+    float melMatrix[OXFORD_TS_BANDS * OXFORD_TS_BINS];
+    float mel[OXFORD_TS_BANDS];
+
+    // Speech frame history: the left window followed by the right window.
+    float* history;
+    long long* historySample;
+    int historyHead;
+    int historyCount;
+    double leftSum[OXFORD_TS_BANDS];
+    double leftSquares[OXFORD_TS_BANDS];
+    double rightSum[OXFORD_TS_BANDS];
+    double rightSquares[OXFORD_TS_BANDS];
+    float meanA[OXFORD_TS_BANDS];
+    float varA[OXFORD_TS_BANDS];
+    float meanB[OXFORD_TS_BANDS];
+    float varB[OXFORD_TS_BANDS];
+
+    long long lastChangeSample;
+    float peakDistance;
+    long long peakBoundary;
+    int framesSincePeak;
+    NSMutableArray* turns;
+    NSMutableArray* speakerMeans;
+    NSMutableArray* speakerVars;
+}
+
+-(id)initWithOptions:(NSDictionary*)options
+{
+    self = [super init];
+    if (self) {
+        windowFrames = 50;                      // 1 s of speech per side
+        minTurnFrames = 100;                    // 2 s
+        threshold = 1.5f;
+        speakerThreshold = 1.0f;
+        _sessionPerTurn = NO;
+
+        if ([options isKindOfClass:[NSDictionary class]]) {
+            if (options[@"windowMs"]) windowFrames = MAX(10, [options[@"windowMs"] intValue] / kFrameMs);
+            if (options[@"minTurnMs"]) minTurnFrames = [options[@"minTurnMs"] intValue] / kFrameMs;
+            if (options[@"threshold"]) threshold = [options[@"threshold"] floatValue];
+            if (options[@"speakerThreshold"]) speakerThreshold = [options[@"speakerThreshold"] floatValue];
+            if (options[@"sessionPerTurn"]) _sessionPerTurn = [options[@"sessionPerTurn"] boolValue];
+        }
+
+        fftSetup = vDSP_create_fftsetup(OXFORD_TS_LOG2N, kFFTRadix2);
+        vDSP_hann_window(hann, OxfordCaptureFrameSamples, vDSP_HANN_DENORM);
+        history = calloc(2 * windowFrames * OXFORD_TS_BANDS, sizeof(float));
+        historySample = calloc(2 * windowFrames, sizeof(long long));
+        turns = [[NSMutableArray alloc] init];
+        speakerMeans = [[NSMutableArray alloc] init];
+        speakerVars = [[NSMutableArray alloc] init];
+        [self buildMelFilters];
+        [self reset];
+    }
+    return self;
+}
+
+-(void)dealloc
+{
+    vDSP_destroy_fftsetup(fftSetup);
+    free(history);
+    free(historySample);
+}
+
+-(void)reset
+{
+    @synchronized(self) {
+        historyHead = 0;
+        historyCount = 0;
+        memset(leftSum, 0, sizeof(leftSum));
+        memset(leftSquares, 0, sizeof(leftSquares));
+        memset(rightSum, 0, sizeof(rightSum));
+        memset(rightSquares, 0, sizeof(rightSquares));
+        _samples = 0;
+        lastChangeSample = 0;
+        peakDistance = 0;
+        peakBoundary = 0;
+        framesSincePeak = 0;
+        [turns removeAllObjects];
+        [speakerMeans removeAllObjects];
+        [speakerVars removeAllObjects];
+        [turns addObject:[[OxfordTurn alloc] initWithId:0 speaker:0 startSample:0]];
+    }
+}
+
+-(OxfordTurn*)process:(const int16_t*)samples count:(int)count
+{
+    long long frameStart = _samples;
+    _samples += count;
+    if (count != OxfordCaptureFrameSamples || ![self computeLogMel:samples]) {
+        return nil;
+    }
+    [self push:frameStart];
+
+    int window = windowFrames;
+    if (historyCount < 2 * window) {
+        return nil;
+    }
+
+    [self stats:leftSum squares:leftSquares mean:meanA var:varA];
+    [self stats:rightSum squares:rightSquares mean:meanB var:varB];
+    float distance = OxfordDivergence(meanA, varA, meanB, varB);
+    long long boundary = historySample[(historyHead + window) % (2 * window)];
+
+    OxfordTurn* turn = nil;
+    // The distance wobbles as syllables enter and leave the windows, so a peak only counts once
+    // nothing higher has followed it for a quarter window.
+    if (distance > threshold && distance > peakDistance) {
+        peakDistance = distance;
+        peakBoundary = boundary;
+        framesSincePeak = 0;
+    } else if (peakDistance > 0 && (++framesSincePeak >= window / 4 || distance < threshold)) {
+        if (peakBoundary - lastChangeSample >= (long long)minTurnFrames * OxfordCaptureFrameSamples) {
+            turn = [self startTurn:peakBoundary];
+        }
+        peakDistance = 0;
+    }
+    return turn;
+}
+
+-(OxfordTurn*)currentTurn
+{
+    @synchronized(self) {
+        return [turns lastObject];
+    }
+}
+
+-(OxfordTurn*)turnAt:(long long)sample
+{
+    @synchronized(self) {
+        for (NSInteger i = (NSInteger)turns.count - 1; i > 0; i--) {
+            OxfordTurn* turn = turns[i];
+            if (turn.startSample <= sample) {
+                return turn;
+            }
+        }
+        return turns[0];
+    }
+}
+
+-(OxfordTurn*)startTurn:(long long)startSample
+{
+    @synchronized(self) {
+        if (speakerMeans.count == 0) {
+            [speakerMeans addObject:[NSMutableData dataWithBytes:meanA length:sizeof(meanA)]];
+            [speakerVars addObject:[NSMutableData dataWithBytes:varA length:sizeof(varA)]];
+        }
+
+        int speaker = -1;
+        float best = FLT_MAX;
+        for (int s = 0; s < (int)speakerMeans.count; s++) {
+            float d = OxfordDivergence([speakerMeans[s] bytes], [speakerVars[s] bytes], meanB, varB);
+            if (d < best) {
+                best = d;
+                speaker = s;
+            }
+        }
+        if (best > speakerThreshold) {
+            speaker = (int)speakerMeans.count;
+            [speakerMeans addObject:[NSMutableData dataWithBytes:meanB length:sizeof(meanB)]];
+            [speakerVars addObject:[NSMutableData dataWithBytes:varB length:sizeof(varB)]];
+        } else {
+            float* mean = [speakerMeans[speaker] mutableBytes];
+            float* var = [speakerVars[speaker] mutableBytes];
+            for (int b = 0; b < OXFORD_TS_BANDS; b++) {
+                mean[b] = 0.8f * mean[b] + 0.2f * meanB[b];
+                var[b] = 0.8f * var[b] + 0.2f * varB[b];
+            }
+        }
+
+        OxfordTurn* turn = [[OxfordTurn alloc] initWithId:(int)turns.count speaker:speaker startSample:startSample];
+        [turns addObject:turn];
+        lastChangeSample = startSample;
+        return turn;
+    }
+}
+
+/**
+* Computes the log-mel vector of a frame. Returns NO below the speech gate.
+*/
+-(BOOL)computeLogMel:(const int16_t*)samples
+{
+    const float toFloat = 1.0f / 32768.0f;
+    vDSP_vflt16(samples, 1, buffer, 1, OxfordCaptureFrameSamples);
+    vDSP_vsmul(buffer, 1, &toFloat, buffer, 1, OxfordCaptureFrameSamples);
+    vDSP_vmul(buffer, 1, hann, 1, buffer, 1, OxfordCaptureFrameSamples);
+    vDSP_vclr(buffer + OxfordCaptureFrameSamples, 1, OXFORD_TS_FFT_SIZE - OxfordCaptureFrameSamples);
+
+    DSPSplitComplex split = { realp, imagp };
+    vDSP_ctoz((DSPComplex*)buffer, 2, &split, 1, OXFORD_TS_HALF);
+    vDSP_fft_zrip(fftSetup, &split, 1, OXFORD_TS_LOG2N, FFT_FORWARD);
+
+    // Packed format: DC in realp[0], Nyquist in imagp[0]; zrip scales by 2, so power by 4.
+    float dc = realp[0];
+    float nyquist = imagp[0];
+    vDSP_zvmags(&split, 1, power, 1, OXFORD_TS_HALF);
+    power[0] = dc * dc;
+    power[OXFORD_TS_HALF] = nyquist * nyquist;
+    const float quarter = 0.25f;
+    vDSP_vsmul(power, 1, &quarter, power, 1, OXFORD_TS_BINS);
+
+    vDSP_mmul(melMatrix, 1, power, 1, mel, 1, OXFORD_TS_BANDS, 1, OXFORD_TS_BINS);
+
+    float mean;
+    vDSP_meanv(mel, 1, &mean, OXFORD_TS_BANDS);
+    if (mean < kSpeechGate * OXFORD_TS_FFT_SIZE) {
+        return NO;
+    }
+    for (int b = 0; b < OXFORD_TS_BANDS; b++) {
+        mel[b] = logf(mel[b] + 1e-10f);
+    }
+    return YES;
+}
+
+/**
+* Appends the current log-mel frame; the oldest right frame moves to the left window and
+* the oldest left frame drops out.
+*/
+-(void)push:(long long)frameStart
+{
+    int window = windowFrames;
+    int capacity = 2 * window;
+    if (historyCount == capacity) {
+        int oldest = historyHead;
+        int middle = (historyHead + window) % capacity;
+        for (int b = 0; b < OXFORD_TS_BANDS; b++) {
+            float left = history[oldest * OXFORD_TS_BANDS + b];
+            float moved = history[middle * OXFORD_TS_BANDS + b];
+            leftSum[b] += moved - left;
+            leftSquares[b] += moved * moved - left * left;
+            rightSum[b] -= moved;
+            rightSquares[b] -= moved * moved;
+        }
+        historyHead = (historyHead + 1) % capacity;
+        historyCount--;
+    }
+
+    int slot = (historyHead + historyCount) % capacity;
+    memcpy(history + slot * OXFORD_TS_BANDS, mel, sizeof(mel));
+    historySample[slot] = frameStart;
+    for (int b = 0; b < OXFORD_TS_BANDS; b++) {
+        float v = mel[b];
+        if (historyCount < window) {
+            leftSum[b] += v;
+            leftSquares[b] += v * v;
+        } else {
+            rightSum[b] += v;
+            rightSquares[b] += v * v;
+        }
+    }
+    historyCount++;
+}
+
+-(void)stats:(const double*)sum squares:(const double*)squares mean:(float*)mean var:(float*)var
+{
+    for (int b = 0; b < OXFORD_TS_BANDS; b++) {
+        double m = sum[b] / windowFrames;
+        mean[b] = (float)m;
+        var[b] = (float)MAX(squares[b] / windowFrames - m * m, kVarianceFloor);
+    }
+}
+
+-(void)buildMelFilters
+{
+    float minMel = OxfordHzToMel(kMinHz);
+    float maxMel = OxfordHzToMel(kMaxHz);
+    int edges[OXFORD_TS_BANDS + 2];
+    for (int i = 0; i < OXFORD_TS_BANDS + 2; i++) {
+        float hz = OxfordMelToHz(minMel + (maxMel - minMel) * i / (OXFORD_TS_BANDS + 1));
+        edges[i] = (int)floorf(hz * OXFORD_TS_FFT_SIZE / OxfordCaptureSampleRate);
+    }
+
+    vDSP_vclr(melMatrix, 1, OXFORD_TS_BANDS * OXFORD_TS_BINS);
+    for (int b = 0; b < OXFORD_TS_BANDS; b++) {
+        int lo = edges[b];
+        int center = MAX(edges[b + 1], lo + 1);
+        int hi = MIN(MAX(edges[b + 2], center + 1), OXFORD_TS_BINS - 1);
+        for (int k = lo; k <= hi; k++) {
+            melMatrix[b * OXFORD_TS_BINS + k] = k <= center
+                ? (float)(k - lo) / (center - lo)
+                : (float)(hi - k) / MAX(hi - center, 1);
+        }
+    }
+}
+
+@end
@@ -0,0 +1,74 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+#import "OxfordCompactTrie.h"
+
+/**
+* Frequency weighted typeahead over past final results and service suggestions.
+*
+* The persisted index is a memory mapped OxfordCompactTrie; phrases seen since it was written are
+* counted in a small in-memory dictionary and folded in by persist, which rebuilds the file and
+* swaps the mapping. A prefix query is a best-first walk ordered by the subtree maxima stored in the
+* trie, so it only visits branches that can still make the top k, plus a scan of the pending phrases.
+* Completions are {text, weight} dictionaries in normalized form.
+*/
+@interface OxfordTypeaheadIndex : NSObject
+
+/**
+* Completions offered per partial.
+*/
+@property (nonatomic,readonly) NSUInteger limit;
+
+/**
+* Creates an index configured from the "typeahead" init option. The file is not read until load.
+*/
+-(id)initWithPath:(NSString*)path options:(NSDictionary*)options;
+
+/**
+* Map the persisted index, if there is one.
+*/
+-(void)load;
+
+/**
+* Lower case, letters, digits and apostrophes only, single spaces. Partials and finals differ in
+* casing and punctuation, so both are compared in this form.
+*/
++(NSString*)normalize:(NSString*)text;
+
+/**
+* Count an occurrence of a phrase. Returns YES once enough phrases are pending that the index
+* should be persisted.
+*/
+-(BOOL)add:(NSString*)text weight:(uint32_t)weight;
+
+/**
+* The most frequent phrases starting with the prefix, best first.
+*/
+-(NSArray*)query:(NSString*)prefix limit:(NSUInteger)limit;
+
+/**
+* Fold the pending phrases into the persisted index, keeping the most frequent maxEntries.
+* Blocking; call it in the background.
+*/
+-(void)persist;
+
+-(NSDictionary*)toDictionary;
+
+@end
@@ -0,0 +1,283 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#import "OxfordTypeaheadIndex.h"
+#import <mach/mach_time.h>
+
+/**
+* Best-first queue entry: a node still to expand, or a key ending at a node.
+*/
+@interface OxfordTypeaheadStep : NSObject
+@property (nonatomic) uint32_t node;
+@property (nonatomic,strong) NSString* key;
+@property (nonatomic) uint32_t priority;
+@property (nonatomic) BOOL terminal;
+@end
+
+@implementation OxfordTypeaheadStep
+@end
+
+static NSComparisonResult OxfordCompareSteps(OxfordTypeaheadStep* a, OxfordTypeaheadStep* b)
+{
+    // Ascending, so the best step is the last one.
+    return a.priority == b.priority ? NSOrderedSame : a.priority < b.priority ? NSOrderedAscending : NSOrderedDescending;
+}
+
+@implementation OxfordTypeaheadIndex
+{
+    NSString* path;
+    NSUInteger maxEntries;
+    NSUInteger maxLength;
+    NSUInteger persistAfter;
+
+    OxfordCompactTrie* trie;
+    NSMutableDictionary* pending;
+    BOOL persisting;
+
+    // Metrics
+    uint64_t queries;
+    uint64_t queryTicks;
+    uint64_t loadTicks;
+}
+
+-(id)initWithPath:(NSString*)filePath options:(NSDictionary*)options
+{
+    if (self = [super init]) {
+        if (![options isKindOfClass:[NSDictionary class]]) {
+            options = nil;
+        }
+        path = filePath;
+        maxEntries = options[@"maxEntries"] ? [options[@"maxEntries"] unsignedIntegerValue] : 50000;
+        maxLength = options[@"maxLength"] ? [options[@"maxLength"] unsignedIntegerValue] : 200;
+        persistAfter = options[@"persistAfter"] ? [options[@"persistAfter"] unsignedIntegerValue] : 100;
+        _limit = options[@"limit"] ? [options[@"limit"] unsignedIntegerValue] : 5;
+        pending = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+-(void)load
+{
+    uint64_t start = mach_absolute_time();
+    OxfordCompactTrie* loaded = [OxfordCompactTrie trieWithContentsOfFile:path];
+    @synchronized(self) {
+        trie = loaded;
+        loadTicks = mach_absolute_time() - start;
+    }
+}
+
++(NSString*)normalize:(NSString*)text
+{
+    NSMutableString* normalized = [[NSMutableString alloc] initWithCapacity:text.length];
+    NSCharacterSet* alphanumeric = [NSCharacterSet alphanumericCharacterSet];
+    NSCharacterSet* whitespace = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    BOOL space = NO;
+    for (NSUInteger i = 0; i < text.length; i++) {
+        unichar c = [text characterAtIndex:i];
+        if ([alphanumeric characterIsMember:c] || c == '\'') {
+            if (space && normalized.length > 0) {
+                [normalized appendString:@" "];
+            }
+            space = NO;
+            [normalized appendFormat:@"%C", c];
+        } else if ([whitespace characterIsMember:c]) {
+            space = YES;
+        }
+    }
+    return [normalized lowercaseString];
+}
+
+-(BOOL)add:(NSString*)text weight:(uint32_t)weight
+{
+    NSString* key = [OxfordTypeaheadIndex normalize:text];
+    if (key.length == 0 || key.length > maxLength) {
+        return NO;
+    }
+    @synchronized(self) {
+        pending[key] = @([pending[key] unsignedIntValue] + weight);
+        return pending.count >= persistAfter && !persisting;
+    }
+}
+
+-(NSArray*)query:(NSString*)text limit:(NSUInteger)limit
+{
+    uint64_t start = mach_absolute_time();
+    NSString* prefix = [OxfordTypeaheadIndex normalize:text];
+    NSMutableDictionary* found = [[NSMutableDictionary alloc] init];
+    OxfordCompactTrie* current;
+    @synchronized(self) {
+        current = trie;
+    }
+
+    int32_t root = current != nil && limit > 0 ? [current find:prefix] : -1;
+    if (root >= 0) {
+        NSMutableArray* queue = [[NSMutableArray alloc] init];
+        OxfordTypeaheadStep* first = [[OxfordTypeaheadStep alloc] init];
+        first.node = root;
+        first.key = prefix;
+        first.priority = [current maxWeight:root];
+        [queue addObject:first];
+        while (queue.count > 0 && found.count < limit) {
+            OxfordTypeaheadStep* step = [queue lastObject];
+            [queue removeLastObject];
+            if (step.terminal) {
+                found[step.key] = @(step.priority);
+                continue;
+            }
+
+            NSMutableArray* next = [[NSMutableArray alloc] init];
+            if ([current weight:step.node] > 0) {
+                OxfordTypeaheadStep* end = [[OxfordTypeaheadStep alloc] init];
+                end.node = step.node;
+                end.key = step.key;
+                end.priority = [current weight:step.node];
+                end.terminal = YES;
+                [next addObject:end];
+            }
+            uint32_t edges = [current edgeCount:step.node];
+            for (uint32_t i = 0; i < edges; i++) {
+                OxfordTypeaheadStep* child = [[OxfordTypeaheadStep alloc] init];
+                child.node = [current edgeChild:step.node at:i];
+                unichar unit = [current edgeUnit:step.node at:i];
+                child.key = [step.key stringByAppendingString:[NSString stringWithCharacters:&unit length:1]];
+                child.priority = [current maxWeight:child.node];
+                [next addObject:child];
+            }
+            for (OxfordTypeaheadStep* s in next) {
+                NSUInteger index = [queue indexOfObject:s inSortedRange:NSMakeRange(0, queue.count)
+                                                options:NSBinarySearchingInsertionIndex
+                                        usingComparator:^NSComparisonResult(id a, id b) {
+                                            return OxfordCompareSteps(a, b);
+                                        }];
+                [queue insertObject:s atIndex:index];
+            }
+        }
+    }
+
+    @synchronized(self) {
+        // Pending counts only add weight, so they are merged on top of the persisted top k.
+        for (NSString* key in pending) {
+            if ([key hasPrefix:prefix]) {
+                int32_t node = current != nil ? [current find:key] : -1;
+                uint32_t base = node >= 0 ? [current weight:node] : 0;
+                found[key] = @(base + [pending[key] unsignedIntValue]);
+            }
+        }
+    }
+
+    NSArray* keys = [found keysSortedByValueUsingComparator:^NSComparisonResult(NSNumber* a, NSNumber* b) {
+        return [b compare:a];
+    }];
+    NSMutableArray* completions = [[NSMutableArray alloc] init];
+    for (NSString* key in keys) {
+        if (completions.count >= limit) {
+            break;
+        }
+        [completions addObject:@{ @"text": key, @"weight": found[key] }];
+    }
+
+    @synchronized(self) {
+        queries++;
+        queryTicks += mach_absolute_time() - start;
+    }
+    return completions;
+}
+
+static void OxfordCollectEntries(OxfordCompactTrie* trie, uint32_t node, NSMutableString* key, NSMutableDictionary* entries)
+{
+    if ([trie weight:node] > 0) {
+        entries[[key copy]] = @([trie weight:node]);
+    }
+    uint32_t edges = [trie edgeCount:node];
+    for (uint32_t i = 0; i < edges; i++) {
+        unichar unit = [trie edgeUnit:node at:i];
+        [key appendString:[NSString stringWithCharacters:&unit length:1]];
+        OxfordCollectEntries(trie, [trie edgeChild:node at:i], key, entries);
+        [key deleteCharactersInRange:NSMakeRange(key.length - 1, 1)];
+    }
+}
+
+-(void)persist
+{
+    NSDictionary* snapshot;
+    OxfordCompactTrie* current;
+    @synchronized(self) {
+        if (pending.count == 0 || persisting) {
+            return;
+        }
+        persisting = YES;
+        snapshot = [pending copy];
+        current = trie;
+    }
+
+    NSMutableDictionary* entries = [[NSMutableDictionary alloc] init];
+    if (current != nil) {
+        OxfordCollectEntries(current, 0, [[NSMutableString alloc] init], entries);
+    }
+    for (NSString* key in snapshot) {
+        entries[key] = @([entries[key] unsignedIntValue] + [snapshot[key] unsignedIntValue]);
+    }
+    if (entries.count > maxEntries) {
+        NSArray* keys = [entries keysSortedByValueUsingComparator:^NSComparisonResult(NSNumber* a, NSNumber* b) {
+            return [b compare:a];
+        }];
+        [entries removeObjectsForKeys:[keys subarrayWithRange:NSMakeRange(maxEntries, keys.count - maxEntries)]];
+    }
+
+    OxfordCompactTrie* updated = nil;
+    if ([OxfordCompactTrie writeEntries:entries toFile:path]) {
+        updated = [OxfordCompactTrie trieWithContentsOfFile:path];
+    } else {
+        NSLog(@"OxfordSR - typeahead persist failed");
+    }
+
+    @synchronized(self) {
+        if (updated != nil) {
+            trie = updated;
+            // Keep whatever was counted while the file was being written.
+            for (NSString* key in snapshot) {
+                long left = (long)[pending[key] unsignedIntValue] - (long)[snapshot[key] unsignedIntValue];
+                if (left > 0) {
+                    pending[key] = @(left);
+                } else {
+                    [pending removeObjectForKey:key];
+                }
+            }
+        }
+        persisting = NO;
+    }
+}
+
+-(NSDictionary*)toDictionary
+{
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    double tickUs = (double)timebase.numer / timebase.denom / 1000.0;
+    @synchronized(self) {
+        return @{
+            @"nodes": @(trie.nodeCount),
+            @"pending": @(pending.count),
+            @"loadUs": @((long long)(loadTicks * tickUs)),
+            @"queries": @(queries),
+            @"avgQueryUs": @(queries > 0 ? queryTicks * tickUs / queries : 0)
+        };
+    }
+}
+
+@end
@@ -0,0 +1,163 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import static org.junit.Assert.assertArrayEquals;
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+
+import java.util.Random;
+
+import org.json.JSONObject;
+import org.junit.Test;
+
+/**
+ * Noise suppression and AGC on synthetic audio, and the real-time factor of the chain.
+ * Word error rate needs the service and real recordings; the record/replay tooling covers
+ * that on a device.
+ */
+public class AudioPreprocessorTest {
+
+    static final int RATE = AudioCapture.SAMPLE_RATE;
+    static final int FRAME = AudioCapture.FRAME_SAMPLES;
+
+    static short[] noise(int length, double sigma, long seed) {
+        Random random = new Random(seed);
+        short[] samples = new short[length];
+        for (int i = 0; i < length; i++) {
+            samples[i] = (short) Math.round(random.nextGaussian() * sigma);
+        }
+        return samples;
+    }
+
+    /**
+     * Noise with half-second sweeps of "speech" every other half second, after a half second
+     * of noise alone to learn from.
+     */
+    static short[] noisySpeech(short[] noise) {
+        short[] samples = new short[noise.length];
+        int half = RATE / 2;
+        for (int i = 0; i < samples.length; i++) {
+            boolean speech = (i / half) % 2 == 1;
+            double hz = 500 + (i % half) / 16.0;
+            double s = speech ? 6000 * Math.sin(2 * Math.PI * hz * i / RATE) : 0;
+            samples[i] = (short) Math.round(s + noise[i]);
+        }
+        return samples;
+    }
+
+    static AudioPreprocessor create(String options) throws Exception {
+        AudioPreprocessor preprocessor = new AudioPreprocessor();
+        preprocessor.configure(new JSONObject(options));
+        return preprocessor;
+    }
+
+    static short[] process(AudioPreprocessor preprocessor, short[] input) {
+        short[] output = input.clone();
+        short[] frame = new short[FRAME];
+        for (int offset = 0; offset + FRAME <= output.length; offset += FRAME) {
+            System.arraycopy(output, offset, frame, 0, FRAME);
+            preprocessor.process(frame, FRAME);
+            System.arraycopy(frame, 0, output, offset, FRAME);
+        }
+        return output;
+    }
+
+    static double energy(short[] samples, int from, int to) {
+        double energy = 0;
+        for (int i = from; i < to; i++) {
+            energy += (double) samples[i] * samples[i];
+        }
+        return energy;
+    }
+
+    static double db(double ratio) {
+        return 10 * Math.log10(ratio);
+    }
+
+    @Test
+    public void disabledChainLeavesAudioAlone() throws Exception {
+        short[] input = noisySpeech(noise(RATE, 300, 1));
+        short[] output = process(create("{\"noiseSuppression\":false,\"agc\":false}"), input);
+        assertArrayEquals(input, output);
+    }
+
+    @Test
+    public void suppressesStationaryNoise() throws Exception {
+        short[] input = noise(3 * RATE, 300, 2);
+        short[] output = process(create("{\"agc\":false}"), input);
+        double reduction = db(energy(input, RATE, input.length) / energy(output, RATE, output.length));
+        assertTrue("noise reduced by " + reduction + " dB", reduction >= 6);
+    }
+
+    @Test
+    public void keepsSpeechBetweenTheNoise() throws Exception {
+        short[] input = noisySpeech(noise(3 * RATE, 300, 3));
+        short[] output = process(create("{\"agc\":false}"), input);
+        int half = RATE / 2;
+        // Skip the 10 ms of latency at the start of every segment.
+        int skip = RATE / 100;
+        double speechIn = 0, speechOut = 0;
+        for (int start = 3 * half; start < input.length; start += 2 * half) {
+            speechIn += energy(input, start + skip, start + half);
+            speechOut += energy(output, start + skip, start + half);
+        }
+        double gaps = db(energy(input, 4 * half + skip, 5 * half) / energy(output, 4 * half + skip, 5 * half));
+        assertTrue("speech kept " + speechOut / speechIn, speechOut / speechIn >= 0.8);
+        assertTrue("gaps reduced by " + gaps + " dB", gaps >= 6);
+    }
+
+    @Test
+    public void agcBringsQuietSpeechToTarget() throws Exception {
+        short[] input = new short[4 * RATE];
+        for (int i = 0; i < input.length; i++) {
+            input[i] = (short) Math.round(1000 * Math.sin(2 * Math.PI * 300 * i / RATE));
+        }
+        short[] output = process(create("{\"noiseSuppression\":false,\"agcTargetDbfs\":-20}"), input);
+        double rms = Math.sqrt(energy(output, output.length - RATE, output.length) / RATE) / 32768;
+        assertEquals(-20, 20 * Math.log10(rms), 1);
+    }
+
+    @Test
+    public void agcDoesNotAmplifySilence() throws Exception {
+        short[] input = noise(2 * RATE, 20, 4);
+        short[] output = process(create("{\"noiseSuppression\":false}"), input);
+        assertArrayEquals(input, output);
+    }
+
+    /**
+     * Prints the real-time factor of the full chain over a minute of noisy speech.
+     */
+    @Test
+    public void benchmark() throws Exception {
+        short[] input = noisySpeech(noise(60 * RATE, 300, 5));
+        AudioPreprocessor preprocessor = create("{}");
+        for (int round = 0; round < 3; round++) {
+            preprocessor.reset();
+            long start = System.nanoTime();
+            process(preprocessor, input);
+            double seconds = (System.nanoTime() - start) / 1e9;
+            double rtf = seconds / 60;
+            System.out.println(String.format("AudioPreprocessor: RTF %.4f (%.1f ms per minute of audio)",
+                    rtf, seconds * 1000));
+            assertTrue(rtf < 1);
+        }
+    }
+}
@@ -0,0 +1,188 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+
+import java.util.Random;
+
+import org.json.JSONObject;
+import org.junit.Test;
+
+/**
+ * Checks the lane-split frame statistics against a plain per-sample loop over a synthetic
+ * corpus, checks the issues each kind of bad capture raises, and times both loops.
+ */
+public class AudioQualityAnalyzerTest {
+
+    static final int FRAME = AudioCapture.FRAME_SAMPLES;
+
+    static short[] sine(int length, double amplitude, double hz, int dc) {
+        short[] samples = new short[length];
+        for (int i = 0; i < length; i++) {
+            double s = dc + amplitude * Math.sin(2 * Math.PI * hz * i / AudioCapture.SAMPLE_RATE);
+            samples[i] = (short) Math.max(-32768, Math.min(32767, Math.round(s)));
+        }
+        return samples;
+    }
+
+    static short[] noise(int length, double amplitude, long seed) {
+        Random random = new Random(seed);
+        short[] samples = new short[length];
+        for (int i = 0; i < length; i++) {
+            samples[i] = (short) Math.max(-32768, Math.min(32767, Math.round(random.nextGaussian() * amplitude)));
+        }
+        return samples;
+    }
+
+    /**
+     * The corpus: speech-like tones, hard clipping, DC, silence, noise and the extremes.
+     */
+    static short[][] corpus() {
+        short[] extremes = new short[FRAME + 3];
+        for (int i = 0; i < extremes.length; i++) {
+            extremes[i] = i % 2 == 0 ? Short.MIN_VALUE : Short.MAX_VALUE;
+        }
+        return new short[][] {
+            sine(FRAME, 3000, 220, 0),
+            sine(FRAME, 60000, 440, 0),
+            sine(FRAME, 1000, 300, 4000),
+            new short[FRAME],
+            noise(FRAME, 20, 1),
+            noise(FRAME + 1, 8000, 2),
+            noise(7, 30000, 3),
+            extremes,
+        };
+    }
+
+    /**
+     * The straightforward loop the analyzer used to run, as the reference.
+     */
+    static float[] reference(short[] frame, int length) {
+        long sum = 0;
+        long sumSquares = 0;
+        int peak = 0;
+        int clipped = 0;
+        for (int i = 0; i < length; i++) {
+            int s = frame[i];
+            int a = s < 0 ? -s : s;
+            sum += s;
+            sumSquares += s * s;
+            if (a > peak) {
+                peak = a;
+            }
+            if (a >= 32440) {
+                clipped++;
+            }
+        }
+        return new float[] {
+            peak / 32768f,
+            (float) Math.sqrt((double) sumSquares / length) / 32768f,
+            (float) clipped / length,
+            (sum / (float) length) / 32768f
+        };
+    }
+
+    @Test
+    public void frameStatisticsMatchReference() {
+        for (short[] frame : corpus()) {
+            AudioQualityAnalyzer analyzer = new AudioQualityAnalyzer();
+            analyzer.analyze(frame, frame.length);
+            float[] expected = reference(frame, frame.length);
+            assertEquals(expected[0], analyzer.m_peak, 0f);
+            assertEquals(expected[1], analyzer.m_rms, 1e-6f);
+            assertEquals(expected[2], analyzer.m_clipRatio, 0f);
+            assertEquals(expected[3], analyzer.m_dcOffset, 1e-6f);
+        }
+    }
+
+    static int run(AudioQualityAnalyzer analyzer, short[] signal) {
+        int issues = 0;
+        for (int offset = 0; offset + FRAME <= signal.length; offset += FRAME) {
+            short[] frame = new short[FRAME];
+            System.arraycopy(signal, offset, frame, 0, FRAME);
+            issues = analyzer.analyze(frame, FRAME);
+        }
+        return issues;
+    }
+
+    @Test
+    public void cleanSpeechHasNoIssues() {
+        short[] speech = sine(2 * AudioCapture.SAMPLE_RATE, 6000, 220, 0);
+        short[] quiet = noise(2 * AudioCapture.SAMPLE_RATE, 10, 4);
+        AudioQualityAnalyzer analyzer = new AudioQualityAnalyzer();
+        run(analyzer, quiet);
+        assertEquals(0, run(analyzer, speech));
+    }
+
+    @Test
+    public void clippingIsReported() {
+        AudioQualityAnalyzer analyzer = new AudioQualityAnalyzer();
+        int issues = run(analyzer, sine(AudioCapture.SAMPLE_RATE, 60000, 440, 0));
+        assertTrue((issues & AudioQualityAnalyzer.ISSUE_CLIPPING) != 0);
+    }
+
+    @Test
+    public void dcOffsetIsReported() {
+        AudioQualityAnalyzer analyzer = new AudioQualityAnalyzer();
+        int issues = run(analyzer, sine(AudioCapture.SAMPLE_RATE, 1000, 300, 4000));
+        assertTrue((issues & AudioQualityAnalyzer.ISSUE_DC_OFFSET) != 0);
+    }
+
+    @Test
+    public void silenceAbortsUnderTheAbortPolicy() throws Exception {
+        AudioQualityAnalyzer analyzer = new AudioQualityAnalyzer();
+        analyzer.configure(new JSONObject("{\"policy\":\"abort\",\"silenceTimeoutMs\":1000,\"abortAfterMs\":500}"));
+        int issues = run(analyzer, noise(2 * AudioCapture.SAMPLE_RATE, 5, 5));
+        assertTrue((issues & AudioQualityAnalyzer.ISSUE_SILENCE) != 0);
+        assertTrue(analyzer.shouldAbort());
+    }
+
+    /**
+     * Not an assertion: prints the cost of both loops over a minute of noise, for comparing
+     * devices and JIT settings.
+     */
+    @Test
+    public void benchmark() {
+        short[] signal = noise(60 * AudioCapture.SAMPLE_RATE, 3000, 6);
+        AudioQualityAnalyzer analyzer = new AudioQualityAnalyzer();
+        short[] frame = new short[FRAME];
+        float sink = 0;
+        for (int round = 0; round < 3; round++) {
+            long start = System.nanoTime();
+            for (int offset = 0; offset + FRAME <= signal.length; offset += FRAME) {
+                System.arraycopy(signal, offset, frame, 0, FRAME);
+                analyzer.analyze(frame, FRAME);
+            }
+            long lanes = System.nanoTime() - start;
+            start = System.nanoTime();
+            for (int offset = 0; offset + FRAME <= signal.length; offset += FRAME) {
+                System.arraycopy(signal, offset, frame, 0, FRAME);
+                sink += reference(frame, FRAME)[1];
+            }
+            long scalar = System.nanoTime() - start;
+            int frames = signal.length / FRAME;
+            System.out.println(String.format("AudioQualityAnalyzer: %.0f ns/frame, reference loop %.0f ns/frame",
+                    (double) lanes / frames, (double) scalar / frames));
+        }
+        assertTrue(sink > 0);
+    }
+}
@@ -0,0 +1,184 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+import java.io.File;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.HashMap;
+import java.util.Map;
+import java.util.Random;
+
+import org.junit.Rule;
+import org.junit.Test;
+import org.junit.rules.TemporaryFolder;
+
+/**
+ * The file format against a map of the keys written, and the cost of loading and lookups.
+ */
+public class CompactTrieTest {
+
+    @Rule
+    public TemporaryFolder folder = new TemporaryFolder();
+
+    static final String ALPHABET = "abcde fg\u00e9\u65e5'";
+
+    static String randomKey(Random random, int maxLength) {
+        int length = 1 + random.nextInt(maxLength);
+        StringBuilder key = new StringBuilder(length);
+        for (int i = 0; i < length; i++) {
+            key.append(ALPHABET.charAt(random.nextInt(ALPHABET.length())));
+        }
+        return key.toString();
+    }
+
+    /**
+     * Collects every key below a node, checking the layout on the way: edges sorted, children
+     * after their parent, subtree maxima right. Returns the highest weight found.
+     */
+    static int collect(CompactTrie trie, int node, StringBuilder key, Map<String, Integer> keys) {
+        int max = trie.weight(node);
+        if (max > 0) {
+            keys.put(key.toString(), max);
+        }
+        for (int i = 0; i < trie.edgeCount(node); i++) {
+            char c = trie.edgeChar(node, i);
+            int child = trie.edgeChild(node, i);
+            assertTrue(child > node);
+            assertTrue(i == 0 || c > trie.edgeChar(node, i - 1));
+            assertEquals(child, trie.child(node, c));
+            key.append(c);
+            max = Math.max(max, collect(trie, child, key, keys));
+            key.setLength(key.length() - 1);
+        }
+        assertEquals(max, trie.maxWeight(node));
+        return max;
+    }
+
+    @Test
+    public void readsBackWhatWasWritten() throws Exception {
+        Random random = new Random(1);
+        int count = 5000;
+        String[] keys = new String[count];
+        int[] weights = new int[count];
+        Map<String, Integer> expected = new HashMap<String, Integer>();
+        for (int i = 0; i < count; i++) {
+            // Short keys repeat, so duplicates are covered.
+            keys[i] = randomKey(random, i % 2 == 0 ? 3 : 12);
+            weights[i] = 1 + random.nextInt(1000);
+            Integer sum = expected.get(keys[i]);
+            expected.put(keys[i], (sum != null ? sum : 0) + weights[i]);
+        }
+        File file = folder.newFile("trie");
+        CompactTrie.write(file, keys, weights);
+        CompactTrie trie = CompactTrie.load(file);
+
+        Map<String, Integer> found = new HashMap<String, Integer>();
+        collect(trie, 0, new StringBuilder(), found);
+        assertEquals(expected, found);
+        for (Map.Entry<String, Integer> entry : expected.entrySet()) {
+            assertEquals(entry.getValue().intValue(), trie.weight(trie.find(entry.getKey())));
+        }
+        assertEquals(-1, trie.find("zzz"));
+        assertEquals(-1, trie.child(0, 'z'));
+        assertEquals(trie.getNodeCount() - 1, trie.getEdgeCount());
+    }
+
+    @Test
+    public void emptyTrieHasARoot() throws Exception {
+        File file = folder.newFile("empty");
+        CompactTrie.write(file, new String[0], new int[0]);
+        CompactTrie trie = CompactTrie.load(file);
+        assertEquals(1, trie.getNodeCount());
+        assertEquals(0, trie.find(""));
+        assertEquals(0, trie.weight(0));
+        assertEquals(-1, trie.find("a"));
+    }
+
+    @Test
+    public void rewritingLeavesTheMappedTrieAlone() throws Exception {
+        File file = folder.newFile("swap");
+        CompactTrie.write(file, new String[] { "old" }, new int[] { 1 });
+        CompactTrie old = CompactTrie.load(file);
+        CompactTrie.write(file, new String[] { "new", "newer" }, new int[] { 2, 3 });
+        CompactTrie updated = CompactTrie.load(file);
+        assertEquals(1, old.weight(old.find("old")));
+        assertEquals(-1, old.find("new"));
+        assertEquals(3, updated.weight(updated.find("newer")));
+        assertEquals(-1, updated.find("old"));
+    }
+
+    @Test
+    public void rejectsOtherFiles() {
+        ByteBuffer header = ByteBuffer.allocate(CompactTrie.HEADER_SIZE).order(ByteOrder.LITTLE_ENDIAN);
+        header.putInt(CompactTrie.MAGIC).putInt(CompactTrie.VERSION).putInt(10).putInt(9);
+        ByteBuffer[] invalid = {
+            ByteBuffer.allocate(4),
+            ByteBuffer.wrap("not a trie at all".getBytes()),
+            header,
+        };
+        for (ByteBuffer map : invalid) {
+            map.clear();
+            try {
+                new CompactTrie(map);
+                fail("accepted " + map);
+            } catch (IOException e) {
+                // expected
+            }
+        }
+    }
+
+    /**
+     * Prints the cost of writing, mapping and walking a 50000 phrase vocabulary.
+     */
+    @Test
+    public void benchmark() throws Exception {
+        Random random = new Random(2);
+        int count = 50000;
+        String[] keys = new String[count];
+        int[] weights = new int[count];
+        for (int i = 0; i < count; i++) {
+            keys[i] = randomKey(random, 24);
+            weights[i] = 1 + random.nextInt(100);
+        }
+        File file = folder.newFile("bench");
+        for (int round = 0; round < 3; round++) {
+            long start = System.nanoTime();
+            CompactTrie.write(file, keys, weights);
+            long written = System.nanoTime();
+            CompactTrie trie = CompactTrie.load(file);
+            long loaded = System.nanoTime();
+            int hits = 0;
+            for (String key : keys) {
+                hits += trie.find(key) >= 0 ? 1 : 0;
+            }
+            long found = System.nanoTime();
+            assertEquals(count, hits);
+            System.out.println(String.format("CompactTrie: %d keys, %d nodes, %d KB: write %.1f ms, load %.1f us, "
+                    + "find %.2f us", count, trie.getNodeCount(), file.length() / 1024, (written - start) / 1e6,
+                    (loaded - written) / 1e3, (found - loaded) / 1e3 / count));
+        }
+    }
+}
@@ -0,0 +1,95 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import static org.junit.Assert.assertEquals;
+
+import java.util.Random;
+
+import org.junit.Test;
+
+public class FftTest {
+
+    static float[] random(int size, long seed) {
+        Random random = new Random(seed);
+        float[] values = new float[size];
+        for (int i = 0; i < size; i++) {
+            values[i] = random.nextFloat() * 2 - 1;
+        }
+        return values;
+    }
+
+    @Test
+    public void matchesDirectDft() {
+        int n = 64;
+        float[] re = random(n, 1);
+        float[] im = random(n, 2);
+        double[] expectedRe = new double[n];
+        double[] expectedIm = new double[n];
+        for (int k = 0; k < n; k++) {
+            for (int t = 0; t < n; t++) {
+                double angle = -2 * Math.PI * k * t / n;
+                expectedRe[k] += re[t] * Math.cos(angle) - im[t] * Math.sin(angle);
+                expectedIm[k] += re[t] * Math.sin(angle) + im[t] * Math.cos(angle);
+            }
+        }
+        new Fft(n).transform(re, im, false);
+        for (int k = 0; k < n; k++) {
+            assertEquals(expectedRe[k], re[k], 1e-3);
+            assertEquals(expectedIm[k], im[k], 1e-3);
+        }
+    }
+
+    @Test
+    public void inverseRestoresInput() {
+        int n = 512;
+        float[] re = random(n, 3);
+        float[] im = random(n, 4);
+        float[] re0 = re.clone();
+        float[] im0 = im.clone();
+        Fft fft = new Fft(n);
+        fft.transform(re, im, false);
+        fft.transform(re, im, true);
+        for (int i = 0; i < n; i++) {
+            assertEquals(re0[i], re[i], 1e-5);
+            assertEquals(im0[i], im[i], 1e-5);
+        }
+    }
+
+    @Test
+    public void sineLandsInItsBin() {
+        int n = 512;
+        float[] re = new float[n];
+        float[] im = new float[n];
+        for (int i = 0; i < n; i++) {
+            re[i] = (float) Math.cos(2 * Math.PI * 20 * i / n);
+        }
+        new Fft(n).transform(re, im, false);
+        for (int k = 0; k <= n / 2; k++) {
+            double magnitude = Math.hypot(re[k], im[k]);
+            assertEquals(k == 20 ? n / 2.0 : 0.0, magnitude, 1e-2);
+        }
+    }
+
+    @Test(expected = IllegalArgumentException.class)
+    public void rejectsOtherSizes() {
+        new Fft(320);
+    }
+}
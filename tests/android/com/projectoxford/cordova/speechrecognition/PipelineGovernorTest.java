@@ -0,0 +1,203 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+
+import org.json.JSONArray;
+import org.json.JSONObject;
+import org.junit.Test;
+
+import android.os.SystemClock;
+
+/**
+ * Profile selection over device states, including a simulated day of sessions, and the
+ * partial rate limit.
+ */
+public class PipelineGovernorTest {
+
+    static PipelineGovernor.DeviceState state(float battery, boolean charging, boolean powerSave, int thermal,
+            String network) {
+        PipelineGovernor.DeviceState state = new PipelineGovernor.DeviceState();
+        state.battery = battery;
+        state.charging = charging;
+        state.powerSave = powerSave;
+        state.thermal = thermal;
+        state.network = network;
+        return state;
+    }
+
+    static PipelineGovernor create(String options) throws Exception {
+        PipelineGovernor governor = new PipelineGovernor();
+        governor.configure(new JSONObject(options));
+        return governor;
+    }
+
+    static void assertSelects(PipelineGovernor governor, PipelineGovernor.DeviceState state, String profile,
+            String reason) throws Exception {
+        assertEquals(profile, governor.select(state).name);
+        assertEquals(reason, governor.toJSON().getString("reason"));
+    }
+
+    @Test
+    public void picksTheMostConstrainedProfile() throws Exception {
+        PipelineGovernor governor = create("{}");
+        int nominal = PipelineGovernor.THERMAL_NOMINAL;
+        assertSelects(governor, state(0.9f, false, false, nominal, "wifi"), "full", "nominal");
+        assertSelects(governor, state(0.1f, true, false, nominal, "wifi"), "full", "charging");
+        assertSelects(governor, state(-1, false, false, nominal, "unknown"), "full", "nominal");
+        assertSelects(governor, state(0.9f, false, false, nominal, "cellular"), "balanced", "cellular");
+        assertSelects(governor, state(0.4f, false, false, nominal, "wifi"), "balanced", "battery");
+        assertSelects(governor, state(0.9f, false, false, PipelineGovernor.THERMAL_FAIR, "wifi"), "balanced", "thermal");
+        assertSelects(governor, state(0.15f, false, false, nominal, "wifi"), "saver", "battery");
+        assertSelects(governor, state(0.9f, true, true, nominal, "wifi"), "saver", "powerSave");
+        assertSelects(governor, state(0.9f, true, false, PipelineGovernor.THERMAL_SERIOUS, "wifi"), "saver", "thermal");
+        assertSelects(governor, state(0.9f, true, false, PipelineGovernor.THERMAL_CRITICAL, "wifi"), "saver", "thermal");
+    }
+
+    @Test
+    public void optionsOverrideThePolicy() throws Exception {
+        PipelineGovernor fixed = create("{\"profile\":\"saver\"}");
+        assertSelects(fixed, state(1, true, false, PipelineGovernor.THERMAL_NOMINAL, "wifi"), "saver", "fixed");
+
+        PipelineGovernor unknown = create("{\"profile\":\"turbo\"}");
+        assertSelects(unknown, state(1, true, false, PipelineGovernor.THERMAL_NOMINAL, "wifi"), "full", "charging");
+
+        PipelineGovernor thresholds = create("{\"lowBattery\":0.3,\"mediumBattery\":0.6,"
+                + "\"profiles\":{\"balanced\":{\"vad\":\"off\",\"partialIntervalMs\":500}}}");
+        assertSelects(thresholds, state(0.25f, false, false, PipelineGovernor.THERMAL_NOMINAL, "wifi"), "saver", "battery");
+        PipelineGovernor.Profile balanced = thresholds.select(state(0.55f, false, false, PipelineGovernor.THERMAL_NOMINAL, "wifi"));
+        assertEquals("balanced", balanced.name);
+        assertEquals(500, balanced.partialIntervalMs);
+        assertTrue(Float.isNaN(balanced.getGateDbfs()));
+        assertEquals(100, balanced.sendIntervalMs);
+    }
+
+    @Test
+    public void gateFollowsTheVadSetting() throws Exception {
+        PipelineGovernor governor = create("{}");
+        PipelineGovernor.Profile full = governor.select(state(1, true, false, PipelineGovernor.THERMAL_NOMINAL, "wifi"));
+        assertTrue(Float.isNaN(full.getGateDbfs()));
+        PipelineGovernor.Profile balanced = governor.select(state(1, false, false, PipelineGovernor.THERMAL_NOMINAL, "cellular"));
+        assertEquals(-50f, balanced.getGateDbfs(), 0);
+        assertEquals(300, balanced.getPreRollMs());
+        PipelineGovernor.Profile saver = governor.select(state(1, false, true, PipelineGovernor.THERMAL_NOMINAL, "wifi"));
+        assertEquals(-40f, saver.getGateDbfs(), 0);
+        assertEquals(200, saver.getPreRollMs());
+        assertTrue(!saver.preprocessing);
+    }
+
+    /**
+     * Partials arriving every 100 ms for 10 s are thinned to the profile's interval.
+     */
+    @Test
+    public void limitsThePartialRate() throws Exception {
+        String[] networks = { "wifi", "cellular", "wifi" };
+        boolean[] powerSave = { false, false, true };
+        int[] delivered = { 100, 34, 10 };
+        PipelineGovernor governor = create("{}");
+        for (int i = 0; i < networks.length; i++) {
+            PipelineGovernor.Profile profile = governor.select(state(1, true, powerSave[i],
+                    PipelineGovernor.THERMAL_NOMINAL, networks[i]));
+            int allowed = 0;
+            for (int partial = 0; partial < 100; partial++) {
+                allowed += governor.allowPartial() ? 1 : 0;
+                SystemClock.advance(100);
+            }
+            assertEquals(profile.name, delivered[i], allowed);
+            assertEquals(100 - delivered[i], profile.partialsDropped);
+        }
+    }
+
+    /**
+     * A day of sessions every five minutes: the battery drains and recharges, the phone heats
+     * up in the afternoon and leaves wifi for the commute. Every choice must match the policy,
+     * and every change, and only a change, must be logged.
+     */
+    @Test
+    public void simulatesADay() throws Exception {
+        PipelineGovernor governor = create("{}");
+        float battery = 1;
+        String previous = null;
+        int changes = 0;
+        int[] sessions = new int[3];
+        String[] names = { "full", "balanced", "saver" };
+        for (int minute = 0; minute < 24 * 60; minute += 5) {
+            int hour = minute / 60;
+            boolean charging = hour >= 22 || hour < 7;
+            battery = Math.max(0, Math.min(1, battery + (charging ? 0.02f : -0.006f)));
+            boolean powerSave = !charging && battery < 0.1f;
+            int thermal = hour >= 14 && hour < 16 ? (hour == 14 ? PipelineGovernor.THERMAL_FAIR : PipelineGovernor.THERMAL_SERIOUS)
+                    : PipelineGovernor.THERMAL_NOMINAL;
+            String network = (hour >= 8 && hour < 9) || (hour >= 18 && hour < 19) ? "cellular" : "wifi";
+
+            String expected = thermal >= PipelineGovernor.THERMAL_SERIOUS || powerSave || (!charging && battery <= 0.2f)
+                    ? "saver"
+                    : thermal == PipelineGovernor.THERMAL_FAIR || (!charging && battery <= 0.5f) || network.equals("cellular")
+                    ? "balanced" : "full";
+            String chosen = governor.select(state(battery, charging, powerSave, thermal, network)).name;
+            assertEquals("at " + hour + ":" + (minute % 60), expected, chosen);
+            if (!chosen.equals(previous)) {
+                changes++;
+            }
+            previous = chosen;
+            for (int p = 0; p < names.length; p++) {
+                sessions[p] += names[p].equals(chosen) ? 1 : 0;
+            }
+        }
+
+        JSONObject metrics = governor.toJSON();
+        assertEquals(changes, metrics.getLong("switchCount"));
+        JSONArray switches = metrics.getJSONArray("switches");
+        assertEquals(Math.min(changes, 50), switches.length());
+        assertEquals(previous, switches.getJSONObject(switches.length() - 1).getString("to"));
+        for (int p = 0; p < names.length; p++) {
+            assertEquals(sessions[p], metrics.getJSONObject("profiles").getJSONObject(names[p]).getLong("sessions"));
+        }
+        assertTrue(sessions[0] > 0 && sessions[1] > 0 && sessions[2] > 0);
+        System.out.println(String.format("PipelineGovernor: %d sessions, %d switches, full %d, balanced %d, saver %d",
+                24 * 12, changes, sessions[0], sessions[1], sessions[2]));
+    }
+
+    @Test
+    public void benchmark() throws Exception {
+        PipelineGovernor governor = create("{}");
+        PipelineGovernor.DeviceState[] states = {
+            state(0.9f, false, false, PipelineGovernor.THERMAL_NOMINAL, "wifi"),
+            state(0.4f, false, false, PipelineGovernor.THERMAL_NOMINAL, "wifi"),
+            state(0.1f, false, false, PipelineGovernor.THERMAL_NOMINAL, "wifi"),
+        };
+        int rounds = 100000;
+        long start = System.nanoTime();
+        for (int i = 0; i < rounds; i++) {
+            governor.select(states[i / 1000 % states.length]);
+        }
+        long selectNs = System.nanoTime() - start;
+        start = System.nanoTime();
+        for (int i = 0; i < rounds; i++) {
+            governor.allowPartial();
+        }
+        long partialNs = System.nanoTime() - start;
+        assertEquals(rounds / 1000, governor.toJSON().getLong("switchCount"));
+        System.out.println(String.format("PipelineGovernor: select %.2f us, allowPartial %.3f us",
+                selectNs / 1000.0 / rounds, partialNs / 1000.0 / rounds));
+    }
+}
@@ -0,0 +1,201 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertFalse;
+import static org.junit.Assert.assertTrue;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Random;
+
+import org.json.JSONObject;
+import org.junit.Test;
+
+/**
+ * The piece table against a plain list of strings, and the cost of a long dictation.
+ */
+public class TranscriptTest {
+
+    static final String[] WORDS = { "the", "quick", "brown", "fox", "jumps", "over", "a", "lazy",
+        "dog", "na\u00efve", "caf\u00e9", "\u65e5\u672c\u8a9e", "ok" };
+
+    static String sentence(Random random, int words) {
+        StringBuilder text = new StringBuilder();
+        for (int i = 0; i < words; i++) {
+            if (i > 0) {
+                text.append(' ');
+            }
+            text.append(WORDS[random.nextInt(WORDS.length)]);
+        }
+        return text.toString();
+    }
+
+    static String render(List<String> segments, String tail) {
+        StringBuilder text = new StringBuilder();
+        for (String segment : segments) {
+            if (text.length() > 0) {
+                text.append(' ');
+            }
+            text.append(segment);
+        }
+        if (tail.length() > 0) {
+            if (text.length() > 0) {
+                text.append(' ');
+            }
+            text.append(tail);
+        }
+        return text.toString();
+    }
+
+    @Test
+    public void emptyResultsAreNotSegments() {
+        Transcript transcript = new Transcript();
+        transcript.setTail("hello");
+        assertEquals(-1, transcript.append(""));
+        assertEquals(-1, transcript.append(null));
+        assertEquals(0, transcript.getSegmentCount());
+        assertEquals("", transcript.getText());
+    }
+
+    @Test
+    public void tailFollowsTheSegments() {
+        Transcript transcript = new Transcript();
+        transcript.setTail("hel");
+        assertEquals("hel", transcript.getText());
+        assertEquals(0, transcript.append("hello world"));
+        transcript.setTail("how a");
+        assertEquals("hello world how a", transcript.getText());
+        assertEquals(1, transcript.append("how are you"));
+        assertEquals("hello world how are you", transcript.getText());
+        assertTrue(transcript.replace(0, "Hello, world."));
+        assertEquals("Hello, world. how are you", transcript.getText());
+        assertEquals("world. how", transcript.getText(7, 17));
+        assertFalse(transcript.replace(2, "nothing"));
+        assertFalse(transcript.replace(0, ""));
+    }
+
+    @Test
+    public void matchesAListOfStrings() {
+        Random random = new Random(1);
+        Transcript transcript = new Transcript();
+        List<String> segments = new ArrayList<String>();
+        String tail = "";
+        // Past the initial capacity, so growing is covered too.
+        for (int step = 0; step < 2000; step++) {
+            int op = random.nextInt(10);
+            if (op < 4) {
+                String text = random.nextInt(8) == 0 ? "" : sentence(random, 1 + random.nextInt(6));
+                int id = transcript.append(text);
+                tail = "";
+                if (text.length() > 0) {
+                    assertEquals(segments.size(), id);
+                    segments.add(text);
+                } else {
+                    assertEquals(-1, id);
+                }
+            } else if (op < 6 && !segments.isEmpty()) {
+                int id = random.nextInt(segments.size());
+                String text = sentence(random, 1 + random.nextInt(6));
+                assertTrue(transcript.replace(id, text));
+                segments.set(id, text);
+            } else if (op < 8) {
+                tail = random.nextInt(4) == 0 ? "" : sentence(random, 1 + random.nextInt(3));
+                transcript.setTail(tail);
+            }
+
+            String expected = render(segments, tail);
+            assertEquals(expected.length(), transcript.length());
+            assertEquals(segments.size(), transcript.getSegmentCount());
+            for (int query = 0; query < 5; query++) {
+                int start = random.nextInt(expected.length() + 10) - 5;
+                int end = start + random.nextInt(40);
+                String range = expected.substring(Math.max(0, Math.min(start, expected.length())),
+                        Math.max(0, Math.min(end, expected.length())));
+                assertEquals("range " + start + "-" + end + " at step " + step, start < end ? range : "",
+                        transcript.getText(start, end));
+            }
+        }
+        assertEquals(render(segments, tail), transcript.getText());
+        transcript.reset();
+        assertEquals(0, transcript.length());
+        assertEquals(0, transcript.append("again"));
+        assertEquals("again", transcript.getText());
+    }
+
+    @Test
+    public void editsCarryTheirId() throws Exception {
+        JSONObject insert = Transcript.edit(Transcript.OP_INSERT, 3, "text");
+        assertEquals("insert", insert.getString("op"));
+        assertEquals(3, insert.getInt("id"));
+        assertEquals("text", insert.getString("text"));
+        JSONObject tail = Transcript.edit(Transcript.OP_TAIL, -1, null);
+        assertFalse(tail.has("id"));
+        assertEquals("", tail.getString("text"));
+    }
+
+    /**
+     * Two hours of dictation, a final every three seconds with partials in between: prints the
+     * cost of the updates and of reading the last screenful, against rebuilding the string.
+     */
+    @Test
+    public void benchmark() {
+        int finals = 2 * 60 * 20;
+        Random random = new Random(2);
+        String[] texts = new String[finals];
+        for (int i = 0; i < finals; i++) {
+            texts[i] = sentence(random, 6 + random.nextInt(6));
+        }
+        for (int round = 0; round < 3; round++) {
+            Transcript transcript = new Transcript();
+            long updates = 0;
+            long reads = 0;
+            long start;
+            for (int i = 0; i < finals; i++) {
+                start = System.nanoTime();
+                for (int partial = 1; partial <= 4; partial++) {
+                    transcript.setTail(texts[i].substring(0, texts[i].length() * partial / 5));
+                }
+                transcript.append(texts[i]);
+                if (i % 10 == 0) {
+                    transcript.replace(random.nextInt(i + 1), texts[random.nextInt(finals)]);
+                }
+                updates += System.nanoTime() - start;
+                start = System.nanoTime();
+                int length = transcript.length();
+                transcript.getText(length - 500, length);
+                reads += System.nanoTime() - start;
+            }
+
+            start = System.nanoTime();
+            StringBuilder naive = new StringBuilder();
+            for (int i = 0; i < finals; i++) {
+                naive.append(' ').append(texts[i]);
+                naive.toString();
+            }
+            long rebuilds = System.nanoTime() - start;
+
+            System.out.println(String.format("Transcript: %d finals, %d chars: update %.1f us, last 500 chars %.1f us, "
+                    + "rebuilding the string %.1f us per final", finals, transcript.length(),
+                    updates / 1e3 / finals, reads / 1e3 / finals, rebuilds / 1e3 / finals));
+        }
+    }
+}
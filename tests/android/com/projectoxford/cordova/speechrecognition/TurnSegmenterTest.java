@@ -0,0 +1,177 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertTrue;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Random;
+
+import org.json.JSONObject;
+import org.junit.Test;
+
+/**
+ * Speaker changes in synthetic dictation: two voices that differ in pitch and formants,
+ * spoken as 200 ms syllables cycling through three vowels.
+ */
+public class TurnSegmenterTest {
+
+    static final int RATE = AudioCapture.SAMPLE_RATE;
+    static final int FRAME = AudioCapture.FRAME_SAMPLES;
+    static final int SYLLABLE = RATE / 5;
+    static final int VOICED = SYLLABLE * 7 / 8;
+    static final int RAMP = FRAME;
+
+    // Pitch, then the first and second formant of each vowel.
+    static final double[][][] VOICES = {
+        { { 110 }, { 500, 700, 400 }, { 1000, 1100, 900 } },
+        { { 230 }, { 900, 1000, 800 }, { 2800, 3000, 2600 } },
+    };
+
+    /**
+     * Appends seconds of the given voice, or of near silence for -1.
+     */
+    static void speak(List<Short> out, int voice, int seconds, Random random) {
+        int length = seconds * RATE;
+        for (int syllable = 0; syllable * SYLLABLE < length; syllable++) {
+            double[] harmonics = new double[0];
+            double[] gains = new double[0];
+            double amplitude = 0;
+            if (voice >= 0) {
+                double[][] v = VOICES[voice];
+                double f0 = v[0][0] * (0.95 + 0.1 * random.nextDouble());
+                double f1 = v[1][syllable % 3];
+                double f2 = v[2][syllable % 3];
+                int count = (int) (7000 / f0);
+                harmonics = new double[count];
+                gains = new double[count];
+                for (int h = 0; h < count; h++) {
+                    double hz = (h + 1) * f0;
+                    double g = 0.05 + 1 / (1 + Math.pow((hz - f1) / 120, 2)) + 1 / (1 + Math.pow((hz - f2) / 120, 2));
+                    harmonics[h] = hz;
+                    gains[h] = g / Math.sqrt(h + 1);
+                }
+                amplitude = 4000 * (0.8 + 0.4 * random.nextDouble());
+            }
+            for (int i = 0; i < SYLLABLE && syllable * SYLLABLE + i < length; i++) {
+                double envelope = i < VOICED ? Math.min(1, Math.min((double) i / RAMP, (double) (VOICED - i) / RAMP)) : 0;
+                double s = 0;
+                for (int h = 0; h < harmonics.length; h++) {
+                    s += gains[h] * Math.sin(2 * Math.PI * harmonics[h] * i / RATE + syllable * harmonics[h]);
+                }
+                out.add((short) Math.round(amplitude * envelope * s / 3 + (random.nextDouble() - 0.5) * 40));
+            }
+        }
+    }
+
+    /**
+     * Speaks the plan, pairs of voice and seconds, and returns the turns detected.
+     */
+    static List<TurnSegmenter.Turn> run(TurnSegmenter segmenter, int[][] plan, long seed) {
+        Random random = new Random(seed);
+        List<Short> samples = new ArrayList<Short>();
+        for (int[] part : plan) {
+            speak(samples, part[0], part[1], random);
+        }
+        List<TurnSegmenter.Turn> turns = new ArrayList<TurnSegmenter.Turn>();
+        short[] frame = new short[FRAME];
+        for (int offset = 0; offset + FRAME <= samples.size(); offset += FRAME) {
+            for (int i = 0; i < FRAME; i++) {
+                frame[i] = samples.get(offset + i);
+            }
+            TurnSegmenter.Turn turn = segmenter.process(frame, FRAME);
+            if (turn != null) {
+                turns.add(turn);
+            }
+        }
+        return turns;
+    }
+
+    @Test
+    public void detectsChangesAndKnowsSpeakersAgain() throws Exception {
+        for (long seed = 1; seed <= 3; seed++) {
+            TurnSegmenter segmenter = new TurnSegmenter();
+            List<TurnSegmenter.Turn> turns = run(segmenter, new int[][] { { 0, 6 }, { 1, 6 }, { 0, 6 } }, seed);
+            assertEquals("turns for seed " + seed, 2, turns.size());
+            assertEquals(1, turns.get(0).speaker);
+            assertEquals(0, turns.get(1).speaker);
+            // Within half a window of the true change.
+            assertEquals(6 * RATE, turns.get(0).startSample, RATE / 2);
+            assertEquals(12 * RATE, turns.get(1).startSample, RATE / 2);
+            assertEquals(2, segmenter.getCurrentTurn().id);
+            assertEquals(1, segmenter.turnAt(9 * RATE).id);
+            assertEquals(0, segmenter.turnAt(RATE).id);
+        }
+    }
+
+    @Test
+    public void oneSpeakerIsOneTurn() throws Exception {
+        for (int voice = 0; voice < VOICES.length; voice++) {
+            List<TurnSegmenter.Turn> turns = run(new TurnSegmenter(), new int[][] { { voice, 18 } }, voice);
+            assertEquals("turns for voice " + voice, 0, turns.size());
+        }
+    }
+
+    @Test
+    public void pausesAreNotChanges() throws Exception {
+        List<TurnSegmenter.Turn> turns = run(new TurnSegmenter(), new int[][] { { 0, 6 }, { -1, 3 }, { 0, 6 } }, 4);
+        assertEquals(0, turns.size());
+    }
+
+    @Test
+    public void skipsChangesWithinMinTurn() throws Exception {
+        TurnSegmenter segmenter = new TurnSegmenter();
+        segmenter.configure(new JSONObject("{\"minTurnMs\":7000}"));
+        List<TurnSegmenter.Turn> turns = run(segmenter, new int[][] { { 0, 6 }, { 1, 6 }, { 0, 6 } }, 5);
+        assertEquals(1, turns.size());
+        assertEquals(12 * RATE, turns.get(0).startSample, RATE / 2);
+    }
+
+    /**
+     * Prints the cost of a frame; the detector runs on the capture thread.
+     */
+    @Test
+    public void benchmark() throws Exception {
+        Random random = new Random(6);
+        List<Short> samples = new ArrayList<Short>();
+        speak(samples, 0, 30, random);
+        speak(samples, 1, 30, random);
+        short[][] frames = new short[samples.size() / FRAME][FRAME];
+        for (int f = 0; f < frames.length; f++) {
+            for (int i = 0; i < FRAME; i++) {
+                frames[f][i] = samples.get(f * FRAME + i);
+            }
+        }
+        TurnSegmenter segmenter = new TurnSegmenter();
+        for (int round = 0; round < 3; round++) {
+            segmenter.reset();
+            long start = System.nanoTime();
+            for (short[] frame : frames) {
+                segmenter.process(frame, FRAME);
+            }
+            double nsPerFrame = (double) (System.nanoTime() - start) / frames.length;
+            System.out.println(String.format("TurnSegmenter: %.0f ns/frame, RTF %.4f",
+                    nsPerFrame, nsPerFrame / (FRAME * 1e9 / RATE)));
+            assertTrue(nsPerFrame < FRAME * 1e9 / RATE);
+        }
+    }
+}
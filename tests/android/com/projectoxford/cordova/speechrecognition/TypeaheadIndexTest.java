@@ -0,0 +1,205 @@
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+package com.projectoxford.cordova.speechrecognition;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertFalse;
+import static org.junit.Assert.assertTrue;
+
+import java.io.File;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.Random;
+
+import org.json.JSONObject;
+import org.junit.Rule;
+import org.junit.Test;
+import org.junit.rules.TemporaryFolder;
+
+/**
+ * Completions against a brute-force count of the phrases added, across persists, and the
+ * latency of a query.
+ */
+public class TypeaheadIndexTest {
+
+    @Rule
+    public TemporaryFolder folder = new TemporaryFolder();
+
+    static final String[] WORDS = { "call", "cancel", "can", "check", "the", "pump", "station",
+        "meeting", "tomorrow", "at", "ten", "two", "send", "set", "a", "reminder" };
+
+    static String phrase(Random random) {
+        StringBuilder text = new StringBuilder();
+        int words = 1 + random.nextInt(4);
+        for (int i = 0; i < words; i++) {
+            if (i > 0) {
+                text.append(' ');
+            }
+            text.append(WORDS[random.nextInt(WORDS.length)]);
+        }
+        return text.toString();
+    }
+
+    TypeaheadIndex create(String options) throws Exception {
+        TypeaheadIndex index = new TypeaheadIndex(new File(folder.getRoot(), "typeahead"));
+        index.configure(new JSONObject(options));
+        return index;
+    }
+
+    /**
+     * The completions must carry the true count of their phrase and be the highest counts
+     * for the prefix; phrases with equal counts may come in any order.
+     */
+    static void assertTopCompletions(Map<String, Integer> counts, String prefix, int limit,
+            List<TypeaheadIndex.Completion> completions) {
+        List<Integer> best = new ArrayList<Integer>();
+        for (Map.Entry<String, Integer> entry : counts.entrySet()) {
+            if (entry.getKey().startsWith(prefix)) {
+                best.add(entry.getValue());
+            }
+        }
+        Collections.sort(best, Collections.reverseOrder());
+        best = best.subList(0, Math.min(limit, best.size()));
+
+        List<Integer> weights = new ArrayList<Integer>();
+        for (TypeaheadIndex.Completion completion : completions) {
+            assertTrue(completion.text.startsWith(prefix));
+            assertEquals(completion.text, counts.get(completion.text).intValue(), completion.weight);
+            weights.add(completion.weight);
+        }
+        assertEquals("completions of '" + prefix + "'", best, weights);
+    }
+
+    @Test
+    public void normalizesCaseAndPunctuation() {
+        assertEquals("hello world", TypeaheadIndex.normalize("  Hello,   World! "));
+        assertEquals("don't stop", TypeaheadIndex.normalize("Don't stop."));
+        assertEquals("4th st", TypeaheadIndex.normalize("4th St."));
+        assertEquals("", TypeaheadIndex.normalize(null));
+    }
+
+    @Test
+    public void matchesBruteForceAcrossPersists() throws Exception {
+        Random random = new Random(1);
+        TypeaheadIndex index = create("{\"persistAfter\":1000000}");
+        Map<String, Integer> counts = new HashMap<String, Integer>();
+        String[] prefixes = { "", "c", "ca", "can", "cancel t", "s", "set a", "x" };
+        for (int round = 0; round < 6; round++) {
+            for (int i = 0; i < 400; i++) {
+                String text = phrase(random);
+                int weight = 1 + random.nextInt(3);
+                index.add(text, weight);
+                Integer count = counts.get(text);
+                counts.put(text, (count != null ? count : 0) + weight);
+            }
+            // Every other round is queried with phrases still pending on top of the file.
+            if (round % 2 == 0) {
+                index.persist();
+                index.load();
+            }
+            for (String prefix : prefixes) {
+                assertTopCompletions(counts, prefix, 5, index.query(prefix, 5));
+            }
+        }
+        // A reloaded index only has what was persisted.
+        index.persist();
+        TypeaheadIndex reloaded = create("{}");
+        reloaded.load();
+        for (String prefix : prefixes) {
+            assertTopCompletions(counts, prefix, 3, reloaded.query(prefix, 3));
+        }
+    }
+
+    @Test
+    public void persistKeepsTheMostFrequent() throws Exception {
+        TypeaheadIndex index = create("{\"maxEntries\":2}");
+        index.add("rare", 1);
+        index.add("common", 5);
+        index.add("frequent", 9);
+        index.persist();
+        TypeaheadIndex reloaded = create("{}");
+        reloaded.load();
+        List<TypeaheadIndex.Completion> all = reloaded.query("", 10);
+        assertEquals(2, all.size());
+        assertEquals("frequent", all.get(0).text);
+        assertEquals("common", all.get(1).text);
+    }
+
+    @Test
+    public void asksForAPersistOnceEnoughIsPending() throws Exception {
+        TypeaheadIndex index = create("{\"persistAfter\":3,\"maxLength\":10}");
+        assertFalse(index.add("one", 1));
+        assertFalse(index.add("one", 1));
+        assertFalse(index.add("a phrase that is too long", 1));
+        assertFalse(index.add("two", 1));
+        assertTrue(index.add("three", 1));
+        index.persist();
+        assertFalse(index.add("four", 1));
+        assertEquals(1, index.toJSON().getInt("pending"));
+    }
+
+    /**
+     * Prints the latency of a query over 50000 persisted phrases, the per-partial cost, against
+     * scanning all of them.
+     */
+    @Test
+    public void benchmark() throws Exception {
+        Random random = new Random(2);
+        TypeaheadIndex index = create("{\"persistAfter\":1000000,\"maxEntries\":50000}");
+        List<String> phrases = new ArrayList<String>();
+        while (phrases.size() < 50000) {
+            StringBuilder text = new StringBuilder(phrase(random));
+            text.append(' ').append(random.nextInt(1000));
+            phrases.add(text.toString());
+            index.add(text.toString(), 1 + random.nextInt(50));
+        }
+        index.persist();
+        index.load();
+        String[] prefixes = { "c", "ca", "cancel", "send a", "the pump station", "meeting tomorrow at" };
+        for (int round = 0; round < 3; round++) {
+            int queries = 0;
+            long start = System.nanoTime();
+            for (int i = 0; i < 200; i++) {
+                for (String prefix : prefixes) {
+                    index.query(prefix, 5);
+                    queries++;
+                }
+            }
+            long indexed = System.nanoTime() - start;
+
+            start = System.nanoTime();
+            int matches = 0;
+            for (int i = 0; i < 20; i++) {
+                for (String prefix : prefixes) {
+                    for (String text : phrases) {
+                        matches += text.startsWith(prefix) ? 1 : 0;
+                    }
+                }
+            }
+            long scanned = System.nanoTime() - start;
+            assertTrue(matches > 0);
+            System.out.println(String.format("TypeaheadIndex: %d phrases, query %.1f us, linear scan %.1f us",
+                    phrases.size(), indexed / 1e3 / queries, scanned / 1e3 / (20 * prefixes.length)));
+        }
+    }
+}
@@ -0,0 +1,420 @@
+#!/usr/bin/env node
+/*
+Copyright (c) Microsoft Corporation
+All rights reserved.
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this
+software and associated documentation files (the "Software"), to deal in the Software
+without restriction, including without limitation the rights to use, copy, modify, merge,
+publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+to whom the Software is furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+ * Desktop tool for session recordings (.oxsr, layout in SessionRecorder.java), for offline
+ * regression runs without a device:
+ *
+ *   oxsr.js dump FILE                     list the records
+ *   oxsr.js diff EXPECTED ACTUAL          compare the final results of two recordings
+ *   oxsr.js replay FILE [--backend B] [--out FILE] [--realtime]
+ *                                         run the recorded audio through a recognizer backend,
+ *                                         optionally record that run, and diff it against FILE
+ *
+ * A backend is a module exporting createRecognizer(format, events). It returns an object with
+ * sendAudio(buffer) and endAudio(); endAudio returns a promise that settles once every result
+ * has been delivered through events.partial(text), events.final(result) and
+ * events.error(code, message). Results use the recorder's JSON: { status, phrases: [{ text,
+ * lexical, confidence }] }. The built-in "recorded" backend plays the recording's own callbacks
+ * back at the same audio positions, which makes a replay deterministic.
+ *
+ * diff and replay exit with 1 when the finals differ.
+ */
+
+var fs = require("fs");
+var path = require("path");
+
+var MAGIC = 0x5253584f; // "OXSR"
+var VERSION = 1;
+var HEADER_SIZE = 16;
+var RECORD_HEADER_SIZE = 16;
+
+var RECORD_FORMAT = 1;
+var RECORD_AUDIO = 2;
+var RECORD_END_AUDIO = 3;
+var RECORD_PARTIAL = 4;
+var RECORD_FINAL = 5;
+var RECORD_ERROR = 6;
+var RECORD_AUDIO_EVENT = 7;
+var RECORD_INTENT = 8;
+
+var TYPE_NAMES = {};
+TYPE_NAMES[RECORD_FORMAT] = "format";
+TYPE_NAMES[RECORD_AUDIO] = "audio";
+TYPE_NAMES[RECORD_END_AUDIO] = "endAudio";
+TYPE_NAMES[RECORD_PARTIAL] = "partial";
+TYPE_NAMES[RECORD_FINAL] = "final";
+TYPE_NAMES[RECORD_ERROR] = "error";
+TYPE_NAMES[RECORD_AUDIO_EVENT] = "audioEvent";
+TYPE_NAMES[RECORD_INTENT] = "intent";
+
+/**
+ * Reads a recording into { startMs, records: [{ type, timestampUs, payload }] }. A truncated
+ * tail is dropped, as the replayers do.
+ */
+function readRecording(file) {
+    var data = fs.readFileSync(file);
+    if (data.length < HEADER_SIZE || data.readUInt32LE(0) !== MAGIC) {
+        throw new Error(file + ": not a session recording");
+    }
+    if (data.readUInt32LE(4) !== VERSION) {
+        throw new Error(file + ": unsupported recording version " + data.readUInt32LE(4));
+    }
+    var recording = { startMs: readUInt64(data, 8), records: [] };
+    var position = HEADER_SIZE;
+    while (position + RECORD_HEADER_SIZE <= data.length) {
+        var type = data.readUInt32LE(position);
+        var length = data.readUInt32LE(position + 4);
+        var timestampUs = readUInt64(data, position + 8);
+        var payload = position + RECORD_HEADER_SIZE;
+        if (payload + length > data.length) {
+            break;
+        }
+        recording.records.push({ type: type, timestampUs: timestampUs, payload: data.slice(payload, payload + length) });
+        position = payload + ((length + 7) & ~7);
+    }
+    return recording;
+}
+
+function readUInt64(data, offset) {
+    return data.readUInt32LE(offset) + data.readUInt32LE(offset + 4) * 0x100000000;
+}
+
+function writeUInt64(data, offset, value) {
+    data.writeUInt32LE(value % 0x100000000, offset);
+    data.writeUInt32LE(Math.floor(value / 0x100000000), offset + 4);
+}
+
+/**
+ * Writes records in the recorder's layout, stamped with the time since it was created.
+ */
+var RecordingWriter = function(file) {
+    this._fd = fs.openSync(file, "w");
+    this._start = process.hrtime();
+    var header = Buffer.alloc(HEADER_SIZE);
+    header.writeUInt32LE(MAGIC, 0);
+    header.writeUInt32LE(VERSION, 4);
+    writeUInt64(header, 8, Date.now());
+    fs.writeSync(this._fd, header);
+};
+
+RecordingWriter.prototype.write = function(type, payload) {
+    var elapsed = process.hrtime(this._start);
+    var header = Buffer.alloc(RECORD_HEADER_SIZE);
+    header.writeUInt32LE(type, 0);
+    header.writeUInt32LE(payload.length, 4);
+    writeUInt64(header, 8, elapsed[0] * 1000000 + Math.floor(elapsed[1] / 1000));
+    fs.writeSync(this._fd, header);
+    fs.writeSync(this._fd, payload);
+    var pad = (8 - (payload.length & 7)) & 7;
+    if (pad > 0) {
+        fs.writeSync(this._fd, Buffer.alloc(pad));
+    }
+};
+
+RecordingWriter.prototype.writeText = function(type, text) {
+    this.write(type, Buffer.from(text, "utf8"));
+};
+
+RecordingWriter.prototype.close = function() {
+    fs.closeSync(this._fd);
+};
+
+function readFormat(payload) {
+    return {
+        encoding: payload.readUInt16LE(0),
+        channels: payload.readUInt16LE(2),
+        samplesPerSecond: payload.readUInt32LE(4),
+        averageBytesPerSecond: payload.readUInt32LE(8),
+        blockAlign: payload.readUInt16LE(12),
+        bitsPerSample: payload.readUInt16LE(14)
+    };
+}
+
+/**
+ * The text of a recorded final: the first phrase, or "" for NoMatch and empty results.
+ */
+function finalText(result) {
+    return result.phrases && result.phrases.length > 0 ? result.phrases[0].text || "" : "";
+}
+
+function finalsOf(recording) {
+    var finals = [];
+    recording.records.forEach(function(record) {
+        if (record.type === RECORD_FINAL) {
+            var result = JSON.parse(record.payload.toString("utf8"));
+            finals.push({ timestampUs: record.timestampUs, status: result.status, text: finalText(result) });
+        }
+    });
+    return finals;
+}
+
+function words(text) {
+    return text.toLowerCase().replace(/[^\w\s']/g, " ").split(/\s+/).filter(function(word) {
+        return word.length > 0;
+    });
+}
+
+/**
+ * Word-level edit distance between two texts.
+ */
+function wordErrors(expected, actual) {
+    var a = words(expected);
+    var b = words(actual);
+    var previous = [];
+    for (var j = 0; j <= b.length; j++) {
+        previous.push(j);
+    }
+    for (var i = 1; i <= a.length; i++) {
+        var current = [i];
+        for (j = 1; j <= b.length; j++) {
+            current.push(Math.min(previous[j] + 1, current[j - 1] + 1, previous[j - 1] + (a[i - 1] === b[j - 1] ? 0 : 1)));
+        }
+        previous = current;
+    }
+    return { errors: previous[b.length], words: a.length };
+}
+
+/**
+ * Compares the finals of two recordings in order and prints the differences. Returns whether
+ * they match.
+ */
+function diff(expected, actual) {
+    var a = finalsOf(expected);
+    var b = finalsOf(actual);
+    var same = a.length === b.length;
+    for (var i = 0; i < Math.max(a.length, b.length); i++) {
+        var x = a[i];
+        var y = b[i];
+        if (x && y && x.text === y.text && x.status === y.status) {
+            continue;
+        }
+        same = false;
+        console.log("final " + i + ":");
+        console.log("  - " + (x ? "[" + x.status + "] " + x.text : "(none)"));
+        console.log("  + " + (y ? "[" + y.status + "] " + y.text : "(none)"));
+        if (x && y) {
+            console.log("  latency " + ((y.timestampUs - x.timestampUs) / 1000).toFixed(0) + " ms");
+        }
+    }
+    var wer = wordErrors(a.map(function(f) { return f.text; }).join(" "),
+                         b.map(function(f) { return f.text; }).join(" "));
+    var partials = function(recording) {
+        return recording.records.filter(function(record) { return record.type === RECORD_PARTIAL; }).length;
+    };
+    console.log(a.length + " -> " + b.length + " finals, " + partials(expected) + " -> " + partials(actual) +
+                " partials, WER " + (wer.words > 0 ? (100 * wer.errors / wer.words).toFixed(1) : "0.0") + "% (" +
+                wer.errors + "/" + wer.words + " words)");
+    console.log(same ? "finals match" : "finals differ");
+    return same;
+}
+
+/**
+ * Plays the recording's own callbacks back, each after the audio that preceded it originally.
+ */
+function recordedBackend(recording) {
+    var schedule = [];
+    var audioBytes = 0;
+    recording.records.forEach(function(record) {
+        if (record.type === RECORD_AUDIO) {
+            audioBytes += record.payload.length;
+        } else if (record.type === RECORD_PARTIAL || record.type === RECORD_FINAL || record.type === RECORD_ERROR) {
+            schedule.push({ afterBytes: audioBytes, record: record });
+        }
+    });
+    return {
+        createRecognizer: function(format, events) {
+            var sent = 0;
+            var next = 0;
+            var deliver = function(all) {
+                while (next < schedule.length && (all || schedule[next].afterBytes <= sent)) {
+                    var record = schedule[next++].record;
+                    var text = record.payload.toString("utf8");
+                    if (record.type === RECORD_PARTIAL) {
+                        events.partial(text);
+                    } else if (record.type === RECORD_FINAL) {
+                        events.final(JSON.parse(text));
+                    } else {
+                        var space = text.indexOf(" ");
+                        events.error(parseInt(text, 10), space >= 0 ? text.substring(space + 1) : "");
+                    }
+                }
+            };
+            return {
+                sendAudio: function(buffer) {
+                    sent += buffer.length;
+                    deliver(false);
+                },
+                endAudio: function() {
+                    deliver(true);
+                    return Promise.resolve();
+                }
+            };
+        }
+    };
+}
+
+function sleep(ms) {
+    return new Promise(function(resolve) {
+        setTimeout(resolve, ms);
+    });
+}
+
+/**
+ * Sends the recorded format and audio to the backend, recording the run if asked to.
+ */
+function replay(recording, backend, out, realtime) {
+    var writer = out ? new RecordingWriter(out) : null;
+    var results = { records: [] };
+    var start = Date.now();
+    var note = function(type, text) {
+        results.records.push({ type: type, timestampUs: (Date.now() - start) * 1000, payload: Buffer.from(text, "utf8") });
+        if (writer) {
+            writer.writeText(type, text);
+        }
+    };
+    var events = {
+        partial: function(text) {
+            note(RECORD_PARTIAL, text);
+        },
+        final: function(result) {
+            note(RECORD_FINAL, JSON.stringify(result));
+        },
+        error: function(code, message) {
+            note(RECORD_ERROR, code + " " + message);
+        }
+    };
+
+    var recognizer = null;
+    var ended = false;
+    var steps = recording.records.filter(function(record) {
+        return record.type === RECORD_FORMAT || record.type === RECORD_AUDIO || record.type === RECORD_END_AUDIO;
+    });
+    var run = steps.reduce(function(previous, record) {
+        return previous.then(function() {
+            var wait = realtime ? record.timestampUs / 1000 - (Date.now() - start) : 0;
+            return wait > 0 ? sleep(wait) : null;
+        }).then(function() {
+            if (record.type === RECORD_FORMAT) {
+                recognizer = backend.createRecognizer(readFormat(record.payload), events);
+                if (writer) {
+                    writer.write(RECORD_FORMAT, record.payload);
+                }
+            } else if (record.type === RECORD_AUDIO) {
+                if (!recognizer) {
+                    throw new Error("audio before the format record");
+                }
+                recognizer.sendAudio(record.payload);
+                if (writer) {
+                    writer.write(RECORD_AUDIO, record.payload);
+                }
+            } else if (recognizer && !ended) {
+                ended = true;
+                if (writer) {
+                    writer.write(RECORD_END_AUDIO, Buffer.alloc(0));
+                }
+                return recognizer.endAudio();
+            }
+        });
+    }, Promise.resolve());
+    return run.then(function() {
+        if (recognizer && !ended) {
+            if (writer) {
+                writer.write(RECORD_END_AUDIO, Buffer.alloc(0));
+            }
+            return recognizer.endAudio();
+        }
+    }).then(function() {
+        if (writer) {
+            writer.close();
+        }
+        return results;
+    });
+}
+
+function dump(recording) {
+    console.log("started " + new Date(recording.startMs).toISOString());
+    recording.records.forEach(function(record) {
+        var time = (record.timestampUs / 1000).toFixed(1) + " ms";
+        var name = TYPE_NAMES[record.type] || "type " + record.type;
+        var detail;
+        if (record.type === RECORD_FORMAT) {
+            detail = JSON.stringify(readFormat(record.payload));
+        } else if (record.type === RECORD_AUDIO) {
+            detail = record.payload.length + " bytes";
+        } else {
+            detail = record.payload.toString("utf8");
+        }
+        console.log(time + "\t" + name + "\t" + detail);
+    });
+}
+
+function usage() {
+    console.error("usage: oxsr.js dump FILE\n" +
+                  "       oxsr.js diff EXPECTED ACTUAL\n" +
+                  "       oxsr.js replay FILE [--backend recorded|MODULE] [--out FILE] [--realtime]");
+    process.exit(2);
+}
+
+function main(args) {
+    var command = args[0];
+    if (command === "dump" && args.length === 2) {
+        dump(readRecording(args[1]));
+    } else if (command === "diff" && args.length === 3) {
+        process.exitCode = diff(readRecording(args[1]), readRecording(args[2])) ? 0 : 1;
+    } else if (command === "replay" && args.length >= 2) {
+        var recording = readRecording(args[1]);
+        var backendName = "recorded";
+        var out = null;
+        var realtime = false;
+        for (var i = 2; i < args.length; i++) {
+            if (args[i] === "--backend" && i + 1 < args.length) {
+                backendName = args[++i];
+            } else if (args[i] === "--out" && i + 1 < args.length) {
+                out = args[++i];
+            } else if (args[i] === "--realtime") {
+                realtime = true;
+            } else {
+                usage();
+            }
+        }
+        var backend = backendName === "recorded" ? recordedBackend(recording) : require(path.resolve(backendName));
+        replay(recording, backend, out, realtime).then(function(results) {
+            process.exitCode = diff(recording, results) ? 0 : 1;
+        }, function(error) {
+            console.error(error.message);
+            process.exitCode = 2;
+        });
+    } else {
+        usage();
+    }
+}
+
+module.exports = {
+    readRecording: readRecording,
+    RecordingWriter: RecordingWriter,
+    diff: diff,
+    replay: replay,
+    recordedBackend: recordedBackend
+};
+
+if (require.main === module) {
+    main(process.argv.slice(2));
+}
@@ -5,20 +5,105 @@ var OxfordSpeechRecognition = function(args) {
     var primaryKey = args.primaryKey || "yourPrimaryOrSecondaryKey";
     var luisAppID = args.luisAppID || "yourLuisAppID";
     var luisSubscriptionID = args.luisSubscriptionID || "yourLuisSubscriptionID";
+    var options = {
+        mode: args.mode,
+        audioQuality: args.audioQuality,
+        preprocessing: args.preprocessing,
+        recorder: args.recorder,
+        turns: args.turns,
+        pushQueue: args.pushQueue,
+        transcript: args.transcript,
+        retry: args.retry,
+        booster: args.booster,
+        typeahead: args.typeahead,
+        governor: args.governor
+    };
 
     this.onresult = null;
+    this.onquality = null;
+    this.onrecording = null;
+    this.onturn = null;
+    this.ondrain = null;
+    this.onedit = null;
+    this.onsuggestion = null;
+    this.oncompletions = null;
     this.onend = null;
 
+    this._pushing = false;
+    this._backpressure = false;
+    this._pushChunks = [];
+    this._pushBytes = 0;
+    this._pushTimer = null;
+
+    // Push flow control. Native replies are async, so bytes sent but not yet acknowledged are
+    // counted here too; _stateSeq is the sequence of the newest native state applied.
+    var pushQueue = args.pushQueue || {};
+    this._pushHighWater = pushQueue.highWaterBytes || 256 * 1024;
+    this._pushLowWater = pushQueue.lowWaterBytes || 64 * 1024;
+    this._pushSeq = 0;
+    this._stateSeq = 0;
+    this._pushSession = 0;
+    this._inflightBytes = 0;
+    this._nativeQueued = 0;
+    this._blocked = false;
+
     exec(function() {
         console.log("initialized");
     }, function(e) {
         console.log("error: " + e);
-    }, "OxfordSpeechRecognition", "init", [lang, primaryKey, luisAppID, luisSubscriptionID]);
+    }, "OxfordSpeechRecognition", "init", [lang, primaryKey, luisAppID, luisSubscriptionID, options]);
 };
 
-OxfordSpeechRecognition.prototype.start = function() {
+// Native session events that are not results, keyed by the event property.
+var sessionEvents = {
+    quality: "onquality",
+    recording: "onrecording",
+    turn: "onturn",
+    edit: "onedit",
+    suggestion: "onsuggestion",
+    completions: "oncompletions"
+};
+
+// Pushed chunks smaller than this are merged into one bridge call.
+var PUSH_BATCH_BYTES = 32 * 1024;
+
+OxfordSpeechRecognition.prototype._session = function(action, args) {
     var that = this;
     var successCallback = function(event) {
+        // Results may carry extra properties (e.g. turn), so check them first.
+        if (event.hasOwnProperty("result") || event.hasOwnProperty("partial")) {
+            that.onresult(event);
+            return;
+        }
+        if (event.hasOwnProperty("end")) {
+            // The service finished the session by itself (a short phrase, the end of a
+            // dictation), so the next push has to start a new one.
+            if (event.end.pushed) {
+                that._endPush();
+            }
+            if (typeof that.onend === "function") {
+                that.onend(event.end);
+            }
+            return;
+        }
+        if (event.hasOwnProperty("drain")) {
+            // A drain only counts if nothing newer has been heard about the queue.
+            if (event.drain.seq >= that._stateSeq) {
+                that._stateSeq = event.drain.seq;
+                that._backpressure = false;
+                that._nativeQueued = event.drain.queued;
+            }
+            that._checkDrain();
+            return;
+        }
+        for (var key in sessionEvents) {
+            if (event.hasOwnProperty(key)) {
+                if (typeof that[sessionEvents[key]] === "function") {
+                    that[sessionEvents[key]](event[key]);
+                }
+                return;
+            }
+        }
         that.onresult(event);
     };
     var errorCallback = function(err) {
@@ -27,14 +112,249 @@ OxfordSpeechRecognition.prototype.start = function() {
         }
     };
 
-    exec(successCallback, errorCallback, "OxfordSpeechRecognition", "start", []);
+    exec(successCallback, errorCallback, "OxfordSpeechRecognition", action, args);
+};
+
+OxfordSpeechRecognition.prototype.start = function() {
+    this._session("start", []);
+};
+
+/**
+ * Replays a session recording through the service. Results arrive through onresult.
+ * options.realtime (default true) paces the audio by the recorded timestamps; without it the
+ * gaps between recorded chunks are skipped, but the client still sends at the audio rate.
+ */
+OxfordSpeechRecognition.prototype.replay = function(path, options) {
+    this._session("replay", [path, options || {}]);
+};
+
+/**
+ * Feeds audio from the app instead of the microphone, e.g. decoded WebRTC or media player
+ * audio. The buffer holds 16 kHz mono 16-bit little endian PCM; the first push starts the
+ * session. Returns false once the audio queued natively, in flight over the bridge and
+ * waiting to be sent is over the high water mark: the chunk is still queued, but stop
+ * pushing until ondrain. Chunks that don't fit are reported to onerror as queue_full.
+ * The buffer is copied. Once the service ends the session itself (onend, e.g. after a short
+ * phrase) the next push starts a new one.
+ */
+OxfordSpeechRecognition.prototype.pushAudio = function(buffer) {
+    if (!this._pushing) {
+        this._pushing = true;
+        this._pushSession++;
+        this._backpressure = false;
+        this._blocked = false;
+        this._inflightBytes = 0;
+        this._nativeQueued = 0;
+        this._stateSeq = this._pushSeq;
+        this._session("startAudio", []);
+    }
+
+    // Batches are sent later, and the caller may reuse its buffer by then.
+    buffer = buffer.slice(0);
+    this._pushChunks.push(buffer);
+    this._pushBytes += buffer.byteLength;
+    if (this._pushBytes >= PUSH_BATCH_BYTES) {
+        this._flushAudio();
+    } else if (this._pushTimer === null) {
+        var that = this;
+        this._pushTimer = setTimeout(function() {
+            that._flushAudio();
+        }, 0);
+    }
+    if (this._backpressure || this._queuedBytes() >= this._pushHighWater) {
+        this._blocked = true;
+        return false;
+    }
+    return true;
+};
+
+OxfordSpeechRecognition.prototype._queuedBytes = function() {
+    return this._nativeQueued + this._inflightBytes + this._pushBytes;
+};
+
+/**
+ * Fires ondrain once a producer told to back off may push again: the native queue is not
+ * over its high water mark, and what is queued overall is back under the low water mark, or
+ * at least under the high water mark with nothing left in flight.
+ */
+OxfordSpeechRecognition.prototype._checkDrain = function() {
+    if (!this._blocked || this._backpressure) {
+        return;
+    }
+    var queued = this._queuedBytes();
+    if (queued <= this._pushLowWater || (this._inflightBytes === 0 && queued < this._pushHighWater)) {
+        this._blocked = false;
+        if (typeof this.ondrain === "function") {
+            this.ondrain({ queued: queued });
+        }
+    }
+};
+
+/**
+ * Ends the pushed audio. The final result arrives through onresult.
+ */
+OxfordSpeechRecognition.prototype.endAudio = function() {
+    if (!this._pushing) {
+        return;
+    }
+    this._flushAudio();
+    this._pushing = false;
+    exec(null, null, "OxfordSpeechRecognition", "endAudio", []);
+};
+
+/**
+ * Forgets the push session the service has ended; audio not sent yet would only be refused.
+ */
+OxfordSpeechRecognition.prototype._endPush = function() {
+    if (this._pushTimer !== null) {
+        clearTimeout(this._pushTimer);
+        this._pushTimer = null;
+    }
+    this._pushing = false;
+    this._pushChunks = [];
+    this._pushBytes = 0;
+    this._backpressure = false;
+    this._blocked = false;
+    this._inflightBytes = 0;
+    this._nativeQueued = 0;
+};
+
+OxfordSpeechRecognition.prototype._flushAudio = function() {
+    if (this._pushTimer !== null) {
+        clearTimeout(this._pushTimer);
+        this._pushTimer = null;
+    }
+    if (this._pushBytes === 0) {
+        return;
+    }
+
+    var buffer = this._pushChunks[0];
+    if (this._pushChunks.length > 1) {
+        var merged = new Uint8Array(this._pushBytes);
+        var offset = 0;
+        for (var i = 0; i < this._pushChunks.length; i++) {
+            merged.set(new Uint8Array(this._pushChunks[i]), offset);
+            offset += this._pushChunks[i].byteLength;
+        }
+        buffer = merged.buffer;
+    }
+    var bytes = this._pushBytes;
+    var seq = ++this._pushSeq;
+    var session = this._pushSession;
+    this._pushChunks = [];
+    this._pushBytes = 0;
+    this._inflightBytes += bytes;
+
+    var that = this;
+    var update = function(status) {
+        // Replies for a session that has ended were already written off.
+        if (session !== that._pushSession || !that._pushing) {
+            return;
+        }
+        that._inflightBytes -= bytes;
+        // Replies and drains can arrive out of order; only apply state newer than the last.
+        if (typeof status === "object" && seq > that._stateSeq) {
+            that._stateSeq = seq;
+            that._backpressure = status.backpressure;
+            that._nativeQueued = status.queued;
+        }
+    };
+    exec(function(status) {
+        update(status);
+        that._checkDrain();
+    }, function(status) {
+        update(status);
+        if (typeof that.onerror === "function") {
+            that.onerror(status);
+        }
+        that._checkDrain();
+    }, "OxfordSpeechRecognition", "pushAudio", [buffer, seq]);
+};
+
+/**
+ * Reads the native transcript, or the [start, end) range of it. Calls back with
+ * { text, length, segments }.
+ */
+OxfordSpeechRecognition.prototype.getTranscript = function(successCallback, errorCallback, start, end) {
+    var args = [start || 0];
+    if (typeof end === "number") {
+        args.push(end);
+    }
+    exec(successCallback, errorCallback, "OxfordSpeechRecognition", "getTranscript", args);
+};
+
+/**
+ * Sets up the audio session, recognition client and on-disk indexes in the background, so the
+ * first start doesn't pay for them. Optional; start does it otherwise. The success callback gets
+ * the startup timing, also available as getMetrics().startup.
+ */
+OxfordSpeechRecognition.prototype.prepare = function(successCallback, errorCallback) {
+    exec(successCallback, errorCallback, "OxfordSpeechRecognition", "prepare", []);
+};
+
+/**
+ * Reads the metrics of the enabled features, keyed by feature (e.g. retry).
+ */
+OxfordSpeechRecognition.prototype.getMetrics = function(successCallback, errorCallback) {
+    exec(successCallback, errorCallback, "OxfordSpeechRecognition", "getMetrics", []);
+};
+
+/**
+ * Updates the location and text context of the recognition sessions. Only the change is sent;
+ * the native side keeps the context for later sessions. change is { location: { latitude,
+ * longitude }, text: "..." or [...], clear: true }, all optional. iOS only; the Android SDK
+ * does not expose it.
+ */
+OxfordSpeechRecognition.prototype.updateContext = function(change, successCallback, errorCallback) {
+    exec(successCallback, errorCallback, "OxfordSpeechRecognition", "updateContext", [change]);
+};
+
+OxfordSpeechRecognition.prototype.setLocation = function(latitude, longitude, successCallback, errorCallback) {
+    this.updateContext({ location: { latitude: latitude, longitude: longitude } }, successCallback, errorCallback);
+};
+
+OxfordSpeechRecognition.prototype.addContext = function(text, successCallback, errorCallback) {
+    this.updateContext({ text: text }, successCallback, errorCallback);
+};
+
+OxfordSpeechRecognition.prototype.clearContext = function(successCallback, errorCallback) {
+    this.updateContext({ clear: true }, successCallback, errorCallback);
+};
+
+/**
+ * Replaces the vocabulary the N-best results are rescored against. Entries are phrases or
+ * { text, weight } objects. The vocabulary is kept on the device across launches. Without the
+ * booster option it is only stored, and used once the plugin is initialized with booster; the
+ * success callback's boosting tells which.
+ */
+OxfordSpeechRecognition.prototype.setVocabulary = function(phrases, successCallback, errorCallback) {
+    exec(successCallback, errorCallback, "OxfordSpeechRecognition", "setVocabulary", [phrases]);
+};
+
+/**
+ * Returns up to limit { text, weight } completions of a prefix from the typeahead index, most
+ * frequent first. limit defaults to the typeahead option's.
+ */
+OxfordSpeechRecognition.prototype.getCompletions = function(prefix, limit, successCallback, errorCallback) {
+    var args = limit ? [prefix, limit] : [prefix];
+    exec(successCallback, errorCallback, "OxfordSpeechRecognition", "getCompletions", args);
+};
+
+OxfordSpeechRecognition.prototype.listRecordings = function(successCallback, errorCallback) {
+    exec(successCallback, errorCallback, "OxfordSpeechRecognition", "listRecordings", []);
 };
 
 OxfordSpeechRecognition.prototype.stop = function() {
+    this._flushAudio();
+    this._pushing = false;
     exec(null, null, "OxfordSpeechRecognition", "stop", []);
 };
 
 OxfordSpeechRecognition.prototype.abort = function() {
+    this._pushChunks = [];
+    this._pushBytes = 0;
+    this._flushAudio();
+    this._pushing = false;
     exec(null, null, "OxfordSpeechRecognition", "abort", []);
 };
 